@@ -0,0 +1,179 @@
+// Microbenchmarks for EvilutionJobSystem: job spawn overhead and parallelFor scaling with thread count.
+// Build and run with `make bench`.
+
+#include "evilution_job_system.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+using namespace evilution;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int REPEATS = 5;
+constexpr uint32_t MAX_THREADS = 64;
+
+template <typename Function>
+double medianMilliseconds(Function&& function) {
+    std::vector<double> times;
+    for (int i = 0; i < REPEATS; i++) {
+        auto start = Clock::now();
+        function();
+        times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+std::vector<uint32_t> threadCounts() {
+    std::vector<uint32_t> counts;
+    for (uint32_t count = 1; count <= MAX_THREADS; count *= 2) {
+        counts.push_back(count);
+    }
+    return counts;
+}
+
+// empty jobs submitted from the creating thread, which goes through its own deque
+void benchmarkSpawnFromMain(uint32_t threadCount) {
+    constexpr uint32_t JOB_COUNT = 1 << 18;
+    EvilutionJobSystem jobSystem{threadCount};
+    std::atomic<uint32_t> executed{0};
+
+    double ms = medianMilliseconds([&] {
+        EvilutionJobCounter counter;
+        for (uint32_t i = 0; i < JOB_COUNT; i++) {
+            jobSystem.run([&executed] { executed.fetch_add(1, std::memory_order_relaxed); }, &counter);
+        }
+        jobSystem.wait(counter);
+    });
+
+    if (executed.load() != JOB_COUNT * REPEATS) {
+        throw std::runtime_error("spawn benchmark lost jobs!");
+    }
+    std::cout << "  spawn from main    threads " << std::setw(2) << threadCount << ": " << std::setw(8)
+              << ms * 1e6 / JOB_COUNT << " ns/job\n";
+}
+
+// each root job fans out children from a worker, the common pattern inside systems
+void benchmarkNestedSpawn(uint32_t threadCount) {
+    constexpr uint32_t ROOT_COUNT = 256;
+    constexpr uint32_t CHILD_COUNT = 1024;
+    EvilutionJobSystem jobSystem{threadCount};
+    std::atomic<uint32_t> executed{0};
+
+    double ms = medianMilliseconds([&] {
+        EvilutionJobCounter roots;
+        for (uint32_t i = 0; i < ROOT_COUNT; i++) {
+            jobSystem.run([&jobSystem, &executed] {
+                EvilutionJobCounter children;
+                for (uint32_t j = 0; j < CHILD_COUNT; j++) {
+                    jobSystem.run([&executed] { executed.fetch_add(1, std::memory_order_relaxed); }, &children);
+                }
+                jobSystem.wait(children);
+            }, &roots);
+        }
+        jobSystem.wait(roots);
+    });
+
+    if (executed.load() != ROOT_COUNT * CHILD_COUNT * REPEATS) {
+        throw std::runtime_error("nested spawn benchmark lost jobs!");
+    }
+    std::cout << "  nested spawn       threads " << std::setw(2) << threadCount << ": " << std::setw(8)
+              << ms * 1e6 / (ROOT_COUNT * CHILD_COUNT) << " ns/job\n";
+}
+
+// a chain of dependent jobs, measuring counter and continuation overhead
+void benchmarkContinuations(uint32_t threadCount) {
+    constexpr uint32_t CHAIN_LENGTH = 1 << 14;
+    EvilutionJobSystem jobSystem{threadCount};
+    uint32_t last = 0;
+    bool ordered = true;
+
+    double ms = medianMilliseconds([&] {
+        std::vector<EvilutionJobCounter> counters(CHAIN_LENGTH);
+        uint32_t step = 0;
+        jobSystem.run([&step] { step = 1; }, &counters[0]);
+        for (uint32_t i = 1; i < CHAIN_LENGTH; i++) {
+            jobSystem.runAfter(counters[i - 1], [&step, &ordered, i] {
+                ordered = ordered && step == i;
+                step = i + 1;
+            }, &counters[i]);
+        }
+        jobSystem.wait(counters.back());
+        // a finished job may still be releasing its counter after its continuation ran; every counter has to be
+        // done before the vector goes away
+        for (const auto& counter : counters) {
+            jobSystem.wait(counter);
+        }
+        last = step;
+    });
+
+    if (last != CHAIN_LENGTH || !ordered) {
+        throw std::runtime_error("continuation benchmark ran jobs out of order!");
+    }
+    std::cout << "  continuation chain threads " << std::setw(2) << threadCount << ": " << std::setw(8)
+              << ms * 1e6 / CHAIN_LENGTH << " ns/job\n";
+}
+
+// compute-bound loop, comparable to per-entity transform math
+double benchmarkParallelFor(uint32_t threadCount, std::vector<float>& output) {
+    EvilutionJobSystem jobSystem{threadCount};
+    return medianMilliseconds([&] {
+        jobSystem.parallelFor(static_cast<uint32_t>(output.size()), 1024, [&output](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                float x = static_cast<float>(i);
+                for (int k = 0; k < 16; k++) {
+                    x = std::sin(x) * 0.5f + std::sqrt(std::abs(x) + 1.0f);
+                }
+                output[i] = x;
+            }
+        });
+    });
+}
+
+} // namespace
+
+int main() {
+    try {
+        std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+
+        std::cout << "spawn overhead\n";
+        for (uint32_t threadCount : threadCounts()) {
+            benchmarkSpawnFromMain(threadCount);
+        }
+        for (uint32_t threadCount : threadCounts()) {
+            benchmarkNestedSpawn(threadCount);
+        }
+        for (uint32_t threadCount : threadCounts()) {
+            benchmarkContinuations(threadCount);
+        }
+
+        std::cout << "\nparallelFor scaling (4M items)\n";
+        std::vector<float> reference(1 << 22);
+        double baseline = benchmarkParallelFor(1, reference);
+        for (uint32_t threadCount : threadCounts()) {
+            std::vector<float> output(reference.size());
+            double ms = threadCount == 1 ? baseline : benchmarkParallelFor(threadCount, output);
+            if (threadCount != 1 && output != reference) {
+                throw std::runtime_error("parallelFor produced different results!");
+            }
+            std::cout << "  threads " << std::setw(2) << threadCount << ": " << std::setw(8) << std::fixed
+                      << std::setprecision(2) << ms << " ms, speedup " << baseline / ms << "x\n";
+            std::cout.unsetf(std::ios::fixed);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+// Step time of EvilutionPhysicsWorld for thousands to tens of thousands of bodies bouncing in a box, against the
+// 2 ms budget. The budget scales with worker threads: a single thread is expected to hold it up to a few thousand
+// bodies, tens of thousands need the job system spread over several cores. The mixed run adds a few bodies fifty
+// times larger to show the coarser grid levels do not drag the small ones down. Build and run with `make bench`.
+
+#include "evilution_physics_world.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace evilution;
+
+namespace {
+
+constexpr double BUDGET_MS = 2.0;
+constexpr int WARMUP_STEPS = 60;
+constexpr int MEASURED_STEPS = 240;
+
+void benchmarkBodies(EvilutionJobSystem& jobSystem, uint32_t bodyCount, bool mixedSizes) {
+    constexpr float BODY_RADIUS = 0.25f;
+    constexpr float LARGE_BODY_RADIUS = 12.5f;
+    constexpr uint32_t LARGE_BODY_INTERVAL = 1000;
+    // about one body per 4 radii cubed, dense enough for steady contacts
+    float halfExtent = std::cbrt(static_cast<float>(bodyCount)) * BODY_RADIUS * 2.f;
+
+    PhysicsSettings settings{};
+    settings.gravity = {0.f, 9.8f, 0.f};
+    settings.useBounds = true;
+    settings.boundsMin = {-halfExtent, -halfExtent, -halfExtent};
+    settings.boundsMax = {halfExtent, halfExtent, halfExtent};
+    EvilutionPhysicsWorld world{jobSystem, settings};
+
+    std::mt19937 random{1234};
+    std::uniform_real_distribution<float> position{-halfExtent, halfExtent};
+    std::uniform_real_distribution<float> velocity{-2.f, 2.f};
+    for (uint32_t i = 0; i < bodyCount; i++) {
+        PhysicsBodyDesc body{};
+        body.position = {position(random), position(random), position(random)};
+        body.velocity = {velocity(random), velocity(random), velocity(random)};
+        body.radius = mixedSizes && i % LARGE_BODY_INTERVAL == 0 ? LARGE_BODY_RADIUS : BODY_RADIUS;
+        world.addBody(body);
+    }
+
+    for (int i = 0; i < WARMUP_STEPS; i++) {
+        world.update(settings.fixedTimeStep);
+    }
+
+    std::vector<double> totals;
+    double integrateMs = 0.0, broadphaseMs = 0.0, solveMs = 0.0;
+    uint64_t contacts = 0, islands = 0;
+    for (int i = 0; i < MEASURED_STEPS; i++) {
+        world.update(settings.fixedTimeStep);
+        const auto& stats = world.getStats();
+        totals.push_back(stats.totalMs);
+        integrateMs += stats.integrateMs;
+        broadphaseMs += stats.broadphaseMs;
+        solveMs += stats.solveMs;
+        contacts += stats.contacts;
+        islands += stats.islands;
+    }
+    std::sort(totals.begin(), totals.end());
+    double mean = 0.0;
+    for (double total : totals) {
+        mean += total;
+    }
+    mean /= totals.size();
+    double p99 = totals[static_cast<size_t>(totals.size() * 0.99)];
+
+    std::cout << std::fixed << std::setprecision(3) << "  " << std::setw(6) << bodyCount
+              << (mixedSizes ? " mixed" : " bodies") << ": mean " << mean << " ms, p99 " << p99 << " ms (integrate "
+              << integrateMs / MEASURED_STEPS << ", broadphase " << broadphaseMs / MEASURED_STEPS << ", solve "
+              << solveMs / MEASURED_STEPS << "), " << contacts / MEASURED_STEPS << " contacts in "
+              << islands / MEASURED_STEPS << " islands, " << (p99 <= BUDGET_MS ? "within" : "over") << " budget\n";
+    std::cout.unsetf(std::ios::fixed);
+}
+
+} // namespace
+
+int main() {
+    EvilutionJobSystem jobSystem{};
+    std::cout << "physics step, " << jobSystem.getThreadCount() << " threads, " << BUDGET_MS << " ms budget\n";
+    for (uint32_t bodyCount : {2000u, 5000u, 10000u, 25000u, 50000u}) {
+        benchmarkBodies(jobSystem, bodyCount, false);
+    }
+    benchmarkBodies(jobSystem, 10000u, true);
+    return 0;
+}
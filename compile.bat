@@ -1,3 +1,9 @@
-C:\VulkanSDK\1.3.296.0\Bin\glslc.exe shaders\simple_shader.vert -o shaders\simple_shader.vert.spv
-C:\VulkanSDK\1.3.296.0\Bin\glslc.exe shaders\simple_shader.frag -o shaders\simple_shader.frag.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe -mfmt=c shaders\simple_shader.vert -o shaders\simple_shader.vert.spv.inc
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe -mfmt=c shaders\simple_shader.frag -o shaders\simple_shader.frag.spv.inc
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe -mfmt=c shaders\meshlet_shader.vert -o shaders\meshlet_shader.vert.spv.inc
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe -mfmt=c shaders\meshlet_shader_pulled.vert -o shaders\meshlet_shader_pulled.vert.spv.inc
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe -mfmt=c shaders\meshlet_shader.frag -o shaders\meshlet_shader.frag.spv.inc
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe -mfmt=c shaders\meshlet_cull.comp -o shaders\meshlet_cull.comp.spv.inc
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe -mfmt=c shaders\depth_pyramid.comp -o shaders\depth_pyramid.comp.spv.inc
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe -mfmt=c shaders\instance_transforms.comp -o shaders\instance_transforms.comp.spv.inc
 pause
@@ -0,0 +1,420 @@
+#include "evilution_asset_cache.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+namespace evilution {
+
+EvilutionAssetCache::EvilutionAssetCache(EvilutionGeometryPool& geometryPool,
+                                         EvilutionResourceRegistry& resourceRegistry, VkDeviceSize memoryBudget,
+                                         uint32_t loaderCount)
+    : evilutionGeometryPool{geometryPool}, evilutionResourceRegistry{resourceRegistry}, memoryBudget{memoryBudget} {
+    loaderCount = std::max(1u, loaderCount);
+    for (uint32_t i = 0; i < loaderCount; i++) {
+        loaders.emplace_back([this] { loaderLoop(); });
+    }
+}
+
+EvilutionAssetCache::~EvilutionAssetCache() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    loadedCondition.notify_all();
+    for (auto& loader : loaders) {
+        loader.join();
+    }
+}
+
+ModelHandle EvilutionAssetCache::loadModelAsync(const std::string& filepath, uint32_t levelOfDetail) {
+    std::string file = canonicalPath(filepath);
+    std::string path = levelOfDetail > 0 ? file + "#lod" + std::to_string(levelOfDetail) : file;
+
+    std::unique_lock<std::mutex> lock{mutex};
+    auto found = modelsByPath.find(path);
+    if (found != modelsByPath.end()) {
+        stats.pathHits++;
+        return acquire(entries.at(found->second.value), found->second);
+    }
+
+    ModelHandle model = evilutionResourceRegistry.reserveModel();
+    Entry entry{};
+    entry.paths.push_back(path);
+    entry.references = 1;
+    entries.emplace(model.value, std::move(entry));
+    modelsByPath.emplace(path, model);
+    stats.loadingModels++;
+
+    loadQueue.push_back({model, std::move(file), levelOfDetail});
+    lock.unlock();
+    queueCondition.notify_one();
+    return model;
+}
+
+ModelHandle EvilutionAssetCache::loadModel(const std::string& filepath, uint32_t levelOfDetail) {
+    ModelHandle model = loadModelAsync(filepath, levelOfDetail);
+    waitForModel(model);
+    return model;
+}
+
+void EvilutionAssetCache::waitForModel(ModelHandle model) {
+    std::unique_lock<std::mutex> lock{mutex};
+    loadedCondition.wait(lock, [&] {
+        auto found = entries.find(model.value);
+        return stopping || found == entries.end() || found->second.state != LoadState::Loading;
+    });
+
+    auto found = entries.find(model.value);
+    if (found == entries.end() || found->second.state != LoadState::Resident) {
+        throw std::runtime_error("failed to load model!");
+    }
+}
+
+void EvilutionAssetCache::releaseModel(ModelHandle model, bool keepResident) {
+    std::lock_guard<std::mutex> lock{mutex};
+    release(model);
+
+    auto found = entries.find(model.value);
+    if (!keepResident && found != entries.end() && found->second.references == 0) {
+        unreferenced.erase(found->second.lruPosition);
+        removeEntry(model);
+        stats.evictions++;
+    }
+    evictOverBudget();
+}
+
+void EvilutionAssetCache::setMemoryBudget(VkDeviceSize budget) {
+    std::lock_guard<std::mutex> lock{mutex};
+    memoryBudget = budget;
+    evictOverBudget();
+}
+
+VkDeviceSize EvilutionAssetCache::getMemoryBudget() {
+    std::lock_guard<std::mutex> lock{mutex};
+    return memoryBudget;
+}
+
+EvilutionAssetCache::Stats EvilutionAssetCache::getStats() {
+    std::lock_guard<std::mutex> lock{mutex};
+    return stats;
+}
+
+void EvilutionAssetCache::printStats(std::ostream& out) {
+    Stats current = getStats();
+    uint64_t requests = current.pathHits + current.contentHits + current.misses + current.failures;
+    double hitRate = requests > 0 ? 100.0 * static_cast<double>(current.pathHits + current.contentHits) /
+                                        static_cast<double>(requests)
+                                  : 0.0;
+    out << "asset cache: " << requests << " requests, " << hitRate << "% hits (" << current.pathHits << " by path, "
+        << current.contentHits << " by content), " << current.misses << " misses, " << current.failures
+        << " failed, " << current.evictions << " evictions, " << current.uploadBatches << " upload batches, "
+        << current.residentModels << " models resident in " << current.residentBytes / 1024 << " KiB" << std::endl;
+}
+
+std::string EvilutionAssetCache::canonicalPath(const std::string& filepath) {
+    // "models/../models/vase.obj" and "./models/vase.obj" are the same asset
+    std::error_code error;
+    std::string path = std::filesystem::weakly_canonical(filepath, error).string();
+    return error ? filepath : path;
+}
+
+uint64_t EvilutionAssetCache::hashGeometry(const EvilutionModel::Builder& builder) {
+    // FNV-1a over the raw vertex and index data; Vertex has no padding, so equal geometry hashes equally
+    uint64_t hash = 14695981039346656037ull;
+    auto hashBytes = [&hash](const void* data, size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    uint64_t counts[] = {builder.vertices.size(), builder.indices.size()};
+    hashBytes(counts, sizeof(counts));
+    hashBytes(builder.vertices.data(), builder.vertices.size() * sizeof(EvilutionModel::Vertex));
+    hashBytes(builder.indices.data(), builder.indices.size() * sizeof(uint32_t));
+    return hash;
+}
+
+bool EvilutionAssetCache::sameGeometry(const std::vector<EvilutionModel::Vertex>& vertices,
+                                       const std::vector<uint32_t>& indices, const EvilutionModel::Builder& builder) {
+    // the same bytes hashGeometry saw, so -0 and 0 or differing NaNs are told apart just as they hash
+    if (vertices.size() != builder.vertices.size() || indices.size() != builder.indices.size()) {
+        return false;
+    }
+    size_t vertexBytes = vertices.size() * sizeof(EvilutionModel::Vertex);
+    size_t indexBytes = indices.size() * sizeof(uint32_t);
+    return (vertexBytes == 0 || std::memcmp(vertices.data(), builder.vertices.data(), vertexBytes) == 0) &&
+           (indexBytes == 0 || std::memcmp(indices.data(), builder.indices.data(), indexBytes) == 0);
+}
+
+void EvilutionAssetCache::loaderLoop() {
+    while (true) {
+        LoadJob job;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            queueCondition.wait(lock, [this] { return stopping || !loadQueue.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(loadQueue.front());
+            loadQueue.pop_front();
+            // released before a loader got to it
+            if (entries.find(job.model.value) == entries.end()) {
+                continue;
+            }
+        }
+
+        ParsedModel parsed{};
+        parsed.model = job.model;
+        try {
+            parsed.builder.loadModel(job.path);
+            if (job.levelOfDetail > 0) {
+                parsed.builder.simplify(std::max(2u, 64u >> std::min(job.levelOfDetail - 1, 5u)));
+            }
+            parsed.builder.buildMeshlets();
+            parsed.contentHash = hashGeometry(parsed.builder);
+        } catch (const std::exception& e) {
+            std::cerr << "failed to load model " << job.path << ": " << e.what() << std::endl;
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                markFailed(job.model);
+            }
+            loadedCondition.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock{mutex};
+        parsedModels.push_back(std::move(parsed));
+        if (uploading) {
+            continue;
+        }
+
+        // keep uploading until nothing parsed is left, taking everything that arrived during the last batch
+        uploading = true;
+        while (!parsedModels.empty() && !stopping) {
+            std::vector<ParsedModel> batch = std::move(parsedModels);
+            parsedModels.clear();
+            lock.unlock();
+            uploadParsed(batch);
+            loadedCondition.notify_all();
+            lock.lock();
+        }
+        uploading = false;
+    }
+}
+
+void EvilutionAssetCache::uploadParsed(std::vector<ParsedModel>& parsed) {
+    // what each parsed model becomes: uploaded, an alias of a resident model, or an alias of one in this batch
+    std::vector<GeometryUpload> uploads;
+    std::vector<size_t> uploadedModels;
+    std::vector<std::pair<size_t, ModelHandle>> residentAliases;
+    std::vector<std::pair<size_t, size_t>> batchAliases;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::unordered_multimap<uint64_t, size_t> firstInBatch;
+        for (size_t i = 0; i < parsed.size(); i++) {
+            if (entries.find(parsed[i].model.value) == entries.end()) {
+                continue;
+            }
+            uint64_t hash = parsed[i].contentHash;
+            const EvilutionModel::Builder& builder = parsed[i].builder;
+            // a matching hash only narrows it down; the geometry itself has to match before it is shared
+            ModelHandle residentMatch{};
+            auto residents = modelsByContent.equal_range(hash);
+            for (auto it = residents.first; it != residents.second && residentMatch.isNull(); ++it) {
+                const Entry& resident = entries.at(it->second.value);
+                if (sameGeometry(resident.vertices, resident.indices, builder)) {
+                    residentMatch = it->second;
+                }
+            }
+            if (!residentMatch.isNull()) {
+                residentAliases.emplace_back(i, residentMatch);
+                continue;
+            }
+            auto batched = firstInBatch.equal_range(hash);
+            auto first = std::find_if(batched.first, batched.second, [&](const auto& candidate) {
+                const EvilutionModel::Builder& other = parsed[candidate.second].builder;
+                return sameGeometry(other.vertices, other.indices, builder);
+            });
+            if (first != batched.second) {
+                batchAliases.emplace_back(i, first->second);
+                continue;
+            }
+
+            firstInBatch.emplace(hash, i);
+            uploads.push_back({builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size()),
+                               builder.indices.empty() ? nullptr : builder.indices.data(),
+                               static_cast<uint32_t>(builder.indices.size()),
+                               builder.meshlets.empty() ? nullptr : builder.meshlets.data(),
+                               static_cast<uint32_t>(builder.meshlets.size())});
+            uploadedModels.push_back(i);
+        }
+    }
+
+    std::vector<std::shared_ptr<EvilutionModel>> models;
+    bool uploadFailed = false;
+    if (!uploads.empty()) {
+        try {
+            std::vector<GeometryAllocationId> allocations = evilutionGeometryPool.allocateBatch(uploads);
+            for (size_t i = 0; i < allocations.size(); i++) {
+                models.push_back(std::make_shared<EvilutionModel>(evilutionGeometryPool, allocations[i],
+                                                                  parsed[uploadedModels[i]].builder));
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "failed to upload models: " << e.what() << std::endl;
+            uploadFailed = true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (!uploads.empty()) {
+        stats.uploadBatches++;
+    }
+    for (size_t i = 0; i < uploadedModels.size(); i++) {
+        ParsedModel& result = parsed[uploadedModels[i]];
+        auto found = entries.find(result.model.value);
+        // released while uploading; dropping the model frees its range
+        if (found == entries.end()) {
+            continue;
+        }
+        if (uploadFailed) {
+            markFailed(result.model);
+            continue;
+        }
+
+        Entry& entry = found->second;
+        GeometryRange geometry = models[i]->getGeometry();
+        evilutionResourceRegistry.setModel(result.model, std::move(models[i]));
+        entry.state = LoadState::Resident;
+        entry.contentHash = result.contentHash;
+        // the builder is done with once its model exists, and aliases below only need its handle
+        entry.vertices = std::move(result.builder.vertices);
+        entry.indices = std::move(result.builder.indices);
+        entry.bytes = static_cast<VkDeviceSize>(geometry.vertexCount) * evilutionGeometryPool.getVertexStride() +
+                      static_cast<VkDeviceSize>(geometry.indexCount) * sizeof(uint32_t) +
+                      static_cast<VkDeviceSize>(geometry.meshletCount) * sizeof(Meshlet);
+        modelsByContent.emplace(result.contentHash, result.model);
+        stats.misses++;
+        stats.loadingModels--;
+        stats.residentModels++;
+        stats.residentBytes += entry.bytes;
+    }
+
+    auto aliasTo = [this](const ParsedModel& result, ModelHandle original) {
+        auto found = entries.find(result.model.value);
+        if (found == entries.end()) {
+            return;
+        }
+        auto target = entries.find(original.value);
+        if (target == entries.end() || target->second.state != LoadState::Resident) {
+            markFailed(result.model);
+            return;
+        }
+        makeAlias(result.model, found->second, original);
+    };
+    for (const auto& [index, original] : residentAliases) {
+        aliasTo(parsed[index], original);
+    }
+    for (const auto& [index, firstIndex] : batchAliases) {
+        aliasTo(parsed[index], parsed[firstIndex].model);
+    }
+
+    evictOverBudget();
+}
+
+ModelHandle EvilutionAssetCache::acquire(Entry& entry, ModelHandle model) {
+    if (entry.references++ == 0) {
+        unreferenced.erase(entry.lruPosition);
+    }
+    return model;
+}
+
+void EvilutionAssetCache::release(ModelHandle model) {
+    auto found = entries.find(model.value);
+    assert(found != entries.end() && found->second.references > 0 && "Releasing a model the cache does not hold");
+
+    Entry& entry = found->second;
+    if (--entry.references > 0) {
+        return;
+    }
+    // failed loads are not worth keeping around
+    if (entry.state == LoadState::Failed) {
+        entries.erase(found);
+        return;
+    }
+    unreferenced.push_front(model);
+    entry.lruPosition = unreferenced.begin();
+}
+
+void EvilutionAssetCache::makeAlias(ModelHandle model, Entry& entry, ModelHandle original) {
+    evilutionResourceRegistry.setModel(model, evilutionResourceRegistry.shareModel(original));
+    acquire(entries.at(original.value), original);
+    entry.state = LoadState::Resident;
+    entry.aliasOf = original;
+    stats.contentHits++;
+    stats.loadingModels--;
+}
+
+void EvilutionAssetCache::markFailed(ModelHandle model) {
+    auto found = entries.find(model.value);
+    if (found == entries.end() || found->second.state != LoadState::Loading) {
+        return;
+    }
+    Entry& entry = found->second;
+    entry.state = LoadState::Failed;
+    // a later request for the same path tries again
+    for (const std::string& path : entry.paths) {
+        modelsByPath.erase(path);
+    }
+    evilutionResourceRegistry.removeModel(model);
+    stats.failures++;
+    stats.loadingModels--;
+}
+
+void EvilutionAssetCache::removeEntry(ModelHandle model) {
+    auto found = entries.find(model.value);
+    Entry& entry = found->second;
+    for (const std::string& path : entry.paths) {
+        modelsByPath.erase(path);
+    }
+
+    if (entry.state == LoadState::Loading) {
+        stats.loadingModels--;
+    } else if (entry.aliasOf.isNull()) {
+        auto residents = modelsByContent.equal_range(entry.contentHash);
+        auto self = std::find_if(residents.first, residents.second,
+                                 [model](const auto& resident) { return resident.second == model; });
+        if (self != residents.second) {
+            modelsByContent.erase(self);
+        }
+        stats.residentBytes -= entry.bytes;
+        stats.residentModels--;
+    }
+    ModelHandle original = entry.aliasOf;
+    entries.erase(found);
+
+    // cancels the reservation of a model still loading; otherwise the geometry stays until frames that may
+    // draw it have completed
+    evilutionResourceRegistry.removeModel(model);
+    if (!original.isNull()) {
+        release(original);
+    }
+}
+
+void EvilutionAssetCache::evictOverBudget() {
+    while (stats.residentBytes > memoryBudget && !unreferenced.empty()) {
+        ModelHandle model = unreferenced.back();
+        unreferenced.pop_back();
+        removeEntry(model);
+        stats.evictions++;
+    }
+}
+
+} // namespace evilution
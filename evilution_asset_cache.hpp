@@ -0,0 +1,144 @@
+#pragma once
+
+#include "evilution_geometry_pool.hpp"
+#include "evilution_model.hpp"
+#include "evilution_resource_registry.hpp"
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace evilution {
+
+// Loads models once and hands out the same handle to everyone who asks for them. Requests are matched by
+// canonical path first and, when the path is new, by a hash of the parsed geometry, so copies of a file under
+// another name share one upload as well.
+//
+// Loading happens on the cache's own threads: files are parsed in parallel and whatever has been parsed by the
+// time the previous upload finishes goes to the GPU in one batch. Handles are returned before the model is
+// resident and resolve to nothing until it is, so renderers skip them in the meantime.
+//
+// Each load takes a reference that releaseModel() gives back. Unreferenced models stay resident for
+// later requests until the geometry they hold pushes the cache over its budget, and are then evicted least
+// recently used first. Models that are still referenced are never evicted, even over budget.
+//
+// A level of detail above 0 loads a coarser copy of the file, made by EvilutionModel::Builder::simplify() on a
+// grid of 64 cells per axis at level 1 and half as many for each level after. Each level is cached as an asset
+// of its own.
+class EvilutionAssetCache {
+  public:
+    struct Stats {
+        uint64_t pathHits = 0;
+        // new path, but the same geometry as a resident model
+        uint64_t contentHits = 0;
+        uint64_t misses = 0;
+        uint64_t failures = 0;
+        uint64_t evictions = 0;
+        uint64_t uploadBatches = 0;
+        uint32_t loadingModels = 0;
+        uint32_t residentModels = 0;
+        VkDeviceSize residentBytes = 0;
+    };
+
+    EvilutionAssetCache(EvilutionGeometryPool& geometryPool, EvilutionResourceRegistry& resourceRegistry,
+                        VkDeviceSize memoryBudget = 256 * 1024 * 1024, uint32_t loaderCount = 2);
+    ~EvilutionAssetCache();
+
+    EvilutionAssetCache(const EvilutionAssetCache&) = delete;
+    EvilutionAssetCache& operator=(const EvilutionAssetCache&) = delete;
+
+    // Returns immediately; the model is parsed and uploaded in the background.
+    ModelHandle loadModelAsync(const std::string& filepath, uint32_t levelOfDetail = 0);
+    // Blocks until the model is resident. Throws if it could not be loaded.
+    ModelHandle loadModel(const std::string& filepath, uint32_t levelOfDetail = 0);
+    void waitForModel(ModelHandle model);
+    // Without keepResident, a model nobody else references is evicted right away, or its load cancelled,
+    // instead of waiting for budget pressure.
+    void releaseModel(ModelHandle model, bool keepResident = true);
+
+    void setMemoryBudget(VkDeviceSize budget);
+    VkDeviceSize getMemoryBudget();
+
+    Stats getStats();
+    void printStats(std::ostream& out);
+
+  private:
+    enum class LoadState : uint8_t { Loading, Resident, Failed };
+
+    struct Entry {
+        std::vector<std::string> paths;
+        LoadState state = LoadState::Loading;
+        uint64_t contentHash = 0;
+        // the geometry behind contentHash, kept for resident originals so a hash match is confirmed byte for byte
+        // before another load shares the model
+        std::vector<EvilutionModel::Vertex> vertices;
+        std::vector<uint32_t> indices;
+        uint32_t references = 0;
+        VkDeviceSize bytes = 0;
+        // set when the handle shares another entry's model, which it holds a reference on
+        ModelHandle aliasOf{};
+        // position in the unreferenced list, valid while references is 0
+        std::list<ModelHandle>::iterator lruPosition;
+    };
+
+    struct LoadJob {
+        ModelHandle model;
+        std::string path;
+        uint32_t levelOfDetail = 0;
+    };
+
+    struct ParsedModel {
+        ModelHandle model;
+        EvilutionModel::Builder builder;
+        uint64_t contentHash = 0;
+    };
+
+    static std::string canonicalPath(const std::string& filepath);
+    static uint64_t hashGeometry(const EvilutionModel::Builder& builder);
+    static bool sameGeometry(const std::vector<EvilutionModel::Vertex>& vertices,
+                             const std::vector<uint32_t>& indices, const EvilutionModel::Builder& builder);
+
+    void loaderLoop();
+    void uploadParsed(std::vector<ParsedModel>& parsed);
+
+    // called with mutex held
+    ModelHandle acquire(Entry& entry, ModelHandle model);
+    void release(ModelHandle model);
+    void makeAlias(ModelHandle model, Entry& entry, ModelHandle original);
+    void markFailed(ModelHandle model);
+    void removeEntry(ModelHandle model);
+    void evictOverBudget();
+
+    EvilutionGeometryPool& evilutionGeometryPool;
+    EvilutionResourceRegistry& evilutionResourceRegistry;
+
+    std::mutex mutex;
+    std::condition_variable queueCondition;
+    std::condition_variable loadedCondition;
+    VkDeviceSize memoryBudget;
+    std::unordered_map<uint32_t, Entry> entries;
+    std::unordered_map<std::string, ModelHandle> modelsByPath;
+    // a multimap since different geometry can share a hash
+    std::unordered_multimap<uint64_t, ModelHandle> modelsByContent;
+    // unreferenced models, most recently released at the front
+    std::list<ModelHandle> unreferenced;
+    Stats stats{};
+
+    std::deque<LoadJob> loadQueue;
+    std::vector<ParsedModel> parsedModels;
+    // one loader at a time uploads; the others hand it what they parse
+    bool uploading = false;
+    bool stopping = false;
+    std::vector<std::thread> loaders;
+};
+
+} // namespace evilution
@@ -76,4 +76,26 @@ void EvilutionCamera::setViewYXZ(glm::vec3 position, glm::vec3 rotation) {
   viewMatrix[3][1] = -glm::dot(v, position);
   viewMatrix[3][2] = -glm::dot(w, position);
 }
+
+std::array<glm::vec4, 6> EvilutionCamera::getFrustumPlanes() const {
+  // Gribb/Hartmann extraction from the rows of projection * view, with a 0..1 depth range
+  glm::mat4 clip = projectionMatrix * viewMatrix;
+  auto row = [&clip](int i) { return glm::vec4{clip[0][i], clip[1][i], clip[2][i], clip[3][i]}; };
+
+  std::array<glm::vec4, 6> planes{
+      row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(2), row(3) - row(2)};
+  for (glm::vec4& plane : planes) {
+    plane = plane * (1.f / glm::length(glm::vec3{plane.x, plane.y, plane.z}));
+  }
+  return planes;
+}
+
+bool EvilutionCamera::isSphereInFrustum(const std::array<glm::vec4, 6>& planes, glm::vec3 center, float radius) {
+  for (const glm::vec4& plane : planes) {
+    if (glm::dot(glm::vec3{plane.x, plane.y, plane.z}, center) + plane.w < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
 } // namespace evilution
\ No newline at end of file
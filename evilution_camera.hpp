@@ -5,6 +5,9 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+// std
+#include <array>
+
 namespace evilution {
 
 class EvilutionCamera {
@@ -19,6 +22,10 @@ class EvilutionCamera {
 
         const glm::mat4& getProjection() const { return projectionMatrix; }
         const glm::mat4& getView() const { return viewMatrix; }
+
+        // world space planes of the current view and projection, normals facing inwards
+        std::array<glm::vec4, 6> getFrustumPlanes() const;
+        static bool isSphereInFrustum(const std::array<glm::vec4, 6>& planes, glm::vec3 center, float radius);
     private:
         glm::mat4 projectionMatrix{1.f};
         glm::mat4 viewMatrix{1.f};
@@ -1,11 +1,12 @@
 #pragma once
 
-#include "evilution_model.hpp"
+#include "evilution_resource_registry.hpp"
+#include "evilution_streamed_model_id.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
 // std
-#include <memory>
+#include <type_traits>
 
 namespace evilution {
 
@@ -36,12 +37,45 @@ struct TransformComponent {
 };
 
 struct RenderComponent {
-    std::shared_ptr<EvilutionModel> model;
+    ModelHandle model{};
     glm::vec3 color{};
 };
+static_assert(std::is_trivially_copyable<RenderComponent>::value, "RenderComponent is copied by value into storage");
 
+// drawn with whichever level of detail the EvilutionGeometryStreamer picks each frame, in place of
+// RenderComponent::model
+struct StreamedModelComponent {
+    StreamedModelId model = 0;
+};
+
+// Drawn from a command buffer that is recorded once and replayed every frame instead of being culled and recorded
+// again. Changing a static entity's transform or model records it again, so statics are meant to stay put.
+// Ignored on entities with a StreamedModelComponent, whose level of detail changes per frame.
+struct StaticComponent {};
+
+// the entity's slot in the GPU instance buffer, assigned and removed by EvilutionInstanceTracker
+struct InstanceSlotComponent {
+    uint32_t slot = 0;
+};
+
+// the view of the entity's TransformComponent; the first one found is rendered from
+struct CameraComponent {
+    float fovY = glm::radians(50.f);
+    float nearPlane = 0.1f;
+    float farPlane = 10.f;
+};
+
+// Bodies are spheres stepped by EvilutionPhysicsSystem, which owns the translation of their TransformComponent.
+// A mass of 0 makes a body kinematic. 2D bodies move in the xy plane.
 struct RigidBody2dComponent {
     glm::vec2 velocity;
     float mass{1.0f};
+    float radius{0.5f};
+};
+
+struct RigidBodyComponent {
+    glm::vec3 velocity{};
+    float mass{1.0f};
+    float radius{0.5f};
 };
 } // namespace evilution
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "evilution_deletion_queue.hpp"
+
+// std
+#include <utility>
+
+namespace evilution {
+
+EvilutionDeletionQueue::EvilutionDeletionQueue(VkDevice device, EvilutionTimeline& timeline)
+    : device{device}, timeline{timeline} {}
+
+EvilutionDeletionQueue::~EvilutionDeletionQueue() { flush(); }
+
+void EvilutionDeletionQueue::destroyBuffer(VkBuffer buffer, VkDeviceMemory memory) {
+    Retired retired{};
+    retired.buffer = buffer;
+    retired.memory = memory;
+    enqueue(retired);
+}
+
+void EvilutionDeletionQueue::destroyImage(VkImage image, VkImageView view, VkDeviceMemory memory) {
+    Retired retired{};
+    retired.image = image;
+    retired.view = view;
+    retired.memory = memory;
+    enqueue(retired);
+}
+
+void EvilutionDeletionQueue::destroyPipeline(VkPipeline pipeline) {
+    Retired retired{};
+    retired.pipeline = pipeline;
+    enqueue(retired);
+}
+
+void EvilutionDeletionQueue::freeMemory(VkDeviceMemory memory) {
+    Retired retired{};
+    retired.memory = memory;
+    enqueue(retired);
+}
+
+void EvilutionDeletionQueue::defer(std::function<void()> callback) {
+    Retired retired{};
+    retired.callback = std::move(callback);
+    enqueue(retired);
+}
+
+void EvilutionDeletionQueue::enqueue(const Retired& retired) {
+    std::lock_guard<std::mutex> lock{mutex};
+    unsubmitted.push_back(retired);
+}
+
+void EvilutionDeletionQueue::markFrameSubmitted(uint64_t timelineValue) {
+    std::lock_guard<std::mutex> lock{mutex};
+    for (Retired& retired : unsubmitted) {
+        retired.retireValue = timelineValue;
+        submitted.push_back(std::move(retired));
+    }
+    unsubmitted.clear();
+}
+
+void EvilutionDeletionQueue::collect() {
+    std::vector<Retired> completed;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        while (!submitted.empty() && timeline.isComplete(submitted.front().retireValue)) {
+            completed.push_back(std::move(submitted.front()));
+            submitted.pop_front();
+        }
+    }
+    // destroying can be slow on some drivers; do it without blocking threads that are queueing objects
+    for (const Retired& retired : completed) {
+        destroy(retired);
+    }
+}
+
+void EvilutionDeletionQueue::flush() {
+    std::vector<Retired> all;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        all.assign(submitted.begin(), submitted.end());
+        all.insert(all.end(), unsubmitted.begin(), unsubmitted.end());
+        submitted.clear();
+        unsubmitted.clear();
+    }
+    if (all.empty()) {
+        return;
+    }
+
+    timeline.wait(timeline.lastSubmittedValue());
+    for (const Retired& retired : all) {
+        destroy(retired);
+    }
+    // callbacks may have queued more, such as a pool releasing its buffers
+    flush();
+}
+
+size_t EvilutionDeletionQueue::getPendingCount() {
+    std::lock_guard<std::mutex> lock{mutex};
+    return unsubmitted.size() + submitted.size();
+}
+
+void EvilutionDeletionQueue::destroy(const Retired& retired) {
+    if (retired.view != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, retired.view, nullptr);
+    }
+    if (retired.image != VK_NULL_HANDLE) {
+        vkDestroyImage(device, retired.image, nullptr);
+    }
+    if (retired.buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(device, retired.buffer, nullptr);
+    }
+    if (retired.pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, retired.pipeline, nullptr);
+    }
+    if (retired.memory != VK_NULL_HANDLE) {
+        vkFreeMemory(device, retired.memory, nullptr);
+    }
+    if (retired.callback) {
+        retired.callback();
+    }
+}
+
+} // namespace evilution
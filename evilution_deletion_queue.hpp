@@ -0,0 +1,70 @@
+#pragma once
+
+#include "evilution_timeline.hpp"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace evilution {
+
+// Defers destroying Vulkan objects until the GPU has finished every frame that may have used them.
+// Objects can be queued from any thread. A frame being recorded when an object is queued has not been submitted
+// yet, so each object waits for the first frame submitted after it was queued, not the last value submitted.
+class EvilutionDeletionQueue {
+  public:
+    EvilutionDeletionQueue(VkDevice device, EvilutionTimeline& timeline);
+    ~EvilutionDeletionQueue();
+
+    EvilutionDeletionQueue(const EvilutionDeletionQueue&) = delete;
+    EvilutionDeletionQueue& operator=(const EvilutionDeletionQueue&) = delete;
+
+    // null handles are ignored
+    void destroyBuffer(VkBuffer buffer, VkDeviceMemory memory);
+    void destroyImage(VkImage image, VkImageView view, VkDeviceMemory memory);
+    void destroyPipeline(VkPipeline pipeline);
+    void freeMemory(VkDeviceMemory memory);
+    // For CPU-side bookkeeping that must wait for the GPU too, such as returning a buffer range to its
+    // allocator. Runs on the thread that calls collect() or flush().
+    void defer(std::function<void()> callback);
+
+    // Called with the timeline value of each frame's submission.
+    void markFrameSubmitted(uint64_t timelineValue);
+    // Destroys the objects whose frames have completed, without waiting.
+    void collect();
+    // Waits for all submitted work and destroys everything queued.
+    void flush();
+
+    size_t getPendingCount();
+
+  private:
+    struct Retired {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        std::function<void()> callback;
+        uint64_t retireValue = 0;
+    };
+
+    void enqueue(const Retired& retired);
+    void destroy(const Retired& retired);
+
+    VkDevice device;
+    EvilutionTimeline& timeline;
+
+    std::mutex mutex;
+    // queued since the last frame submission
+    std::vector<Retired> unsubmitted;
+    // ordered by retire value, since frames are submitted in timeline order
+    std::deque<Retired> submitted;
+};
+
+} // namespace evilution
@@ -0,0 +1,161 @@
+#include "evilution_descriptors.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace evilution {
+
+EvilutionDescriptorSetLayout::Builder& EvilutionDescriptorSetLayout::Builder::addBinding(
+    uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, uint32_t count) {
+    assert(bindings.count(binding) == 0 && "Binding already in use");
+    VkDescriptorSetLayoutBinding layoutBinding{};
+    layoutBinding.binding = binding;
+    layoutBinding.descriptorType = descriptorType;
+    layoutBinding.descriptorCount = count;
+    layoutBinding.stageFlags = stageFlags;
+    bindings[binding] = layoutBinding;
+    return *this;
+}
+
+std::unique_ptr<EvilutionDescriptorSetLayout> EvilutionDescriptorSetLayout::Builder::build() const {
+    return std::make_unique<EvilutionDescriptorSetLayout>(evilutionDevice, bindings);
+}
+
+EvilutionDescriptorSetLayout::EvilutionDescriptorSetLayout(
+    EvilutionDevice& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+    : evilutionDevice{device}, bindings{bindings} {
+    std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+    for (auto kv : bindings) {
+        setLayoutBindings.push_back(kv.second);
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
+    descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
+    descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
+
+    if (vkCreateDescriptorSetLayout(evilutionDevice.device(), &descriptorSetLayoutInfo, nullptr,
+                                    &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+}
+
+EvilutionDescriptorSetLayout::~EvilutionDescriptorSetLayout() {
+    vkDestroyDescriptorSetLayout(evilutionDevice.device(), descriptorSetLayout, nullptr);
+}
+
+EvilutionDescriptorPool::Builder& EvilutionDescriptorPool::Builder::addPoolSize(VkDescriptorType descriptorType,
+                                                                                uint32_t count) {
+    poolSizes.push_back({descriptorType, count});
+    return *this;
+}
+
+EvilutionDescriptorPool::Builder& EvilutionDescriptorPool::Builder::setPoolFlags(VkDescriptorPoolCreateFlags flags) {
+    poolFlags = flags;
+    return *this;
+}
+
+EvilutionDescriptorPool::Builder& EvilutionDescriptorPool::Builder::setMaxSets(uint32_t count) {
+    maxSets = count;
+    return *this;
+}
+
+std::unique_ptr<EvilutionDescriptorPool> EvilutionDescriptorPool::Builder::build() const {
+    return std::make_unique<EvilutionDescriptorPool>(evilutionDevice, maxSets, poolFlags, poolSizes);
+}
+
+EvilutionDescriptorPool::EvilutionDescriptorPool(EvilutionDevice& device, uint32_t maxSets,
+                                                 VkDescriptorPoolCreateFlags poolFlags,
+                                                 const std::vector<VkDescriptorPoolSize>& poolSizes)
+    : evilutionDevice{device} {
+    VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+    descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    descriptorPoolInfo.pPoolSizes = poolSizes.data();
+    descriptorPoolInfo.maxSets = maxSets;
+    descriptorPoolInfo.flags = poolFlags;
+
+    if (vkCreateDescriptorPool(evilutionDevice.device(), &descriptorPoolInfo, nullptr, &descriptorPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+}
+
+EvilutionDescriptorPool::~EvilutionDescriptorPool() {
+    vkDestroyDescriptorPool(evilutionDevice.device(), descriptorPool, nullptr);
+}
+
+bool EvilutionDescriptorPool::allocateDescriptor(VkDescriptorSetLayout descriptorSetLayout,
+                                                 VkDescriptorSet& descriptor) const {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+    allocInfo.descriptorSetCount = 1;
+
+    return vkAllocateDescriptorSets(evilutionDevice.device(), &allocInfo, &descriptor) == VK_SUCCESS;
+}
+
+void EvilutionDescriptorPool::freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const {
+    vkFreeDescriptorSets(evilutionDevice.device(), descriptorPool, static_cast<uint32_t>(descriptors.size()),
+                         descriptors.data());
+}
+
+void EvilutionDescriptorPool::resetPool() { vkResetDescriptorPool(evilutionDevice.device(), descriptorPool, 0); }
+
+EvilutionDescriptorWriter::EvilutionDescriptorWriter(EvilutionDescriptorSetLayout& setLayout,
+                                                     EvilutionDescriptorPool& pool)
+    : setLayout{setLayout}, pool{pool} {}
+
+EvilutionDescriptorWriter& EvilutionDescriptorWriter::writeBuffer(uint32_t binding,
+                                                                  const VkDescriptorBufferInfo* bufferInfo) {
+    assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
+    const auto& bindingDescription = setLayout.bindings[binding];
+    assert(bindingDescription.descriptorCount == 1 && "Binding single descriptor info, but binding expects multiple");
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.descriptorType = bindingDescription.descriptorType;
+    write.dstBinding = binding;
+    write.pBufferInfo = bufferInfo;
+    write.descriptorCount = 1;
+
+    writes.push_back(write);
+    return *this;
+}
+
+EvilutionDescriptorWriter& EvilutionDescriptorWriter::writeImage(uint32_t binding,
+                                                                 const VkDescriptorImageInfo* imageInfo) {
+    assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
+    const auto& bindingDescription = setLayout.bindings[binding];
+    assert(bindingDescription.descriptorCount == 1 && "Binding single descriptor info, but binding expects multiple");
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.descriptorType = bindingDescription.descriptorType;
+    write.dstBinding = binding;
+    write.pImageInfo = imageInfo;
+    write.descriptorCount = 1;
+
+    writes.push_back(write);
+    return *this;
+}
+
+bool EvilutionDescriptorWriter::build(VkDescriptorSet& set) {
+    if (!pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set)) {
+        return false;
+    }
+    overwrite(set);
+    return true;
+}
+
+void EvilutionDescriptorWriter::overwrite(VkDescriptorSet& set) {
+    for (auto& write : writes) {
+        write.dstSet = set;
+    }
+    vkUpdateDescriptorSets(pool.evilutionDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0,
+                           nullptr);
+}
+
+} // namespace evilution
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "evilution_device.hpp"
+
+// std
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace evilution {
+
+class EvilutionDescriptorSetLayout {
+  public:
+    class Builder {
+      public:
+        explicit Builder(EvilutionDevice& device) : evilutionDevice{device} {}
+
+        Builder& addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags,
+                            uint32_t count = 1);
+        std::unique_ptr<EvilutionDescriptorSetLayout> build() const;
+
+      private:
+        EvilutionDevice& evilutionDevice;
+        std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+    };
+
+    EvilutionDescriptorSetLayout(EvilutionDevice& device,
+                                 std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+    ~EvilutionDescriptorSetLayout();
+
+    EvilutionDescriptorSetLayout(const EvilutionDescriptorSetLayout&) = delete;
+    EvilutionDescriptorSetLayout& operator=(const EvilutionDescriptorSetLayout&) = delete;
+
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+
+  private:
+    EvilutionDevice& evilutionDevice;
+    VkDescriptorSetLayout descriptorSetLayout;
+    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+
+    friend class EvilutionDescriptorWriter;
+};
+
+class EvilutionDescriptorPool {
+  public:
+    class Builder {
+      public:
+        explicit Builder(EvilutionDevice& device) : evilutionDevice{device} {}
+
+        Builder& addPoolSize(VkDescriptorType descriptorType, uint32_t count);
+        Builder& setPoolFlags(VkDescriptorPoolCreateFlags flags);
+        Builder& setMaxSets(uint32_t count);
+        std::unique_ptr<EvilutionDescriptorPool> build() const;
+
+      private:
+        EvilutionDevice& evilutionDevice;
+        std::vector<VkDescriptorPoolSize> poolSizes{};
+        uint32_t maxSets = 1000;
+        VkDescriptorPoolCreateFlags poolFlags = 0;
+    };
+
+    EvilutionDescriptorPool(EvilutionDevice& device, uint32_t maxSets, VkDescriptorPoolCreateFlags poolFlags,
+                            const std::vector<VkDescriptorPoolSize>& poolSizes);
+    ~EvilutionDescriptorPool();
+
+    EvilutionDescriptorPool(const EvilutionDescriptorPool&) = delete;
+    EvilutionDescriptorPool& operator=(const EvilutionDescriptorPool&) = delete;
+
+    // false when the pool has run out of room for the set
+    bool allocateDescriptor(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const;
+    void freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const;
+    void resetPool();
+
+  private:
+    EvilutionDevice& evilutionDevice;
+    VkDescriptorPool descriptorPool;
+
+    friend class EvilutionDescriptorWriter;
+};
+
+// Collects writes for one set and applies them together. The infos are referenced, not copied, so they have to
+// outlive build() or overwrite().
+class EvilutionDescriptorWriter {
+  public:
+    EvilutionDescriptorWriter(EvilutionDescriptorSetLayout& setLayout, EvilutionDescriptorPool& pool);
+
+    EvilutionDescriptorWriter& writeBuffer(uint32_t binding, const VkDescriptorBufferInfo* bufferInfo);
+    EvilutionDescriptorWriter& writeImage(uint32_t binding, const VkDescriptorImageInfo* imageInfo);
+
+    bool build(VkDescriptorSet& set);
+    // updates a set allocated earlier, which the GPU must no longer be using
+    void overwrite(VkDescriptorSet& set);
+
+  private:
+    EvilutionDescriptorSetLayout& setLayout;
+    EvilutionDescriptorPool& pool;
+    std::vector<VkWriteDescriptorSet> writes;
+};
+
+} // namespace evilution
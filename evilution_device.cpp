@@ -1,6 +1,7 @@
 #include "evilution_device.hpp"
 
 // std headers
+#include <cassert>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -44,12 +45,18 @@ EvilutionDevice::EvilutionDevice(EvilutionWindow& window) : window{window} {
     setupDebugMessenger();
     createSurface();
     pickPhysicalDevice();
+    queryOptionalFeatures();
     createLogicalDevice();
+    loadDeviceFunctions();
     createCommandPool();
 }
 
 EvilutionDevice::~EvilutionDevice() {
+    // flushes whatever is still queued, which needs the timeline
+    deletionQueue_.reset();
+    timeline_.reset();
     vkDestroyCommandPool(device_, commandPool, nullptr);
+    vkDestroyCommandPool(device_, uploadCommandPool, nullptr);
     vkDestroyDevice(device_, nullptr);
 
     if (enableValidationLayers) {
@@ -71,7 +78,7 @@ void EvilutionDevice::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_3;
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -125,6 +132,52 @@ void EvilutionDevice::pickPhysicalDevice() {
     std::cout << "physical device: " << properties.deviceName << std::endl;
 }
 
+void EvilutionDevice::queryOptionalFeatures() {
+    if (checkOptionalDeviceExtension(physicalDevice, VK_EXT_PIPELINE_CREATION_CACHE_CONTROL_EXTENSION_NAME)) {
+        VkPhysicalDevicePipelineCreationCacheControlFeaturesEXT cacheControlFeatures{};
+        cacheControlFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PIPELINE_CREATION_CACHE_CONTROL_FEATURES_EXT;
+
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &cacheControlFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+        pipelineCacheControlEnabled = cacheControlFeatures.pipelineCreationCacheControl == VK_TRUE;
+    }
+    std::cout << "pipeline creation cache control: " << (pipelineCacheControlEnabled ? "yes" : "no") << std::endl;
+
+    dynamicRenderingIsCore = properties.apiVersion >= VK_API_VERSION_1_3;
+    if (dynamicRenderingIsCore ||
+        checkOptionalDeviceExtension(physicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+        VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &dynamicRenderingFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+        dynamicRenderingEnabled = dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+    }
+    std::cout << "dynamic rendering: " << (dynamicRenderingEnabled ? "yes" : "no") << std::endl;
+
+    // no features to enable, only properties to query
+    memoryBudgetEnabled = checkOptionalDeviceExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    std::cout << "memory budget: " << (memoryBudgetEnabled ? "yes" : "no") << std::endl;
+
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    multiDrawIndirectEnabled =
+        supportedFeatures.multiDrawIndirect == VK_TRUE && supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+    std::cout << "multi draw indirect: " << (multiDrawIndirectEnabled ? "yes" : "no") << std::endl;
+
+    // core from 1.2 as well, but only behind VkPhysicalDeviceVulkan12Features, which cannot share the feature chain
+    // with the timeline semaphore features enabled below
+    drawIndirectCountEnabled =
+        checkOptionalDeviceExtension(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    std::cout << "draw indirect count: " << (drawIndirectCountEnabled ? "yes" : "no") << std::endl;
+}
+
 void EvilutionDevice::createLogicalDevice() {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
@@ -143,6 +196,8 @@ void EvilutionDevice::createLogicalDevice() {
 
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.multiDrawIndirect = multiDrawIndirectEnabled ? VK_TRUE : VK_FALSE;
+    deviceFeatures.drawIndirectFirstInstance = multiDrawIndirectEnabled ? VK_TRUE : VK_FALSE;
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -151,8 +206,42 @@ void EvilutionDevice::createLogicalDevice() {
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+    createInfo.pNext = &timelineFeatures;
+
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+    void** featureChainTail = &timelineFeatures.pNext;
+
+    VkPhysicalDevicePipelineCreationCacheControlFeaturesEXT cacheControlFeatures{};
+    cacheControlFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PIPELINE_CREATION_CACHE_CONTROL_FEATURES_EXT;
+    if (pipelineCacheControlEnabled) {
+        enabledExtensions.push_back(VK_EXT_PIPELINE_CREATION_CACHE_CONTROL_EXTENSION_NAME);
+        cacheControlFeatures.pipelineCreationCacheControl = VK_TRUE;
+        *featureChainTail = &cacheControlFeatures;
+        featureChainTail = &cacheControlFeatures.pNext;
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+    if (dynamicRenderingEnabled) {
+        if (!dynamicRenderingIsCore) {
+            enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        }
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+        *featureChainTail = &dynamicRenderingFeatures;
+        featureChainTail = &dynamicRenderingFeatures.pNext;
+    }
+    if (memoryBudgetEnabled) {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    if (drawIndirectCountEnabled) {
+        enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     // might not really be necessary anymore because device specific
     // validation layers have been deprecated
@@ -169,6 +258,47 @@ void EvilutionDevice::createLogicalDevice() {
 
     vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
     vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+    timeline_ = std::make_unique<EvilutionTimeline>(device_);
+    deletionQueue_ = std::make_unique<EvilutionDeletionQueue>(device_, *timeline_);
+}
+
+void EvilutionDevice::loadDeviceFunctions() {
+    if (dynamicRenderingEnabled) {
+        cmdBeginRenderingFunction = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+            vkGetDeviceProcAddr(device_, dynamicRenderingIsCore ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR"));
+        cmdEndRenderingFunction = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+            vkGetDeviceProcAddr(device_, dynamicRenderingIsCore ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR"));
+        if (cmdBeginRenderingFunction == nullptr || cmdEndRenderingFunction == nullptr) {
+            throw std::runtime_error("failed to load dynamic rendering functions!");
+        }
+    }
+
+    if (drawIndirectCountEnabled) {
+        cmdDrawIndexedIndirectCountFunction = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(device_, "vkCmdDrawIndexedIndirectCountKHR"));
+        if (cmdDrawIndexedIndirectCountFunction == nullptr) {
+            throw std::runtime_error("failed to load draw indirect count functions!");
+        }
+    }
+}
+
+void EvilutionDevice::cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo& renderingInfo) {
+    assert(dynamicRenderingEnabled && "Dynamic rendering is not enabled on this device");
+    cmdBeginRenderingFunction(commandBuffer, &renderingInfo);
+}
+
+void EvilutionDevice::cmdEndRendering(VkCommandBuffer commandBuffer) {
+    assert(dynamicRenderingEnabled && "Dynamic rendering is not enabled on this device");
+    cmdEndRenderingFunction(commandBuffer);
+}
+
+void EvilutionDevice::cmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                                  VkBuffer countBuffer, VkDeviceSize countBufferOffset,
+                                                  uint32_t maxDrawCount, uint32_t stride) {
+    assert(drawIndirectCountEnabled && "Draw indirect count is not enabled on this device");
+    cmdDrawIndexedIndirectCountFunction(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount,
+                                        stride);
 }
 
 void EvilutionDevice::createCommandPool() {
@@ -182,6 +312,12 @@ void EvilutionDevice::createCommandPool() {
     if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
+
+    // loader threads upload while the render thread records, and a pool can only be used by one at a time
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    if (vkCreateCommandPool(device_, &poolInfo, nullptr, &uploadCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
 }
 
 void EvilutionDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
@@ -200,7 +336,22 @@ bool EvilutionDevice::isDeviceSuitable(VkPhysicalDevice device) {
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+    // frame and upload synchronization is built on timeline semaphores, core since 1.2
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    bool timelineSupported = false;
+    if (deviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &timelineFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+        timelineSupported = timelineFeatures.timelineSemaphore == VK_TRUE;
+    }
+
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy &&
+           timelineSupported;
 }
 
 void EvilutionDevice::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -303,6 +454,21 @@ bool EvilutionDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+bool EvilutionDevice::checkOptionalDeviceExtension(VkPhysicalDevice device, const char* extensionName) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 QueueFamilyIndices EvilutionDevice::findQueueFamilies(VkPhysicalDevice device) {
     QueueFamilyIndices indices;
 
@@ -383,6 +549,32 @@ uint32_t EvilutionDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFl
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
+DeviceMemoryBudget EvilutionDevice::queryDeviceLocalMemoryBudget() {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memProperties2{};
+    memProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memProperties2.pNext = memoryBudgetEnabled ? &budgetProperties : nullptr;
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memProperties2);
+
+    const VkPhysicalDeviceMemoryProperties& memProperties = memProperties2.memoryProperties;
+    DeviceMemoryBudget result{};
+    result.reported = memoryBudgetEnabled;
+    for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+        if ((memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0) {
+            continue;
+        }
+        if (memoryBudgetEnabled) {
+            result.budget += budgetProperties.heapBudget[i];
+            result.usage += budgetProperties.heapUsage[i];
+        } else {
+            result.budget += memProperties.memoryHeaps[i].size;
+        }
+    }
+    return result;
+}
+
 void EvilutionDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
                                    VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
     VkBufferCreateInfo bufferInfo{};
@@ -410,53 +602,70 @@ void EvilutionDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
     vkBindBufferMemory(device_, buffer, bufferMemory, 0);
 }
 
-VkCommandBuffer EvilutionDevice::beginSingleTimeCommands() {
+EvilutionDevice::SingleTimeCommands::SingleTimeCommands(EvilutionDevice& device)
+    : evilutionDevice{device}, poolLock{device.uploadPoolMutex} {
+    // recording into a buffer uses its pool too, so the lock is held until submitAndWait submits
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
+    allocInfo.commandPool = device.uploadCommandPool;
     allocInfo.commandBufferCount = 1;
 
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+    if (vkAllocateCommandBuffers(device.device_, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-    return commandBuffer;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        // the destructor does not run for a constructor that throws
+        vkFreeCommandBuffers(device.device_, device.uploadCommandPool, 1, &commandBuffer);
+        throw std::runtime_error("failed to begin recording upload command buffer!");
+    }
 }
 
-void EvilutionDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-    vkEndCommandBuffer(commandBuffer);
+EvilutionDevice::SingleTimeCommands::~SingleTimeCommands() {
+    if (!poolLock.owns_lock()) {
+        poolLock.lock();
+    }
+    vkFreeCommandBuffers(evilutionDevice.device_, evilutionDevice.uploadCommandPool, 1, &commandBuffer);
+}
+
+void EvilutionDevice::SingleTimeCommands::submitAndWait() {
+    assert(poolLock.owns_lock() && "Upload command buffer was already submitted");
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue_);
+    uint64_t uploadValue = evilutionDevice.timeline_->submit(evilutionDevice.graphicsQueue_, submitInfo);
+    poolLock.unlock();
 
-    vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+    // waits for this upload only, not for frames that are still in flight on the same queue
+    evilutionDevice.timeline_->wait(uploadValue);
 }
 
 void EvilutionDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    SingleTimeCommands commands = beginSingleTimeCommands();
 
     VkBufferCopy copyRegion{};
     copyRegion.srcOffset = 0; // Optional
     copyRegion.dstOffset = 0; // Optional
     copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    vkCmdCopyBuffer(commands.get(), srcBuffer, dstBuffer, 1, &copyRegion);
 
-    endSingleTimeCommands(commandBuffer);
+    commands.submitAndWait();
 }
 
 void EvilutionDevice::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height,
                                         uint32_t layerCount) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    SingleTimeCommands commands = beginSingleTimeCommands();
 
     VkBufferImageCopy region{};
     region.bufferOffset = 0;
@@ -471,8 +680,8 @@ void EvilutionDevice::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t
     region.imageOffset = {0, 0, 0};
     region.imageExtent = {width, height, 1};
 
-    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-    endSingleTimeCommands(commandBuffer);
+    vkCmdCopyBufferToImage(commands.get(), buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    commands.submitAndWait();
 }
 
 void EvilutionDevice::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties,
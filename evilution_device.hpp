@@ -1,8 +1,12 @@
 #pragma once
 
+#include "evilution_deletion_queue.hpp"
+#include "evilution_timeline.hpp"
 #include "evilution_window.hpp"
 
 // std lib headers
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace evilution {
@@ -21,6 +25,16 @@ struct QueueFamilyIndices {
     bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
+// summed over the device-local heaps
+struct DeviceMemoryBudget {
+    // what the process can use before the driver starts paging; the heap sizes when not reported
+    VkDeviceSize budget = 0;
+    // by this process, all allocations included; 0 when not reported
+    VkDeviceSize usage = 0;
+    // false without VK_EXT_memory_budget, in which case the numbers do not reflect other processes
+    bool reported = false;
+};
+
 class EvilutionDevice {
   public:
 #ifdef NDEBUG
@@ -38,11 +52,32 @@ class EvilutionDevice {
     EvilutionDevice(EvilutionDevice&&) = delete;
     EvilutionDevice& operator=(EvilutionDevice&&) = delete;
 
+    // the render thread's pool; other threads record through beginSingleTimeCommands, which has its own
     VkCommandPool getCommandPool() { return commandPool; }
     VkDevice device() { return device_; }
     VkSurfaceKHR surface() { return surface_; }
     VkQueue graphicsQueue() { return graphicsQueue_; }
     VkQueue presentQueue() { return presentQueue_; }
+    // every graphics queue submission signals this, frames and uploads alike
+    EvilutionTimeline& timeline() { return *timeline_; }
+    // objects the GPU may still be using are destroyed through this instead of immediately
+    EvilutionDeletionQueue& deletionQueue() { return *deletionQueue_; }
+    bool pipelineCacheControlSupported() const { return pipelineCacheControlEnabled; }
+    bool dynamicRenderingSupported() const { return dynamicRenderingEnabled; }
+    bool memoryBudgetSupported() const { return memoryBudgetEnabled; }
+    // multiDrawIndirect together with drawIndirectFirstInstance, for draws generated on the GPU
+    bool multiDrawIndirectSupported() const { return multiDrawIndirectEnabled; }
+    bool drawIndirectCountSupported() const { return drawIndirectCountEnabled; }
+    // current values; cheap enough to poll every few frames
+    DeviceMemoryBudget queryDeviceLocalMemoryBudget();
+
+    // vkCmdBeginRendering / vkCmdEndRendering, resolved to the core or KHR entry point; dynamic rendering only
+    void cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo& renderingInfo);
+    void cmdEndRendering(VkCommandBuffer commandBuffer);
+    // vkCmdDrawIndexedIndirectCountKHR; VK_KHR_draw_indirect_count only
+    void cmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                     VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount,
+                                     uint32_t stride);
 
     SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -53,8 +88,29 @@ class EvilutionDevice {
     // Buffer Helper Functions
     void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer,
                       VkDeviceMemory& bufferMemory);
-    VkCommandBuffer beginSingleTimeCommands();
-    void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+    // One upload recorded on the device's upload pool, which stays locked from construction until
+    // submitAndWait() has submitted. Destroyed without submitting, for instance when recording throws, it frees
+    // the command buffer and unlocks the pool.
+    class SingleTimeCommands {
+      public:
+        explicit SingleTimeCommands(EvilutionDevice& device);
+        ~SingleTimeCommands();
+
+        SingleTimeCommands(const SingleTimeCommands&) = delete;
+        SingleTimeCommands& operator=(const SingleTimeCommands&) = delete;
+
+        VkCommandBuffer get() const { return commandBuffer; }
+        // Waits for this upload only, with the pool unlocked so other threads can record theirs meanwhile.
+        void submitAndWait();
+
+      private:
+        EvilutionDevice& evilutionDevice;
+        std::unique_lock<std::mutex> poolLock;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    };
+
+    // Any thread.
+    SingleTimeCommands beginSingleTimeCommands() { return SingleTimeCommands{*this}; }
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
     void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -68,7 +124,9 @@ class EvilutionDevice {
     void setupDebugMessenger();
     void createSurface();
     void pickPhysicalDevice();
+    void queryOptionalFeatures();
     void createLogicalDevice();
+    void loadDeviceFunctions();
     void createCommandPool();
 
     // helper functions
@@ -79,6 +137,7 @@ class EvilutionDevice {
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
     void hasGflwRequiredInstanceExtensions();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool checkOptionalDeviceExtension(VkPhysicalDevice device, const char* extensionName);
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
     VkInstance instance;
@@ -86,14 +145,31 @@ class EvilutionDevice {
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     EvilutionWindow& window;
     VkCommandPool commandPool;
+    VkCommandPool uploadCommandPool;
+    std::mutex uploadPoolMutex;
 
     VkDevice device_;
     VkSurfaceKHR surface_;
     VkQueue graphicsQueue_;
     VkQueue presentQueue_;
+    std::unique_ptr<EvilutionTimeline> timeline_;
+    std::unique_ptr<EvilutionDeletionQueue> deletionQueue_;
 
     const std::vector<const char*> validationLayers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+
+    // optional features, enabled only when the physical device supports them
+    bool pipelineCacheControlEnabled = false;
+    bool dynamicRenderingEnabled = false;
+    bool memoryBudgetEnabled = false;
+    bool multiDrawIndirectEnabled = false;
+    bool drawIndirectCountEnabled = false;
+    // dynamic rendering is core from 1.3, older devices need the KHR extension
+    bool dynamicRenderingIsCore = false;
+
+    PFN_vkCmdBeginRenderingKHR cmdBeginRenderingFunction = nullptr;
+    PFN_vkCmdEndRenderingKHR cmdEndRenderingFunction = nullptr;
+    PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCountFunction = nullptr;
 };
 
 } // namespace evilution
\ No newline at end of file
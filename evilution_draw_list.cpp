@@ -0,0 +1,122 @@
+#include "evilution_draw_list.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace evilution {
+
+uint64_t makeDrawSortKey(uint32_t pipeline, ModelHandle model, float normalizedDepth) {
+    constexpr uint32_t depthMax = (1u << DRAW_KEY_DEPTH_BITS) - 1;
+    float depth = std::min(std::max(normalizedDepth, 0.f), 1.f);
+    uint64_t depthBucket = static_cast<uint64_t>(depth * static_cast<float>(depthMax));
+    uint64_t pipelineBits = pipeline & ((1u << DRAW_KEY_PIPELINE_BITS) - 1);
+
+    return (pipelineBits << (64 - DRAW_KEY_PIPELINE_BITS)) |
+           (static_cast<uint64_t>(model.value) << DRAW_KEY_DEPTH_BITS) | depthBucket;
+}
+
+void radixSortDrawItems(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch) {
+    const size_t count = items.size();
+    if (count < 2) {
+        return;
+    }
+    scratch.resize(count);
+
+    // all eight histograms in one pass over the keys
+    std::array<std::array<uint32_t, 256>, 8> histograms{};
+    for (const DrawItem& item : items) {
+        for (uint32_t pass = 0; pass < 8; pass++) {
+            histograms[pass][(item.key >> (pass * 8)) & 0xff]++;
+        }
+    }
+
+    DrawItem* source = items.data();
+    DrawItem* destination = scratch.data();
+    for (uint32_t pass = 0; pass < 8; pass++) {
+        auto& histogram = histograms[pass];
+        uint32_t shift = pass * 8;
+        if (histogram[(source[0].key >> shift) & 0xff] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram) {
+            uint32_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; i++) {
+            destination[histogram[(source[i].key >> shift) & 0xff]++] = source[i];
+        }
+        std::swap(source, destination);
+    }
+
+    if (source != items.data()) {
+        std::copy(source, source + count, items.data());
+    }
+}
+
+DrawStats& DrawStats::operator+=(const DrawStats& other) {
+    draws += other.draws;
+    pipelineBinds += other.pipelineBinds;
+    vertexBufferBinds += other.vertexBufferBinds;
+    indexBufferBinds += other.indexBufferBinds;
+    skippedBinds += other.skippedBinds;
+    return *this;
+}
+
+void DrawStats::print(std::ostream& out) const {
+    out << "draws: " << draws << ", pipeline binds: " << pipelineBinds << ", vertex buffer binds: "
+        << vertexBufferBinds << ", index buffer binds: " << indexBufferBinds << ", redundant binds skipped: "
+        << skippedBinds << std::endl;
+}
+
+void EvilutionBindTracker::reset() {
+    boundPipeline = nullptr;
+    boundVertexBuffer = VK_NULL_HANDLE;
+    boundIndexBuffer = VK_NULL_HANDLE;
+    stats = {};
+}
+
+void EvilutionBindTracker::bindPipeline(VkCommandBuffer commandBuffer, EvilutionPipeline& pipeline) {
+    if (boundPipeline == &pipeline) {
+        stats.skippedBinds++;
+        return;
+    }
+    pipeline.bind(commandBuffer);
+    boundPipeline = &pipeline;
+    stats.pipelineBinds++;
+}
+
+void EvilutionBindTracker::bindVertexBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer) {
+    if (boundVertexBuffer == buffer) {
+        stats.skippedBinds++;
+        return;
+    }
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &buffer, &offset);
+    boundVertexBuffer = buffer;
+    stats.vertexBufferBinds++;
+}
+
+void EvilutionBindTracker::bindIndexBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer) {
+    if (boundIndexBuffer == buffer) {
+        stats.skippedBinds++;
+        return;
+    }
+    vkCmdBindIndexBuffer(commandBuffer, buffer, 0, VK_INDEX_TYPE_UINT32);
+    boundIndexBuffer = buffer;
+    stats.indexBufferBinds++;
+}
+
+void EvilutionBindTracker::bindGeometry(VkCommandBuffer commandBuffer, const GeometryRange& geometry) {
+    // models share the pool's buffers, so after the first draw these are skipped
+    bindVertexBuffer(commandBuffer, geometry.vertexBuffer);
+    if (geometry.indexCount > 0) {
+        bindIndexBuffer(commandBuffer, geometry.indexBuffer);
+    }
+}
+
+} // namespace evilution
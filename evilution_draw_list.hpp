@@ -0,0 +1,69 @@
+#pragma once
+
+#include "evilution_model.hpp"
+#include "evilution_pipeline.hpp"
+#include "evilution_resource_registry.hpp"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace evilution {
+
+// Draws are ordered by a packed key so that draws sharing a pipeline, then a model, end up next to each other,
+// front to back within a model. From the most significant bits: pipeline (12), model handle (32), depth (20).
+struct DrawItem {
+    uint64_t key;
+    // index into the snapshot's objects
+    uint32_t object;
+};
+
+constexpr uint32_t DRAW_KEY_PIPELINE_BITS = 12;
+constexpr uint32_t DRAW_KEY_DEPTH_BITS = 20;
+
+// normalizedDepth is clamped to [0, 1], with 0 at the near plane
+uint64_t makeDrawSortKey(uint32_t pipeline, ModelHandle model, float normalizedDepth);
+
+// Stable LSD radix sort by key, one byte per pass. Passes where every key has the same byte are skipped, which
+// is most of them when only a few pipelines and models are in use. scratch is resized as needed.
+void radixSortDrawItems(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch);
+
+struct DrawStats {
+    uint64_t draws = 0;
+    uint64_t pipelineBinds = 0;
+    uint64_t vertexBufferBinds = 0;
+    uint64_t indexBufferBinds = 0;
+    // binds skipped because the same object was already bound
+    uint64_t skippedBinds = 0;
+
+    DrawStats& operator+=(const DrawStats& other);
+    void print(std::ostream& out) const;
+};
+
+// Remembers what is bound in a command buffer and only records binds that change it.
+class EvilutionBindTracker {
+  public:
+    // call when starting a command buffer, since bindings do not carry over between them
+    void reset();
+
+    void bindPipeline(VkCommandBuffer commandBuffer, EvilutionPipeline& pipeline);
+    void bindVertexBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer);
+    void bindIndexBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer);
+    // the draw has to use the same range the binds were made for
+    void bindGeometry(VkCommandBuffer commandBuffer, const GeometryRange& geometry);
+    void countDraw() { stats.draws++; }
+
+    const DrawStats& getStats() const { return stats; }
+
+  private:
+    EvilutionPipeline* boundPipeline = nullptr;
+    VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+    VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+    DrawStats stats{};
+};
+
+} // namespace evilution
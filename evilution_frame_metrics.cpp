@@ -0,0 +1,86 @@
+#include "evilution_frame_metrics.hpp"
+#include "evilution_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+namespace evilution {
+
+namespace {
+
+void pushSample(std::vector<float>& values, size_t index, float value, size_t maxSamples) {
+    if (values.size() < maxSamples) {
+        values.push_back(value);
+    } else {
+        values[index % maxSamples] = value;
+    }
+}
+
+double mean(const std::vector<float>& values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    return std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+}
+
+double percentile(std::vector<float> values, double fraction) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * static_cast<double>(values.size())));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+} // namespace
+
+void EvilutionFrameMetrics::recordFrame(VkPresentModeKHR presentMode, uint32_t framesInFlight, double cpuBlockedMs) {
+    auto now = Clock::now();
+    auto& config = samples[{presentMode, framesInFlight}];
+    size_t index = config.recorded++;
+
+    double inputToPresentMs = std::chrono::duration<double, std::milli>(now - inputSampleTime).count();
+    pushSample(config.inputToPresentMs, index, static_cast<float>(inputToPresentMs), MAX_SAMPLES);
+    pushSample(config.cpuBlockedMs, index, static_cast<float>(cpuBlockedMs), MAX_SAMPLES);
+    if (lastPresentTime != Clock::time_point{}) {
+        double intervalMs = std::chrono::duration<double, std::milli>(now - lastPresentTime).count();
+        pushSample(config.frameIntervalMs, index, static_cast<float>(intervalMs), MAX_SAMPLES);
+    }
+    lastPresentTime = now;
+}
+
+EvilutionFrameMetrics::Summary EvilutionFrameMetrics::summarize(VkPresentModeKHR presentMode,
+                                                                uint32_t framesInFlight) const {
+    Summary summary{};
+    auto it = samples.find({presentMode, framesInFlight});
+    if (it == samples.end()) {
+        return summary;
+    }
+
+    const Samples& config = it->second;
+    summary.frames = config.inputToPresentMs.size();
+    summary.meanInputToPresentMs = mean(config.inputToPresentMs);
+    summary.p99InputToPresentMs = percentile(config.inputToPresentMs, 0.99);
+    summary.meanCpuBlockedMs = mean(config.cpuBlockedMs);
+    summary.p99CpuBlockedMs = percentile(config.cpuBlockedMs, 0.99);
+    summary.meanFrameIntervalMs = mean(config.frameIntervalMs);
+    return summary;
+}
+
+void EvilutionFrameMetrics::printReport(std::ostream& out) const {
+    out << "frame latency by configuration (input-to-present / cpu blocked, mean & p99 in ms):" << std::endl;
+    for (const auto& kv : samples) {
+        Summary summary = summarize(kv.first.first, kv.first.second);
+        out << "\t" << std::left << std::setw(13) << EvilutionSwapChain::presentModeName(kv.first.first)
+            << " x" << kv.first.second << std::right << std::fixed << std::setprecision(2)
+            << "  frames " << std::setw(7) << summary.frames << "  latency " << std::setw(7)
+            << summary.meanInputToPresentMs << " / " << std::setw(7) << summary.p99InputToPresentMs
+            << "  blocked " << std::setw(7) << summary.meanCpuBlockedMs << " / " << std::setw(7)
+            << summary.p99CpuBlockedMs << "  interval " << std::setw(7) << summary.meanFrameIntervalMs << std::endl;
+    }
+    out.unsetf(std::ios::floatfield);
+}
+
+} // namespace evilution
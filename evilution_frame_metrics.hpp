@@ -0,0 +1,60 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace evilution {
+
+// Collects per-frame latency samples grouped by (present mode, frames in flight) so configurations can be
+// compared from data gathered on the target machine.
+class EvilutionFrameMetrics {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Summary {
+        uint64_t frames = 0;
+        double meanInputToPresentMs = 0.0;
+        double p99InputToPresentMs = 0.0;
+        double meanCpuBlockedMs = 0.0;
+        double p99CpuBlockedMs = 0.0;
+        double meanFrameIntervalMs = 0.0;
+    };
+
+    // call right after input has been polled for the frame that is about to be recorded
+    void markInputSampled() { inputSampleTime = Clock::now(); }
+    // for frames built from input sampled earlier, possibly on another thread
+    void markInputSampled(Clock::time_point sampleTime) { inputSampleTime = sampleTime; }
+
+    // input-to-present is measured on the CPU, from markInputSampled until vkQueuePresentKHR returns
+    void recordFrame(VkPresentModeKHR presentMode, uint32_t framesInFlight, double cpuBlockedMs);
+
+    Summary summarize(VkPresentModeKHR presentMode, uint32_t framesInFlight) const;
+    void printReport(std::ostream& out) const;
+    void reset() { samples.clear(); }
+
+  private:
+    struct Samples {
+        std::vector<float> inputToPresentMs;
+        std::vector<float> cpuBlockedMs;
+        std::vector<float> frameIntervalMs;
+        size_t recorded = 0;
+    };
+    // bounds memory when a configuration runs for a long time; older samples are overwritten
+    static constexpr size_t MAX_SAMPLES = 16384;
+
+    using ConfigKey = std::pair<VkPresentModeKHR, uint32_t>;
+
+    std::map<ConfigKey, Samples> samples;
+    Clock::time_point inputSampleTime = Clock::now();
+    Clock::time_point lastPresentTime{};
+};
+
+} // namespace evilution
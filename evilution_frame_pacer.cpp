@@ -0,0 +1,204 @@
+#include "evilution_frame_pacer.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <thread>
+
+namespace evilution {
+
+namespace {
+using MillisecondsDouble = std::chrono::duration<double, std::milli>;
+
+double toMilliseconds(EvilutionFramePacer::Clock::duration duration) {
+    return std::chrono::duration_cast<MillisecondsDouble>(duration).count();
+}
+
+EvilutionFramePacer::Clock::duration fromMilliseconds(double milliseconds) {
+    return std::chrono::duration_cast<EvilutionFramePacer::Clock::duration>(MillisecondsDouble{milliseconds});
+}
+
+// weight given to the newest sample in the moving averages
+constexpr double EMA_ALPHA = 0.1;
+// headroom on the work estimate when starting a frame against the predicted present
+constexpr double WORK_MARGIN = 1.25;
+} // namespace
+
+EvilutionFramePacer::EvilutionFramePacer(double targetFrameRate) {
+    setTargetFrameRate(targetFrameRate);
+    lastFrameStart = nextFrameStart;
+}
+
+void EvilutionFramePacer::setTargetFrameRate(double targetFrameRate) {
+    this->targetFrameRate = std::max(0.0, targetFrameRate);
+    targetPeriod = this->targetFrameRate > 0.0 ? fromMilliseconds(1000.0 / this->targetFrameRate) : Clock::duration{};
+    rateDivisor = 1;
+    windowFrames = 0;
+    windowMisses = 0;
+    cleanWindows = 0;
+    nextFrameStart = Clock::now();
+    // intervals presented under the old pacing say nothing about the new one
+    lastPresentTime = nextFrameStart;
+    presentIntervalEstimateMs = 0.0;
+}
+
+double EvilutionFramePacer::getEffectiveFrameRate() const { return targetFrameRate / rateDivisor; }
+
+EvilutionFramePacer::Clock::time_point EvilutionFramePacer::waitForNextFrame() {
+    auto now = Clock::now();
+    // nothing has been worked on before the first frame, so the estimate starts from the second
+    if (frames > 0) {
+        double workMs = toMilliseconds(now - lastFrameStart);
+        workEstimateMs = frames == 1 ? workMs : workEstimateMs + EMA_ALPHA * (workMs - workEstimateMs);
+    }
+
+    if (targetPeriod != Clock::duration{}) {
+        Clock::time_point frameStart = nextFrameStart;
+        // Starting any earlier than the predicted present minus the work would only leave the frame queued, with
+        // older input, when the presentation engine runs slower than the target.
+        if (presentIntervalEstimateMs > 0.0) {
+            frameStart = std::max(frameStart, predictNextPresent() - fromMilliseconds(workEstimateMs * WORK_MARGIN));
+        }
+        // a small overshoot is spin noise; anything beyond a tenth of the period means the budget was missed
+        if (now > frameStart + effectivePeriod() / 10) {
+            // rebase instead of rendering back-to-back frames to catch up, which would only add jitter
+            missedFrames++;
+            windowMisses++;
+            frameStart = now;
+        } else if (now < frameStart) {
+            preciseSleepUntil(frameStart);
+        }
+        nextFrameStart = frameStart + effectivePeriod();
+        adaptRate();
+        now = Clock::now();
+    }
+
+    if (frames > 0) {
+        frameTimesMs[frameTimeCount % HISTORY_SIZE] = static_cast<float>(toMilliseconds(now - lastFrameStart));
+        frameTimeCount++;
+    }
+    frames++;
+    lastFrameStart = now;
+    return now;
+}
+
+void EvilutionFramePacer::markPresented() {
+    auto now = Clock::now();
+    double intervalMs = toMilliseconds(now - lastPresentTime);
+    presentIntervalEstimateMs = presentIntervalEstimateMs == 0.0
+                                    ? intervalMs
+                                    : presentIntervalEstimateMs + EMA_ALPHA * (intervalMs - presentIntervalEstimateMs);
+    lastPresentTime = now;
+}
+
+void EvilutionFramePacer::resumeAfterIdle() {
+    auto now = Clock::now();
+    lastFrameStart = now;
+    nextFrameStart = now + effectivePeriod();
+    // the next present interval would otherwise include the idle time
+    lastPresentTime = now;
+}
+
+EvilutionFramePacer::Clock::time_point EvilutionFramePacer::predictNextPresent() const {
+    double intervalMs = presentIntervalEstimateMs;
+    if (targetPeriod != Clock::duration{}) {
+        intervalMs = std::max(intervalMs, toMilliseconds(effectivePeriod()));
+    }
+    return lastPresentTime + fromMilliseconds(intervalMs);
+}
+
+void EvilutionFramePacer::preciseSleepUntil(Clock::time_point deadline) {
+    // sleep in 1ms steps while the remaining time comfortably exceeds what a sleep has been observed to cost;
+    // until one has been measured, it is taken at its word
+    while (toMilliseconds(deadline - Clock::now()) > (sleepSamples > 0 ? sleepEstimateMs : 1.0)) {
+        auto start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double observedMs = toMilliseconds(Clock::now() - start);
+
+        sleepSamples++;
+        double delta = observedMs - sleepMeanMs;
+        sleepMeanMs += delta / sleepSamples;
+        sleepM2 += delta * (observedMs - sleepMeanMs);
+        sleepEstimateMs = sleepSamples > 1 ? sleepMeanMs + std::sqrt(sleepM2 / (sleepSamples - 1)) : sleepMeanMs;
+    }
+
+    // spin out the rest; yielding keeps the core available to the driver threads
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void EvilutionFramePacer::adaptRate() {
+    if (++windowFrames < ADAPT_WINDOW) {
+        return;
+    }
+
+    double missRatio = static_cast<double>(windowMisses) / windowFrames;
+    if (missRatio > 0.2 && rateDivisor < MAX_RATE_DIVISOR) {
+        // a steady lower rate paces better than a higher one that keeps missing
+        rateDivisor++;
+        cleanWindows = 0;
+    } else if (windowMisses == 0) {
+        cleanWindows++;
+        double fasterPeriodMs = toMilliseconds(targetPeriod * (rateDivisor - 1));
+        if (rateDivisor > 1 && cleanWindows >= 2 && workEstimateMs < fasterPeriodMs * 0.75) {
+            rateDivisor--;
+            cleanWindows = 0;
+        }
+    } else {
+        cleanWindows = 0;
+    }
+    windowFrames = 0;
+    windowMisses = 0;
+}
+
+EvilutionFramePacer::Stats EvilutionFramePacer::getStats() const {
+    Stats stats{};
+    stats.frames = frames;
+    stats.missedFrames = missedFrames;
+    stats.effectiveFrameRate = getEffectiveFrameRate();
+    stats.predictedPresentIntervalMs = toMilliseconds(predictNextPresent() - lastPresentTime);
+
+    size_t count = std::min(frameTimeCount, HISTORY_SIZE);
+    if (count == 0) {
+        return stats;
+    }
+
+    // oldest sample first so the jitter term compares neighbouring frames
+    size_t first = frameTimeCount > HISTORY_SIZE ? frameTimeCount % HISTORY_SIZE : 0;
+    double sum = 0.0;
+    double jitterSum = 0.0;
+    double previous = frameTimesMs[first];
+    for (size_t i = 0; i < count; i++) {
+        double frameMs = frameTimesMs[(first + i) % HISTORY_SIZE];
+        sum += frameMs;
+        stats.maxFrameMs = std::max(stats.maxFrameMs, frameMs);
+        jitterSum += std::abs(frameMs - previous);
+        previous = frameMs;
+    }
+    stats.meanFrameMs = sum / count;
+
+    double squaredSum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double delta = frameTimesMs[i] - stats.meanFrameMs;
+        squaredSum += delta * delta;
+    }
+    stats.varianceMs2 = squaredSum / count;
+    stats.stdDevMs = std::sqrt(stats.varianceMs2);
+    stats.jitterMs = count > 1 ? jitterSum / (count - 1) : 0.0;
+    return stats;
+}
+
+void EvilutionFramePacer::printStats(std::ostream& out) const {
+    Stats stats = getStats();
+    out << std::fixed << std::setprecision(2) << "frame pacing: target " << targetFrameRate << " fps (effective "
+        << stats.effectiveFrameRate << "), " << stats.frames << " frames, " << stats.missedFrames << " missed"
+        << std::endl
+        << "\tframe time mean " << stats.meanFrameMs << " ms, stddev " << stats.stdDevMs << " ms, jitter "
+        << stats.jitterMs << " ms, max " << stats.maxFrameMs << " ms, predicted present interval "
+        << stats.predictedPresentIntervalMs << " ms" << std::endl;
+    out.unsetf(std::ios::floatfield);
+}
+
+} // namespace evilution
@@ -0,0 +1,93 @@
+#pragma once
+
+// std
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace evilution {
+
+// Limits the main loop to a target frame rate. Each frame starts late enough to be ready just before the present
+// predicted from recent history, but never earlier than the target rate allows. Waits are a coarse sleep followed
+// by a short spin, with the switch-over point learned from how long sleeps actually take on this machine.
+class EvilutionFramePacer {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t missedFrames = 0;
+        double meanFrameMs = 0.0;
+        double varianceMs2 = 0.0;
+        double stdDevMs = 0.0;
+        // mean absolute difference between consecutive frame times
+        double jitterMs = 0.0;
+        double maxFrameMs = 0.0;
+        double effectiveFrameRate = 0.0;
+        double predictedPresentIntervalMs = 0.0;
+    };
+
+    // 0 disables limiting; the pacer then only gathers stats
+    explicit EvilutionFramePacer(double targetFrameRate = 0.0);
+
+    void setTargetFrameRate(double targetFrameRate);
+    double getTargetFrameRate() const { return targetFrameRate; }
+    double getEffectiveFrameRate() const;
+
+    // Blocks until the next frame should start. Call at the top of the loop, before polling input.
+    Clock::time_point waitForNextFrame();
+    // Call once the frame has been handed to the presentation engine.
+    void markPresented();
+    // Call when the loop resumes after blocking for as long as it had nothing to draw, so the gap counts neither
+    // as a missed frame nor as frame time.
+    void resumeAfterIdle();
+
+    // Extrapolated from recent present intervals, never earlier than the pacing period allows. waitForNextFrame
+    // starts frames against it; callers can also advance animation to when the frame will actually be shown
+    // rather than when it was built.
+    Clock::time_point predictNextPresent() const;
+    Stats getStats() const;
+    void printStats(std::ostream& out) const;
+
+  private:
+    static constexpr size_t HISTORY_SIZE = 240;
+    static constexpr uint32_t ADAPT_WINDOW = 120;
+    static constexpr uint32_t MAX_RATE_DIVISOR = 4;
+
+    void preciseSleepUntil(Clock::time_point deadline);
+    void adaptRate();
+    Clock::duration effectivePeriod() const { return targetPeriod * rateDivisor; }
+
+    double targetFrameRate = 0.0;
+    Clock::duration targetPeriod{};
+    // the pacer falls back to target / rateDivisor when the target cannot be sustained
+    uint32_t rateDivisor = 1;
+
+    Clock::time_point nextFrameStart{};
+    Clock::time_point lastFrameStart{};
+    Clock::time_point lastPresentTime{};
+
+    // frame-to-frame intervals, ring buffer
+    std::array<float, HISTORY_SIZE> frameTimesMs{};
+    size_t frameTimeCount = 0;
+    uint64_t frames = 0;
+    uint64_t missedFrames = 0;
+
+    // exponential moving averages used for prediction
+    double workEstimateMs = 0.0;
+    double presentIntervalEstimateMs = 0.0;
+
+    // adaptation window
+    uint32_t windowFrames = 0;
+    uint32_t windowMisses = 0;
+    uint32_t cleanWindows = 0;
+
+    // running estimate of how long a 1ms sleep really takes (Welford mean / variance), only used once measured
+    double sleepEstimateMs = 0.0;
+    double sleepMeanMs = 0.0;
+    double sleepM2 = 0.0;
+    uint64_t sleepSamples = 0;
+};
+
+} // namespace evilution
@@ -0,0 +1,481 @@
+#include "evilution_geometry_pool.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace evilution {
+
+void drawGeometry(VkCommandBuffer commandBuffer, const GeometryRange& range, uint32_t instanceCount,
+                  uint32_t firstInstance) {
+    if (range.indexCount > 0) {
+        vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount, range.firstIndex,
+                         static_cast<int32_t>(range.firstVertex), firstInstance);
+    } else {
+        vkCmdDraw(commandBuffer, range.vertexCount, instanceCount, range.firstVertex, firstInstance);
+    }
+}
+
+VkDrawIndexedIndirectCommand makeIndexedIndirectCommand(const GeometryRange& range, uint32_t instanceCount,
+                                                        uint32_t firstInstance) {
+    assert(range.indexCount > 0 && "Indexed indirect draws need indexed geometry");
+    VkDrawIndexedIndirectCommand command{};
+    command.indexCount = range.indexCount;
+    command.instanceCount = instanceCount;
+    command.firstIndex = range.firstIndex;
+    command.vertexOffset = static_cast<int32_t>(range.firstVertex);
+    command.firstInstance = firstInstance;
+    return command;
+}
+
+void EvilutionGeometryPool::RangeAllocator::reset(uint32_t newCapacity, uint32_t newUsed) {
+    capacity = newCapacity;
+    used = newUsed;
+    freeBlocks.clear();
+    if (used < capacity) {
+        freeBlocks.emplace(used, capacity - used);
+    }
+}
+
+bool EvilutionGeometryPool::RangeAllocator::allocate(uint32_t size, uint32_t& offset) {
+    // first fit keeps allocations packed towards the start, which leaves the tail free for large models
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+        if (it->second < size) {
+            continue;
+        }
+        offset = it->first;
+        uint32_t remaining = it->second - size;
+        freeBlocks.erase(it);
+        if (remaining > 0) {
+            freeBlocks.emplace(offset + size, remaining);
+        }
+        used += size;
+        return true;
+    }
+    return false;
+}
+
+void EvilutionGeometryPool::RangeAllocator::free(uint32_t offset, uint32_t size) {
+    assert(used >= size && "Freeing more than was allocated");
+    used -= size;
+
+    auto next = freeBlocks.lower_bound(offset);
+    if (next != freeBlocks.end() && offset + size == next->first) {
+        size += next->second;
+        next = freeBlocks.erase(next);
+    }
+    if (next != freeBlocks.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+    freeBlocks.emplace(offset, size);
+}
+
+uint32_t EvilutionGeometryPool::RangeAllocator::getLargestFreeBlock() const {
+    uint32_t largest = 0;
+    for (const auto& block : freeBlocks) {
+        largest = std::max(largest, block.second);
+    }
+    return largest;
+}
+
+EvilutionGeometryPool::EvilutionGeometryPool(EvilutionDevice& device, uint32_t vertexStride, uint32_t vertexCapacity,
+                                             uint32_t indexCapacity, uint32_t meshletCapacity)
+    : evilutionDevice{device}, vertexStride{vertexStride} {
+    assert(vertexCapacity > 0 && indexCapacity > 0 && meshletCapacity > 0 &&
+           "Geometry pool capacities must not be zero");
+    buffers = createBuffers({vertexCapacity, indexCapacity, meshletCapacity});
+    vertexAllocator.reset(vertexCapacity, 0);
+    indexAllocator.reset(indexCapacity, 0);
+    meshletAllocator.reset(meshletCapacity, 0);
+}
+
+EvilutionGeometryPool::~EvilutionGeometryPool() {
+    // pending frees call back into the pool, so they have to run while it still exists
+    evilutionDevice.deletionQueue().flush();
+    retireBuffers(buffers);
+}
+
+GeometryAllocationId EvilutionGeometryPool::allocate(const void* vertices, uint32_t vertexCount,
+                                                     const uint32_t* indices, uint32_t indexCount,
+                                                     const Meshlet* meshlets, uint32_t meshletCount) {
+    return allocateBatch({{vertices, vertexCount, indices, indexCount, meshlets, meshletCount}}).front();
+}
+
+std::vector<GeometryAllocationId> EvilutionGeometryPool::allocateBatch(const std::vector<GeometryUpload>& uploads) {
+    std::lock_guard<std::mutex> layoutLock{layoutMutex};
+    std::unique_lock<std::mutex> stateLock{stateMutex};
+
+    std::vector<GeometryAllocationId> ids;
+    ids.reserve(uploads.size());
+    for (const GeometryUpload& upload : uploads) {
+        assert(upload.vertexCount > 0 && "Cannot allocate geometry without vertices");
+        assert((upload.indexCount == 0 || upload.indices != nullptr) && "Index data missing");
+        assert((upload.meshletCount == 0 || (upload.meshlets != nullptr && upload.indexCount > 0)) &&
+               "Meshlets need their data and indexed geometry");
+        ids.push_back(allocateRange(stateLock, upload));
+    }
+
+    // read back once all are placed, since growing for a later upload moves the earlier ones
+    std::vector<Allocation> placed;
+    placed.reserve(ids.size());
+    for (GeometryAllocationId id : ids) {
+        placed.push_back(allocations[id]);
+    }
+    Buffers target = buffers;
+    stateLock.unlock();
+
+    // the ranges are not visible to anyone until the ids are returned, and layoutMutex keeps the buffers in place
+    VkDeviceSize stagingSize = 0;
+    for (const GeometryUpload& upload : uploads) {
+        stagingSize += static_cast<VkDeviceSize>(upload.vertexCount) * vertexStride +
+                       static_cast<VkDeviceSize>(upload.indexCount) * sizeof(uint32_t) +
+                       static_cast<VkDeviceSize>(upload.meshletCount) * sizeof(Meshlet);
+    }
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    evilutionDevice.createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                 stagingBuffer, stagingBufferMemory);
+
+    void* data;
+    vkMapMemory(evilutionDevice.device(), stagingBufferMemory, 0, stagingSize, 0, &data);
+    std::vector<VkBufferCopy> vertexCopies;
+    std::vector<VkBufferCopy> indexCopies;
+    std::vector<VkBufferCopy> meshletCopies;
+    VkDeviceSize stagingOffset = 0;
+    for (size_t i = 0; i < uploads.size(); i++) {
+        const GeometryUpload& upload = uploads[i];
+        VkDeviceSize vertexBytes = static_cast<VkDeviceSize>(upload.vertexCount) * vertexStride;
+        memcpy(static_cast<char*>(data) + stagingOffset, upload.vertices, static_cast<size_t>(vertexBytes));
+        vertexCopies.push_back(
+            {stagingOffset, static_cast<VkDeviceSize>(placed[i].firstVertex) * vertexStride, vertexBytes});
+        stagingOffset += vertexBytes;
+
+        if (upload.indexCount > 0) {
+            VkDeviceSize indexBytes = static_cast<VkDeviceSize>(upload.indexCount) * sizeof(uint32_t);
+            memcpy(static_cast<char*>(data) + stagingOffset, upload.indices, static_cast<size_t>(indexBytes));
+            indexCopies.push_back(
+                {stagingOffset, static_cast<VkDeviceSize>(placed[i].firstIndex) * sizeof(uint32_t), indexBytes});
+            stagingOffset += indexBytes;
+        }
+
+        if (upload.meshletCount > 0) {
+            VkDeviceSize meshletBytes = static_cast<VkDeviceSize>(upload.meshletCount) * sizeof(Meshlet);
+            memcpy(static_cast<char*>(data) + stagingOffset, upload.meshlets, static_cast<size_t>(meshletBytes));
+            meshletCopies.push_back(
+                {stagingOffset, static_cast<VkDeviceSize>(placed[i].firstMeshlet) * sizeof(Meshlet), meshletBytes});
+            stagingOffset += meshletBytes;
+        }
+    }
+    vkUnmapMemory(evilutionDevice.device(), stagingBufferMemory);
+
+    EvilutionDevice::SingleTimeCommands commands = evilutionDevice.beginSingleTimeCommands();
+    vkCmdCopyBuffer(commands.get(), stagingBuffer, target.vertexBuffer, static_cast<uint32_t>(vertexCopies.size()),
+                    vertexCopies.data());
+    if (!indexCopies.empty()) {
+        vkCmdCopyBuffer(commands.get(), stagingBuffer, target.indexBuffer, static_cast<uint32_t>(indexCopies.size()),
+                        indexCopies.data());
+    }
+    if (!meshletCopies.empty()) {
+        vkCmdCopyBuffer(commands.get(), stagingBuffer, target.meshletBuffer,
+                        static_cast<uint32_t>(meshletCopies.size()), meshletCopies.data());
+    }
+    commands.submitAndWait();
+
+    vkDestroyBuffer(evilutionDevice.device(), stagingBuffer, nullptr);
+    vkFreeMemory(evilutionDevice.device(), stagingBufferMemory, nullptr);
+    return ids;
+}
+
+GeometryAllocationId EvilutionGeometryPool::allocateRange(std::unique_lock<std::mutex>& stateLock,
+                                                          const GeometryUpload& upload) {
+    uint32_t vertexCount = upload.vertexCount;
+    uint32_t indexCount = upload.indexCount;
+    uint32_t meshletCount = upload.meshletCount;
+    uint32_t firstVertex = 0;
+    uint32_t firstIndex = 0;
+    uint32_t firstMeshlet = 0;
+    auto tryAllocate = [&] {
+        if (!vertexAllocator.allocate(vertexCount, firstVertex)) {
+            return false;
+        }
+        if (indexCount > 0 && !indexAllocator.allocate(indexCount, firstIndex)) {
+            vertexAllocator.free(firstVertex, vertexCount);
+            return false;
+        }
+        if (meshletCount > 0 && !meshletAllocator.allocate(meshletCount, firstMeshlet)) {
+            vertexAllocator.free(firstVertex, vertexCount);
+            if (indexCount > 0) {
+                indexAllocator.free(firstIndex, indexCount);
+            }
+            return false;
+        }
+        return true;
+    };
+
+    if (!tryAllocate()) {
+        // compaction alone is enough when the space is there but fragmented; otherwise grow as well
+        // in 64 bits, since doubling a large capacity would wrap a uint32_t to 0 and never get there
+        auto grownCapacity = [](const RangeAllocator& allocator, uint32_t size) {
+            uint64_t required = static_cast<uint64_t>(allocator.getUsed()) + size;
+            uint64_t capacity = std::max<uint64_t>(allocator.getCapacity(), 1);
+            while (capacity < required) {
+                capacity *= 2;
+            }
+            // offsets and counts into the buffers are 32 bit, which is as large as a pool buffer gets
+            if (capacity > std::numeric_limits<uint32_t>::max()) {
+                if (required > std::numeric_limits<uint32_t>::max()) {
+                    throw std::runtime_error("failed to grow geometry pool past its maximum buffer size!");
+                }
+                capacity = std::numeric_limits<uint32_t>::max();
+            }
+            return static_cast<uint32_t>(capacity);
+        };
+        Capacities capacities{grownCapacity(vertexAllocator, vertexCount), grownCapacity(indexAllocator, indexCount),
+                              grownCapacity(meshletAllocator, meshletCount)};
+
+        stateLock.unlock();
+        compactLocked(capacities);
+        stateLock.lock();
+        if (!tryAllocate()) {
+            throw std::runtime_error("failed to allocate geometry!");
+        }
+    }
+
+    GeometryAllocationId id;
+    if (!freeAllocationIds.empty()) {
+        id = freeAllocationIds.back();
+        freeAllocationIds.pop_back();
+    } else {
+        id = static_cast<GeometryAllocationId>(allocations.size());
+        allocations.emplace_back();
+    }
+    allocations[id] = {AllocationState::Live, firstVertex, vertexCount, firstIndex, indexCount, firstMeshlet,
+                       meshletCount};
+    liveAllocationCount++;
+    return id;
+}
+
+void EvilutionGeometryPool::free(GeometryAllocationId allocation) {
+    {
+        std::lock_guard<std::mutex> lock{stateMutex};
+        assert(allocation < allocations.size() && allocations[allocation].state == AllocationState::Live &&
+               "Cannot free geometry that is not allocated");
+        allocations[allocation].state = AllocationState::Released;
+        liveAllocationCount--;
+    }
+    // frames in flight may still draw from the range
+    evilutionDevice.deletionQueue().defer([this, allocation] { release(allocation); });
+}
+
+void EvilutionGeometryPool::release(GeometryAllocationId allocation) {
+    std::lock_guard<std::mutex> lock{stateMutex};
+    Allocation& released = allocations[allocation];
+    // compaction drops released ranges and zeroes their counts, in which case there is nothing left to free
+    if (released.vertexCount > 0) {
+        vertexAllocator.free(released.firstVertex, released.vertexCount);
+    }
+    if (released.indexCount > 0) {
+        indexAllocator.free(released.firstIndex, released.indexCount);
+    }
+    if (released.meshletCount > 0) {
+        meshletAllocator.free(released.firstMeshlet, released.meshletCount);
+    }
+    released = {};
+    freeAllocationIds.push_back(allocation);
+}
+
+GeometryRange EvilutionGeometryPool::getRange(GeometryAllocationId allocation) {
+    std::lock_guard<std::mutex> lock{stateMutex};
+    assert(allocation < allocations.size() && allocations[allocation].state != AllocationState::Free &&
+           "Geometry allocation is not valid");
+    return makeRange(allocations[allocation]);
+}
+
+void EvilutionGeometryPool::getRanges(const std::vector<GeometryAllocationId>& ids,
+                                      std::vector<GeometryRange>& ranges) {
+    std::lock_guard<std::mutex> lock{stateMutex};
+    ranges.clear();
+    ranges.reserve(ids.size());
+    for (GeometryAllocationId allocation : ids) {
+        assert(allocation < allocations.size() && allocations[allocation].state != AllocationState::Free &&
+               "Geometry allocation is not valid");
+        ranges.push_back(makeRange(allocations[allocation]));
+    }
+}
+
+uint32_t EvilutionGeometryPool::getGeneration() {
+    std::lock_guard<std::mutex> lock{stateMutex};
+    return compactionCount;
+}
+
+GeometryRange EvilutionGeometryPool::makeRange(const Allocation& allocation) const {
+    return {buffers.vertexBuffer,   buffers.indexBuffer,   allocation.firstVertex,
+            allocation.vertexCount, allocation.firstIndex, allocation.indexCount,
+            buffers.meshletBuffer,  allocation.firstMeshlet, allocation.meshletCount};
+}
+
+bool EvilutionGeometryPool::shouldCompact() {
+    std::lock_guard<std::mutex> lock{stateMutex};
+    auto fragmented = [](const RangeAllocator& allocator) {
+        uint32_t freeSpace = allocator.getCapacity() - allocator.getUsed();
+        return freeSpace > allocator.getCapacity() / 4 && allocator.getLargestFreeBlock() < freeSpace / 2;
+    };
+    return fragmented(vertexAllocator) || fragmented(indexAllocator) || fragmented(meshletAllocator);
+}
+
+void EvilutionGeometryPool::compact() {
+    std::lock_guard<std::mutex> layoutLock{layoutMutex};
+    Capacities capacities;
+    {
+        std::lock_guard<std::mutex> stateLock{stateMutex};
+        capacities = {vertexAllocator.getCapacity(), indexAllocator.getCapacity(), meshletAllocator.getCapacity()};
+    }
+    compactLocked(capacities);
+}
+
+void EvilutionGeometryPool::compactLocked(const Capacities& capacities) {
+    Buffers compacted = createBuffers(capacities);
+
+    std::vector<VkBufferCopy> vertexCopies;
+    std::vector<VkBufferCopy> indexCopies;
+    std::vector<VkBufferCopy> meshletCopies;
+    std::vector<std::pair<GeometryAllocationId, Allocation>> moved;
+    uint32_t vertexCursor = 0;
+    uint32_t indexCursor = 0;
+    uint32_t meshletCursor = 0;
+    Buffers previous;
+    {
+        std::lock_guard<std::mutex> stateLock{stateMutex};
+        previous = buffers;
+        for (GeometryAllocationId id = 0; id < allocations.size(); id++) {
+            const Allocation& allocation = allocations[id];
+            if (allocation.state != AllocationState::Live) {
+                continue;
+            }
+
+            Allocation packed = allocation;
+            packed.firstVertex = vertexCursor;
+            vertexCopies.push_back({static_cast<VkDeviceSize>(allocation.firstVertex) * vertexStride,
+                                    static_cast<VkDeviceSize>(vertexCursor) * vertexStride,
+                                    static_cast<VkDeviceSize>(allocation.vertexCount) * vertexStride});
+            vertexCursor += allocation.vertexCount;
+            if (allocation.indexCount > 0) {
+                packed.firstIndex = indexCursor;
+                indexCopies.push_back({static_cast<VkDeviceSize>(allocation.firstIndex) * sizeof(uint32_t),
+                                       static_cast<VkDeviceSize>(indexCursor) * sizeof(uint32_t),
+                                       static_cast<VkDeviceSize>(allocation.indexCount) * sizeof(uint32_t)});
+                indexCursor += allocation.indexCount;
+            }
+            if (allocation.meshletCount > 0) {
+                packed.firstMeshlet = meshletCursor;
+                meshletCopies.push_back({static_cast<VkDeviceSize>(allocation.firstMeshlet) * sizeof(Meshlet),
+                                         static_cast<VkDeviceSize>(meshletCursor) * sizeof(Meshlet),
+                                         static_cast<VkDeviceSize>(allocation.meshletCount) * sizeof(Meshlet)});
+                meshletCursor += allocation.meshletCount;
+            }
+            moved.emplace_back(id, packed);
+        }
+    }
+
+    // draws keep reading the previous buffers until the new ones are swapped in below
+    if (!vertexCopies.empty() || !indexCopies.empty() || !meshletCopies.empty()) {
+        EvilutionDevice::SingleTimeCommands commands = evilutionDevice.beginSingleTimeCommands();
+        if (!vertexCopies.empty()) {
+            vkCmdCopyBuffer(commands.get(), previous.vertexBuffer, compacted.vertexBuffer,
+                            static_cast<uint32_t>(vertexCopies.size()), vertexCopies.data());
+        }
+        if (!indexCopies.empty()) {
+            vkCmdCopyBuffer(commands.get(), previous.indexBuffer, compacted.indexBuffer,
+                            static_cast<uint32_t>(indexCopies.size()), indexCopies.data());
+        }
+        if (!meshletCopies.empty()) {
+            vkCmdCopyBuffer(commands.get(), previous.meshletBuffer, compacted.meshletBuffer,
+                            static_cast<uint32_t>(meshletCopies.size()), meshletCopies.data());
+        }
+        commands.submitAndWait();
+    }
+
+    {
+        std::lock_guard<std::mutex> stateLock{stateMutex};
+        std::vector<bool> wasMoved(allocations.size(), false);
+        for (const auto& [id, packed] : moved) {
+            wasMoved[id] = true;
+            // released and already returned while the copy ran; its space stays unused until the next compaction
+            if (allocations[id].state == AllocationState::Free) {
+                continue;
+            }
+            allocations[id].firstVertex = packed.firstVertex;
+            allocations[id].firstIndex = packed.firstIndex;
+            allocations[id].firstMeshlet = packed.firstMeshlet;
+        }
+        // released before the copy and still waiting on the GPU: the new buffers have no room reserved for them
+        for (GeometryAllocationId id = 0; id < allocations.size(); id++) {
+            if (!wasMoved[id] && allocations[id].state == AllocationState::Released) {
+                allocations[id].vertexCount = 0;
+                allocations[id].indexCount = 0;
+                allocations[id].meshletCount = 0;
+            }
+        }
+
+        vertexAllocator.reset(capacities.vertices, vertexCursor);
+        indexAllocator.reset(capacities.indices, indexCursor);
+        meshletAllocator.reset(capacities.meshlets, meshletCursor);
+        buffers = compacted;
+        compactionCount++;
+    }
+
+    // frames recorded before the swap still use the previous buffers
+    retireBuffers(previous);
+}
+
+EvilutionGeometryPool::Buffers EvilutionGeometryPool::createBuffers(const Capacities& capacities) {
+    Buffers created{};
+    // also a storage buffer, for shaders that pull their vertices instead of using fixed-function vertex input
+    evilutionDevice.createBuffer(
+        static_cast<VkDeviceSize>(capacities.vertices) * vertexStride,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, created.vertexBuffer, created.vertexMemory);
+    evilutionDevice.createBuffer(
+        static_cast<VkDeviceSize>(capacities.indices) * sizeof(uint32_t),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, created.indexBuffer, created.indexMemory);
+    evilutionDevice.createBuffer(
+        static_cast<VkDeviceSize>(capacities.meshlets) * sizeof(Meshlet),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, created.meshletBuffer, created.meshletMemory);
+    return created;
+}
+
+void EvilutionGeometryPool::retireBuffers(const Buffers& retired) {
+    evilutionDevice.deletionQueue().destroyBuffer(retired.vertexBuffer, retired.vertexMemory);
+    evilutionDevice.deletionQueue().destroyBuffer(retired.indexBuffer, retired.indexMemory);
+    evilutionDevice.deletionQueue().destroyBuffer(retired.meshletBuffer, retired.meshletMemory);
+}
+
+EvilutionGeometryPool::Stats EvilutionGeometryPool::getStats() {
+    std::lock_guard<std::mutex> lock{stateMutex};
+    Stats stats{};
+    stats.vertexCapacity = vertexAllocator.getCapacity();
+    stats.vertexCount = vertexAllocator.getUsed();
+    stats.indexCapacity = indexAllocator.getCapacity();
+    stats.indexCount = indexAllocator.getUsed();
+    stats.meshletCapacity = meshletAllocator.getCapacity();
+    stats.meshletCount = meshletAllocator.getUsed();
+    stats.allocationCount = liveAllocationCount;
+    stats.compactionCount = compactionCount;
+    return stats;
+}
+
+} // namespace evilution
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "evilution_device.hpp"
+#include "evilution_meshlets.hpp"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace evilution {
+
+using GeometryAllocationId = uint32_t;
+
+// Where one allocation currently lives. Compaction and growth move allocations into new buffers, so a range is
+// only meaningful together with the buffers it was returned with.
+struct GeometryRange {
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    uint32_t firstVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    // 0 for non-indexed geometry
+    uint32_t indexCount = 0;
+    // storage buffer of Meshlets, whose index ranges are relative to firstIndex
+    VkBuffer meshletBuffer = VK_NULL_HANDLE;
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+};
+
+struct GeometryUpload {
+    const void* vertices = nullptr;
+    uint32_t vertexCount = 0;
+    // may be null when indexCount is 0
+    const uint32_t* indices = nullptr;
+    uint32_t indexCount = 0;
+    // may be null when meshletCount is 0
+    const Meshlet* meshlets = nullptr;
+    uint32_t meshletCount = 0;
+};
+
+void drawGeometry(VkCommandBuffer commandBuffer, const GeometryRange& range, uint32_t instanceCount = 1,
+                  uint32_t firstInstance = 0);
+// for merging draws into vkCmdDrawIndexedIndirect; the range must be indexed
+VkDrawIndexedIndirectCommand makeIndexedIndirectCommand(const GeometryRange& range, uint32_t instanceCount = 1,
+                                                        uint32_t firstInstance = 0);
+
+// Device-local vertex, index and meshlet buffers shared by every model. Allocations are placed first-fit in each buffer
+// and addressed with base-vertex offsets, so any number of models draw with a single vertex and index bind.
+// When an allocation does not fit, the buffers are compacted into larger ones.
+//
+// Freed ranges are only reused once the frames that may still read them have completed. Other threads may
+// allocate and free while the render thread reads ranges; compact() is meant for the render thread, between
+// frames.
+class EvilutionGeometryPool {
+  public:
+    struct Stats {
+        uint32_t vertexCapacity = 0;
+        uint32_t vertexCount = 0;
+        uint32_t indexCapacity = 0;
+        uint32_t indexCount = 0;
+        uint32_t meshletCapacity = 0;
+        uint32_t meshletCount = 0;
+        uint32_t allocationCount = 0;
+        uint32_t compactionCount = 0;
+    };
+
+    EvilutionGeometryPool(EvilutionDevice& device, uint32_t vertexStride, uint32_t vertexCapacity = 1 << 20,
+                          uint32_t indexCapacity = 1 << 22, uint32_t meshletCapacity = 1 << 16);
+    ~EvilutionGeometryPool();
+
+    EvilutionGeometryPool(const EvilutionGeometryPool&) = delete;
+    EvilutionGeometryPool& operator=(const EvilutionGeometryPool&) = delete;
+
+    // Uploads the geometry and blocks until the copy has finished. indices may be null when indexCount is 0.
+    GeometryAllocationId allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices,
+                                  uint32_t indexCount, const Meshlet* meshlets = nullptr, uint32_t meshletCount = 0);
+    // Same as allocate() for each upload, but through one staging buffer and a single submission.
+    std::vector<GeometryAllocationId> allocateBatch(const std::vector<GeometryUpload>& uploads);
+    void free(GeometryAllocationId allocation);
+
+    GeometryRange getRange(GeometryAllocationId allocation);
+    // All under one lock, so every range refers to the same buffers and can be drawn with a single bind.
+    void getRanges(const std::vector<GeometryAllocationId>& allocations, std::vector<GeometryRange>& ranges);
+    uint32_t getVertexStride() const { return vertexStride; }
+    // Changes whenever the buffers are replaced, by compaction or by growing for an upload, which moves every
+    // range handed out before; anything recorded against the old ranges has to be recorded again.
+    uint32_t getGeneration();
+
+    // true when enough space is lost to fragmentation that compacting is worth a copy
+    bool shouldCompact();
+    void compact();
+
+    Stats getStats();
+
+  private:
+    // free blocks of one buffer, in units of vertices or indices
+    class RangeAllocator {
+      public:
+        void reset(uint32_t capacity, uint32_t used);
+        bool allocate(uint32_t size, uint32_t& offset);
+        void free(uint32_t offset, uint32_t size);
+
+        uint32_t getCapacity() const { return capacity; }
+        uint32_t getUsed() const { return used; }
+        uint32_t getLargestFreeBlock() const;
+
+      private:
+        // offset -> size, never adjacent to each other
+        std::map<uint32_t, uint32_t> freeBlocks;
+        uint32_t capacity = 0;
+        uint32_t used = 0;
+    };
+
+    enum class AllocationState : uint8_t { Free, Live, Released };
+
+    struct Allocation {
+        AllocationState state = AllocationState::Free;
+        uint32_t firstVertex = 0;
+        uint32_t vertexCount = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        uint32_t firstMeshlet = 0;
+        uint32_t meshletCount = 0;
+    };
+
+    struct Buffers {
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+        VkBuffer meshletBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory meshletMemory = VK_NULL_HANDLE;
+    };
+
+    struct Capacities {
+        uint32_t vertices = 0;
+        uint32_t indices = 0;
+        uint32_t meshlets = 0;
+    };
+
+    GeometryRange makeRange(const Allocation& allocation) const;
+    Buffers createBuffers(const Capacities& capacities);
+    void retireBuffers(const Buffers& retired);
+    // called with layoutMutex held; moves every live allocation to the start of new buffers of the given size
+    void compactLocked(const Capacities& capacities);
+    // called with both mutexes held
+    GeometryAllocationId allocateRange(std::unique_lock<std::mutex>& stateLock, const GeometryUpload& upload);
+    void release(GeometryAllocationId allocation);
+
+    EvilutionDevice& evilutionDevice;
+    const uint32_t vertexStride;
+
+    // serializes everything that writes buffer contents or replaces the buffers: uploads and compaction
+    std::mutex layoutMutex;
+    // guards the fields below; held only briefly so draws are never stuck behind an upload
+    std::mutex stateMutex;
+    Buffers buffers;
+    RangeAllocator vertexAllocator;
+    RangeAllocator indexAllocator;
+    RangeAllocator meshletAllocator;
+    std::vector<Allocation> allocations;
+    std::vector<GeometryAllocationId> freeAllocationIds;
+    uint32_t liveAllocationCount = 0;
+    uint32_t compactionCount = 0;
+};
+
+} // namespace evilution
@@ -0,0 +1,287 @@
+#include "evilution_geometry_streamer.hpp"
+
+#include "evilution_model.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+
+namespace evilution {
+
+EvilutionGeometryStreamer::EvilutionGeometryStreamer(EvilutionDevice& device, EvilutionAssetCache& assetCache,
+                                                     EvilutionResourceRegistry& resourceRegistry,
+                                                     const GeometryStreamingSettings& settings)
+    : evilutionDevice{device}, evilutionAssetCache{assetCache}, evilutionResourceRegistry{resourceRegistry},
+      settings{settings} {
+    assert(settings.levelCount > 0 && "Streamed models need at least one level of detail");
+    refreshBudget();
+}
+
+EvilutionGeometryStreamer::~EvilutionGeometryStreamer() {
+    for (StreamedModel& model : models) {
+        for (Level& level : model.levels) {
+            if (level.state == LevelState::Loading || level.state == LevelState::Resident) {
+                evilutionAssetCache.releaseModel(level.model);
+            }
+        }
+    }
+}
+
+StreamedModelId EvilutionGeometryStreamer::addModel(const std::string& filepath) {
+    StreamedModelId id = static_cast<StreamedModelId>(models.size());
+    StreamedModel model{};
+    model.path = filepath;
+    model.levels.resize(settings.levelCount);
+    model.wantedLevel = settings.levelCount - 1;
+    models.push_back(std::move(model));
+
+    startLoad(id, settings.levelCount - 1);
+    return id;
+}
+
+bool EvilutionGeometryStreamer::tryGetBounds(StreamedModelId model, glm::vec4& bounds) const {
+    assert(model < models.size() && "Unknown streamed model");
+    if (!models[model].hasBounds) {
+        return false;
+    }
+    bounds = models[model].bounds;
+    return true;
+}
+
+ModelHandle EvilutionGeometryStreamer::selectLevel(StreamedModelId id, float screenSize) {
+    assert(id < models.size() && "Unknown streamed model");
+    StreamedModel& model = models[id];
+    model.screenSize = screenSize;
+    model.wantedLevel = wantedLevelFor(screenSize);
+    model.selectedUpdate = currentUpdate;
+
+    uint32_t levelCount = static_cast<uint32_t>(model.levels.size());
+    model.drawnLevel = levelCount;
+    for (uint32_t level = model.wantedLevel; level < levelCount; level++) {
+        if (model.levels[level].state == LevelState::Resident) {
+            model.drawnLevel = level;
+            return model.levels[level].model;
+        }
+    }
+    for (uint32_t level = model.wantedLevel; level-- > 0;) {
+        if (model.levels[level].state == LevelState::Resident) {
+            model.drawnLevel = level;
+            return model.levels[level].model;
+        }
+    }
+    return {};
+}
+
+void EvilutionGeometryStreamer::update() {
+    pollLoads();
+    bool sample = (currentUpdate - 1) % std::max(1u, settings.sampleInterval) == 0;
+    if (sample) {
+        refreshBudget();
+    }
+
+    VkDeviceSize budget = stats.budget;
+    auto committed = [this] { return stats.residentBytes + loadingBytes; };
+
+    // least important first, so both passes below can stop at the first level worth keeping
+    gatherEvictionCandidates();
+    size_t nextEviction = 0;
+    while (committed() > budget && nextEviction < evictionCandidates.size()) {
+        const EvictionCandidate& candidate = evictionCandidates[nextEviction++];
+        evict(models[candidate.model], models[candidate.model].levels[candidate.level]);
+    }
+
+    // largest on screen first; models with nothing resident yet have no size to go by
+    loadCandidates.clear();
+    for (StreamedModelId id = 0; id < models.size(); id++) {
+        const StreamedModel& model = models[id];
+        if (model.selectedUpdate == currentUpdate && model.hasBounds &&
+            model.levels[model.wantedLevel].state == LevelState::Unloaded) {
+            loadCandidates.push_back(id);
+        }
+    }
+    std::sort(loadCandidates.begin(), loadCandidates.end(),
+              [this](StreamedModelId a, StreamedModelId b) { return models[a].screenSize > models[b].screenSize; });
+
+    for (StreamedModelId id : loadCandidates) {
+        if (loadingLevels.size() >= settings.maxLoadsInFlight) {
+            break;
+        }
+        StreamedModel& model = models[id];
+        VkDeviceSize bytes = estimateBytes(model, model.wantedLevel);
+        // only levels that matter less than this one make room for it
+        while (committed() + bytes > budget && nextEviction < evictionCandidates.size() &&
+               evictionCandidates[nextEviction].priority < model.screenSize) {
+            const EvictionCandidate& candidate = evictionCandidates[nextEviction++];
+            evict(models[candidate.model], models[candidate.model].levels[candidate.level]);
+        }
+        if (committed() + bytes > budget) {
+            stats.deferredLoads++;
+            break;
+        }
+        startLoad(id, model.wantedLevel);
+    }
+
+    stats.pressure = static_cast<float>(committed()) / static_cast<float>(std::max<VkDeviceSize>(budget, 1));
+    stats.peakPressure = std::max(stats.peakPressure, stats.pressure);
+    if (stats.residentBytes > budget) {
+        stats.updatesOverBudget++;
+    }
+    if (sample) {
+        pressureHistory.push_back({currentUpdate, budget, stats.residentBytes, deviceBudget});
+        while (pressureHistory.size() > settings.maxSamples) {
+            pressureHistory.pop_front();
+        }
+    }
+    currentUpdate++;
+}
+
+void EvilutionGeometryStreamer::printStats(std::ostream& out) const {
+    constexpr VkDeviceSize MiB = 1024 * 1024;
+    out << std::fixed << std::setprecision(1) << "geometry streaming: " << stats.residentLevels
+        << " levels resident in " << stats.residentBytes / 1024 << " KiB of a " << stats.budget / MiB
+        << " MiB budget, " << stats.loads << " loads, " << stats.evictions << " evictions, " << stats.deferredLoads
+        << " deferred, " << stats.failedLoads << " failed" << std::endl
+        << "\tpressure " << stats.pressure * 100.f << "%, peak " << stats.peakPressure * 100.f << "%, "
+        << stats.updatesOverBudget << " updates over budget, ";
+    if (deviceBudget.reported) {
+        out << "device memory " << deviceBudget.usage / MiB << " of " << deviceBudget.budget / MiB << " MiB in use"
+            << std::endl;
+    } else {
+        out << "device budget not reported (" << deviceBudget.budget / MiB << " MiB of heaps)" << std::endl;
+    }
+
+    if (!pressureHistory.empty()) {
+        out << std::setprecision(0) << "\tresident over budget every " << settings.sampleInterval << " updates:";
+        for (const PressureSample& sample : pressureHistory) {
+            out << ' '
+                << 100.0 * static_cast<double>(sample.residentBytes) /
+                       static_cast<double>(std::max<VkDeviceSize>(sample.budget, 1))
+                << '%';
+        }
+        out << std::endl;
+    }
+    out.unsetf(std::ios::floatfield);
+}
+
+uint32_t EvilutionGeometryStreamer::wantedLevelFor(float screenSize) const {
+    uint32_t coarsest = settings.levelCount - 1;
+    float threshold = settings.fullDetailScreenSize;
+    for (uint32_t level = 0; level < coarsest; level++) {
+        if (screenSize >= threshold) {
+            return level;
+        }
+        threshold *= settings.screenSizeFalloff;
+    }
+    return coarsest;
+}
+
+VkDeviceSize EvilutionGeometryStreamer::estimateBytes(const StreamedModel& model, uint32_t level) const {
+    if (model.levels[level].bytes > 0) {
+        return model.levels[level].bytes;
+    }
+    // each level halves the simplification grid, which leaves about a quarter of the surface vertices
+    for (uint32_t coarser = level + 1; coarser < model.levels.size(); coarser++) {
+        if (model.levels[coarser].bytes > 0) {
+            return model.levels[coarser].bytes << (2 * (coarser - level));
+        }
+    }
+    return 0;
+}
+
+void EvilutionGeometryStreamer::startLoad(StreamedModelId id, uint32_t levelIndex) {
+    StreamedModel& model = models[id];
+    Level& level = model.levels[levelIndex];
+    level.bytes = estimateBytes(model, levelIndex);
+    level.model = evilutionAssetCache.loadModelAsync(model.path, levelIndex);
+    level.state = LevelState::Loading;
+
+    loadingBytes += level.bytes;
+    loadingLevels.emplace_back(id, levelIndex);
+    stats.loadingLevels++;
+}
+
+void EvilutionGeometryStreamer::pollLoads() {
+    for (size_t i = 0; i < loadingLevels.size();) {
+        StreamedModel& model = models[loadingLevels[i].first];
+        Level& level = model.levels[loadingLevels[i].second];
+        if (evilutionResourceRegistry.isPending(level.model)) {
+            i++;
+            continue;
+        }
+
+        loadingBytes -= level.bytes;
+        stats.loadingLevels--;
+        EvilutionModel* loaded = evilutionResourceRegistry.getModel(level.model);
+        if (loaded != nullptr) {
+            GeometryRange geometry = loaded->getGeometry();
+            level.bytes = static_cast<VkDeviceSize>(geometry.vertexCount) * sizeof(EvilutionModel::Vertex) +
+                          static_cast<VkDeviceSize>(geometry.indexCount) * sizeof(uint32_t) +
+                          static_cast<VkDeviceSize>(geometry.meshletCount) * sizeof(Meshlet);
+            level.state = LevelState::Resident;
+            stats.loads++;
+            stats.residentLevels++;
+            stats.residentBytes += level.bytes;
+            if (!model.hasBounds) {
+                model.hasBounds = evilutionResourceRegistry.tryGetBounds(level.model, model.bounds);
+            }
+        } else {
+            // the cache has already reported why; giving the reference back lets it forget the entry. Failed
+            // levels are not retried, the model keeps drawing with the others.
+            evilutionAssetCache.releaseModel(level.model, false);
+            level.model = {};
+            level.state = LevelState::Failed;
+            stats.failedLoads++;
+        }
+
+        loadingLevels[i] = loadingLevels.back();
+        loadingLevels.pop_back();
+    }
+}
+
+void EvilutionGeometryStreamer::evict(StreamedModel& model, Level& level) {
+    assert(level.state == LevelState::Resident && "Only resident levels can be evicted");
+    // frees the geometry once frames that may draw it have completed, unless another user holds it
+    evilutionAssetCache.releaseModel(level.model, false);
+    level.model = {};
+    level.state = LevelState::Unloaded;
+    stats.evictions++;
+    stats.residentLevels--;
+    stats.residentBytes -= level.bytes;
+}
+
+void EvilutionGeometryStreamer::refreshBudget() {
+    deviceBudget = evilutionDevice.queryDeviceLocalMemoryBudget();
+    stats.budget = settings.memoryBudget;
+    if (!deviceBudget.reported) {
+        return;
+    }
+    // Usage counts the geometry pool's buffers whole, free ranges included, so this errs towards evicting
+    // early when memory runs short.
+    VkDeviceSize otherUsage = deviceBudget.usage > stats.residentBytes ? deviceBudget.usage - stats.residentBytes : 0;
+    VkDeviceSize room = deviceBudget.budget > otherUsage ? deviceBudget.budget - otherUsage : 0;
+    stats.budget = std::min(stats.budget, room);
+}
+
+void EvilutionGeometryStreamer::gatherEvictionCandidates() {
+    evictionCandidates.clear();
+    uint32_t coarsest = settings.levelCount - 1;
+    for (StreamedModelId id = 0; id < models.size(); id++) {
+        const StreamedModel& model = models[id];
+        for (uint32_t level = 0; level < coarsest; level++) {
+            // the snapshot being built draws it, and evicting it now would leave the model with nothing to draw
+            bool drawn = model.selectedUpdate == currentUpdate && model.drawnLevel == level;
+            if (model.levels[level].state != LevelState::Resident || drawn) {
+                continue;
+            }
+            bool wanted = model.selectedUpdate == currentUpdate && model.wantedLevel == level;
+            float age = static_cast<float>(currentUpdate - model.selectedUpdate);
+            float priority = wanted ? model.screenSize : -1.f - age;
+            evictionCandidates.push_back({priority, id, level});
+        }
+    }
+    std::sort(evictionCandidates.begin(), evictionCandidates.end(),
+              [](const EvictionCandidate& a, const EvictionCandidate& b) { return a.priority < b.priority; });
+}
+
+} // namespace evilution
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "evilution_asset_cache.hpp"
+#include "evilution_device.hpp"
+#include "evilution_resource_registry.hpp"
+#include "evilution_streamed_model_id.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace evilution {
+
+struct GeometryStreamingSettings {
+    // geometry the streamer keeps resident; lowered when the device reports less room than this
+    VkDeviceSize memoryBudget = 128 * 1024 * 1024;
+    // level 0 is the full model; the coarsest level is loaded up front and never evicted
+    uint32_t levelCount = 3;
+    // Level 0 is wanted from this projected radius, as a fraction of half the viewport height, and each coarser
+    // level from the previous level's size times the falloff.
+    float fullDetailScreenSize = 0.3f;
+    float screenSizeFalloff = 0.4f;
+    uint32_t maxLoadsInFlight = 4;
+    // how many updates pass between polls of the device budget, which are also the pressure samples kept
+    uint32_t sampleInterval = 60;
+    uint32_t maxSamples = 120;
+};
+
+// Keeps the geometry of streamed models within a memory budget. Every model has a chain of levels of detail
+// loaded through the asset cache; only the coarsest is always resident. Each frame the models being drawn report
+// how large they appear, and the streamer loads the level that size calls for, most important first, evicting
+// levels nobody is drawing (or, under pressure, the ones drawn smallest) to make room. Until a level arrives the
+// model is drawn with the closest one that is resident.
+//
+// With VK_EXT_memory_budget the budget also shrinks to what the device has left, so other allocations and other
+// processes push streamed geometry out instead of into paging.
+//
+// Not thread-safe: selection and updates happen on the thread that builds render snapshots.
+class EvilutionGeometryStreamer {
+  public:
+    struct Stats {
+        uint64_t loads = 0;
+        uint64_t evictions = 0;
+        // loads put off because they did not fit in the budget
+        uint64_t deferredLoads = 0;
+        uint64_t failedLoads = 0;
+        // updates that ended with more resident than the budget, coarsest levels alone can cause this
+        uint64_t updatesOverBudget = 0;
+        uint32_t loadingLevels = 0;
+        uint32_t residentLevels = 0;
+        VkDeviceSize residentBytes = 0;
+        VkDeviceSize budget = 0;
+        // resident and loading geometry over the budget
+        float pressure = 0.f;
+        float peakPressure = 0.f;
+    };
+
+    struct PressureSample {
+        uint64_t update = 0;
+        VkDeviceSize budget = 0;
+        VkDeviceSize residentBytes = 0;
+        DeviceMemoryBudget device{};
+    };
+
+    EvilutionGeometryStreamer(EvilutionDevice& device, EvilutionAssetCache& assetCache,
+                              EvilutionResourceRegistry& resourceRegistry,
+                              const GeometryStreamingSettings& settings = {});
+    ~EvilutionGeometryStreamer();
+
+    EvilutionGeometryStreamer(const EvilutionGeometryStreamer&) = delete;
+    EvilutionGeometryStreamer& operator=(const EvilutionGeometryStreamer&) = delete;
+
+    // Starts loading the coarsest level; the model has nothing to draw until it is resident.
+    StreamedModelId addModel(const std::string& filepath);
+
+    // bounding sphere in model space, from the first level that became resident
+    bool tryGetBounds(StreamedModelId model, glm::vec4& bounds) const;
+    // Records how large the model appears this frame and returns the most detailed resident level no finer than
+    // that size needs, or a finer one when nothing coarser is resident. Null while no level is resident.
+    ModelHandle selectLevel(StreamedModelId model, float screenSize);
+    // Once per frame after selection: picks up finished loads, evicts over the budget and starts the loads the
+    // largest models want.
+    void update();
+
+    Stats getStats() const { return stats; }
+    const std::deque<PressureSample>& getPressureHistory() const { return pressureHistory; }
+    void printStats(std::ostream& out) const;
+
+  private:
+    enum class LevelState : uint8_t { Unloaded, Loading, Resident, Failed };
+
+    struct Level {
+        ModelHandle model{};
+        LevelState state = LevelState::Unloaded;
+        // actual size once resident, kept after eviction; an estimate while loading
+        VkDeviceSize bytes = 0;
+    };
+
+    struct StreamedModel {
+        std::string path;
+        std::vector<Level> levels;
+        glm::vec4 bounds{0.f};
+        bool hasBounds = false;
+        // from the latest selectLevel()
+        float screenSize = 0.f;
+        uint32_t wantedLevel = 0;
+        // the level selectLevel() handed out to be drawn, which can be a fallback for wantedLevel
+        uint32_t drawnLevel = 0;
+        uint64_t selectedUpdate = 0;
+    };
+
+    struct EvictionCandidate {
+        // screen size for levels wanted this update, otherwise minus the updates since they were
+        float priority = 0.f;
+        StreamedModelId model = 0;
+        uint32_t level = 0;
+    };
+
+    uint32_t wantedLevelFor(float screenSize) const;
+    VkDeviceSize estimateBytes(const StreamedModel& model, uint32_t level) const;
+    void startLoad(StreamedModelId id, uint32_t level);
+    void pollLoads();
+    void evict(StreamedModel& model, Level& level);
+    void refreshBudget();
+    void gatherEvictionCandidates();
+
+    EvilutionDevice& evilutionDevice;
+    EvilutionAssetCache& evilutionAssetCache;
+    EvilutionResourceRegistry& evilutionResourceRegistry;
+    const GeometryStreamingSettings settings;
+
+    std::vector<StreamedModel> models;
+    std::vector<std::pair<StreamedModelId, uint32_t>> loadingLevels;
+    // selections made before the next update() are stamped with this
+    uint64_t currentUpdate = 1;
+    VkDeviceSize loadingBytes = 0;
+    DeviceMemoryBudget deviceBudget{};
+    Stats stats{};
+    std::deque<PressureSample> pressureHistory;
+
+    // reused between updates
+    std::vector<EvictionCandidate> evictionCandidates;
+    std::vector<StreamedModelId> loadCandidates;
+};
+
+} // namespace evilution
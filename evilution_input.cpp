@@ -0,0 +1,13 @@
+#include "evilution_input.hpp"
+
+namespace evilution {
+
+void InputState::sample(GLFWwindow* window) {
+    // keys below GLFW_KEY_SPACE are not valid key tokens
+    for (int key = GLFW_KEY_SPACE; key <= GLFW_KEY_LAST; key++) {
+        keys.set(key, glfwGetKey(window, key) == GLFW_PRESS);
+    }
+    sampleTime = Clock::now();
+}
+
+} // namespace evilution
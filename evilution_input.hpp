@@ -0,0 +1,27 @@
+#pragma once
+
+//lib
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+// std
+#include <bitset>
+#include <chrono>
+
+namespace evilution {
+
+// Keyboard state captured on the main thread, which is the only thread GLFW allows to poll. Other threads read
+// copies of it instead of querying the window.
+struct InputState {
+    using Clock = std::chrono::steady_clock;
+
+    std::bitset<GLFW_KEY_LAST + 1> keys{};
+    Clock::time_point sampleTime = Clock::now();
+
+    bool isKeyPressed(int key) const { return key >= 0 && key <= GLFW_KEY_LAST && keys.test(key); }
+
+    // main thread only
+    void sample(GLFWwindow* window);
+};
+
+} // namespace evilution
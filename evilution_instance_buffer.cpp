@@ -0,0 +1,300 @@
+#include "evilution_instance_buffer.hpp"
+#include "evilution_shaders.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace evilution {
+
+// instance_transforms.comp reads the records as a std430 array
+static_assert(sizeof(TransformUpdate) == 48, "TransformUpdate must match the compute shader's layout");
+
+namespace {
+constexpr uint32_t TRANSFORM_WORKGROUP_SIZE = 64;
+} // namespace
+
+EvilutionInstanceBuffer::EvilutionInstanceBuffer(EvilutionDevice& device, EvilutionPipelineManager& pipelineManager,
+                                                 uint32_t framesInFlight, bool gpuTransforms, uint32_t initialCapacity)
+    : evilutionDevice{device}, gpuTransforms{gpuTransforms}, staging(framesInFlight) {
+    assert(initialCapacity > 0 && "Instance buffer needs room for at least one instance");
+    capacity = initialCapacity;
+    evilutionDevice.createBuffer(
+        static_cast<VkDeviceSize>(capacity) * sizeof(InstanceData),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory);
+    stats.gpuTransforms = gpuTransforms;
+
+    if (gpuTransforms) {
+        createTransformPipeline(pipelineManager, framesInFlight);
+    }
+}
+
+EvilutionInstanceBuffer::~EvilutionInstanceBuffer() {
+    auto& deletionQueue = evilutionDevice.deletionQueue();
+    deletionQueue.destroyBuffer(buffer, memory);
+    // freeing the memory unmaps it
+    for (Staging& frameStaging : staging) {
+        deletionQueue.destroyBuffer(frameStaging.buffer, frameStaging.memory);
+    }
+    vkDestroyPipelineLayout(evilutionDevice.device(), transformPipelineLayout, nullptr);
+}
+
+void EvilutionInstanceBuffer::createTransformPipeline(EvilutionPipelineManager& pipelineManager,
+                                                      uint32_t framesInFlight) {
+    transformSetLayout = EvilutionDescriptorSetLayout::Builder(evilutionDevice)
+                             .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                             .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                             .build();
+    transformDescriptorPool = EvilutionDescriptorPool::Builder(evilutionDevice)
+                                  .setMaxSets(framesInFlight)
+                                  .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesInFlight * 2)
+                                  .build();
+    transformSets.resize(framesInFlight);
+    for (VkDescriptorSet& set : transformSets) {
+        if (!transformDescriptorPool->allocateDescriptor(transformSetLayout->getDescriptorSetLayout(), set)) {
+            throw std::runtime_error("failed to allocate instance transform descriptor set!");
+        }
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(uint32_t);
+
+    VkDescriptorSetLayout descriptorSetLayout = transformSetLayout->getDescriptorSetLayout();
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(evilutionDevice.device(), &pipelineLayoutInfo, nullptr, &transformPipelineLayout) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    transformPipeline = pipelineManager.createComputePipeline(shaders::instanceTransformsComp, transformPipelineLayout);
+}
+
+void EvilutionInstanceBuffer::reserveSlots(uint32_t instanceCount) {
+    this->instanceCount = std::max(this->instanceCount, instanceCount);
+    if (pendingIndexOf.size() < this->instanceCount) {
+        pendingIndexOf.resize(this->instanceCount, UINT32_MAX);
+    }
+}
+
+void EvilutionInstanceBuffer::queueUpdates(const std::vector<InstanceUpdate>& updates, uint32_t instanceCount) {
+    assert(!gpuTransforms && "Matrix updates queued on an instance buffer that builds its own matrices");
+    reserveSlots(instanceCount);
+
+    for (const InstanceUpdate& update : updates) {
+        assert(update.slot < this->instanceCount && "Instance update outside the reported slot count");
+        uint32_t& index = pendingIndexOf[update.slot];
+        if (index == UINT32_MAX) {
+            index = static_cast<uint32_t>(pending.size());
+            pending.push_back(update);
+        } else {
+            pending[index].data = update.data;
+        }
+    }
+}
+
+void EvilutionInstanceBuffer::queueTransformUpdates(const std::vector<TransformUpdate>& updates,
+                                                    uint32_t instanceCount) {
+    assert(gpuTransforms && "Transform updates queued on an instance buffer without gpuTransforms");
+    reserveSlots(instanceCount);
+
+    for (const TransformUpdate& update : updates) {
+        assert(update.slot < this->instanceCount && "Instance update outside the reported slot count");
+        uint32_t& index = pendingIndexOf[update.slot];
+        if (index == UINT32_MAX) {
+            index = static_cast<uint32_t>(pendingTransforms.size());
+            pendingTransforms.push_back(update);
+        } else {
+            pendingTransforms[index] = update;
+        }
+    }
+}
+
+void EvilutionInstanceBuffer::flush(VkCommandBuffer commandBuffer, int frameIndex) {
+    stats.frames++;
+    bool grew = instanceCount > capacity;
+    if (grew) {
+        grow(commandBuffer, instanceCount);
+    }
+    if (pending.empty() && pendingTransforms.empty()) {
+        if (grew) {
+            makeVisibleToShaders(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+        }
+        return;
+    }
+
+    if (gpuTransforms) {
+        computeMatrices(commandBuffer, frameIndex);
+    } else {
+        uploadMatrices(commandBuffer, frameIndex);
+    }
+}
+
+void EvilutionInstanceBuffer::uploadMatrices(VkCommandBuffer commandBuffer, int frameIndex) {
+    // in slot order, so neighbouring slots end up next to each other in staging and share one copy
+    std::sort(pending.begin(), pending.end(),
+              [](const InstanceUpdate& a, const InstanceUpdate& b) { return a.slot < b.slot; });
+
+    // the slot's previous frame has completed, so its staging is free to overwrite
+    Staging& frameStaging = staging[frameIndex];
+    ensureStaging(frameStaging, static_cast<VkDeviceSize>(pending.size()) * sizeof(InstanceData));
+
+    auto* stagingData = static_cast<InstanceData*>(frameStaging.mapped);
+    copies.clear();
+    for (size_t i = 0; i < pending.size(); i++) {
+        const InstanceUpdate& update = pending[i];
+        stagingData[i] = update.data;
+        pendingIndexOf[update.slot] = UINT32_MAX;
+
+        VkDeviceSize destination = static_cast<VkDeviceSize>(update.slot) * sizeof(InstanceData);
+        if (!copies.empty() && copies.back().dstOffset + copies.back().size == destination) {
+            copies.back().size += sizeof(InstanceData);
+        } else {
+            copies.push_back({static_cast<VkDeviceSize>(i) * sizeof(InstanceData), destination, sizeof(InstanceData)});
+        }
+    }
+
+    // earlier frames may still be reading the slots about to be overwritten
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdCopyBuffer(commandBuffer, frameStaging.buffer, buffer, static_cast<uint32_t>(copies.size()), copies.data());
+    makeVisibleToShaders(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    stats.uploadedInstances += pending.size();
+    stats.uploadedBytes += pending.size() * sizeof(InstanceData);
+    stats.copyRanges += copies.size();
+    pending.clear();
+}
+
+void EvilutionInstanceBuffer::computeMatrices(VkCommandBuffer commandBuffer, int frameIndex) {
+    // the shader writes every record to its own slot, so unlike the copies the order does not matter
+    Staging& frameStaging = staging[frameIndex];
+    ensureStaging(frameStaging, static_cast<VkDeviceSize>(pendingTransforms.size()) * sizeof(TransformUpdate));
+
+    auto* stagingData = static_cast<TransformUpdate*>(frameStaging.mapped);
+    for (size_t i = 0; i < pendingTransforms.size(); i++) {
+        stagingData[i] = pendingTransforms[i];
+        pendingIndexOf[pendingTransforms[i].slot] = UINT32_MAX;
+    }
+
+    // written every frame since growing replaces the instance buffer
+    VkDescriptorSet set = transformSets[frameIndex];
+    VkDescriptorBufferInfo updatesInfo{frameStaging.buffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo instancesInfo{buffer, 0, VK_WHOLE_SIZE};
+    EvilutionDescriptorWriter(*transformSetLayout, *transformDescriptorPool)
+        .writeBuffer(0, &updatesInfo)
+        .writeBuffer(1, &instancesInfo)
+        .overwrite(set);
+
+    // earlier frames may still be reading the slots about to be overwritten, and a grow may have just copied in
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    uint32_t updateCount = static_cast<uint32_t>(pendingTransforms.size());
+    transformPipeline->bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, transformPipelineLayout, 0, 1, &set, 0,
+                            nullptr);
+    vkCmdPushConstants(commandBuffer, transformPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t),
+                       &updateCount);
+    vkCmdDispatch(commandBuffer, (updateCount + TRANSFORM_WORKGROUP_SIZE - 1) / TRANSFORM_WORKGROUP_SIZE, 1, 1);
+    makeVisibleToShaders(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+    stats.uploadedInstances += pendingTransforms.size();
+    stats.uploadedBytes += pendingTransforms.size() * sizeof(TransformUpdate);
+    stats.dispatches++;
+    pendingTransforms.clear();
+}
+
+void EvilutionInstanceBuffer::makeVisibleToShaders(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage,
+                                                   VkAccessFlags srcAccess) {
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStage,
+                         VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0,
+                         nullptr, 0, nullptr);
+}
+
+void EvilutionInstanceBuffer::grow(VkCommandBuffer commandBuffer, uint32_t requiredCapacity) {
+    uint32_t newCapacity = capacity;
+    while (newCapacity < requiredCapacity) {
+        newCapacity *= 2;
+    }
+
+    VkBuffer newBuffer;
+    VkDeviceMemory newMemory;
+    evilutionDevice.createBuffer(
+        static_cast<VkDeviceSize>(newCapacity) * sizeof(InstanceData),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, newBuffer, newMemory);
+
+    // slots that do not change this frame keep what was uploaded before; earlier frames' writes into the old
+    // buffer have to land first, copies or, with gpuTransforms, the transform shader's
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    VkBufferCopy copy{0, 0, static_cast<VkDeviceSize>(capacity) * sizeof(InstanceData)};
+    vkCmdCopyBuffer(commandBuffer, buffer, newBuffer, 1, &copy);
+
+    // frames still in flight read the old buffer
+    evilutionDevice.deletionQueue().destroyBuffer(buffer, memory);
+    buffer = newBuffer;
+    memory = newMemory;
+    capacity = newCapacity;
+    stats.growCount++;
+}
+
+void EvilutionInstanceBuffer::ensureStaging(Staging& frameStaging, VkDeviceSize size) {
+    if (frameStaging.size >= size) {
+        return;
+    }
+    // the frame that last used it has completed, but the deletion queue is the one place buffers are freed
+    evilutionDevice.deletionQueue().destroyBuffer(frameStaging.buffer, frameStaging.memory);
+
+    frameStaging.size = std::max(size, frameStaging.size * 2);
+    // the copies read it as a transfer source, the transform shader as a storage buffer
+    evilutionDevice.createBuffer(
+        frameStaging.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frameStaging.buffer,
+        frameStaging.memory);
+    vkMapMemory(evilutionDevice.device(), frameStaging.memory, 0, VK_WHOLE_SIZE, 0, &frameStaging.mapped);
+}
+
+void EvilutionInstanceBuffer::Stats::print(std::ostream& out) const {
+    double perFrame = frames > 0 ? 1.0 / static_cast<double>(frames) : 0.0;
+    out << "instance uploads: " << static_cast<double>(uploadedBytes) * perFrame / 1024.0 << " KiB in ";
+    if (gpuTransforms) {
+        out << static_cast<double>(dispatches) * perFrame << " transform dispatches per frame (";
+    } else {
+        out << static_cast<double>(copyRanges) * perFrame << " ranges per frame (";
+    }
+    out << static_cast<double>(uploadedInstances) * perFrame << " instances) over " << frames << " frames, grew "
+        << growCount << " times" << std::endl;
+}
+
+} // namespace evilution
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "evilution_descriptors.hpp"
+#include "evilution_device.hpp"
+#include "evilution_pipeline.hpp"
+#include "evilution_pipeline_manager.hpp"
+#include "evilution_render_snapshot.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace evilution {
+
+// Device-local storage buffer mirroring InstanceData for every instance slot the EvilutionInstanceTracker hands
+// out. Only changed slots are uploaded: they are staged through a persistently mapped buffer per frame in flight
+// and copied in as contiguous ranges, so a mostly static scene costs a few copies a frame rather than the whole
+// buffer. Used by the render thread only.
+//
+// With gpuTransforms the changes arrive as translation, rotation and scale instead: those are staged the same way
+// and a compute shader builds the matrices straight into the buffer, so the CPU uploads 48 bytes per changed
+// instance instead of 128 and does no matrix math.
+class EvilutionInstanceBuffer {
+  public:
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t uploadedInstances = 0;
+        uint64_t uploadedBytes = 0;
+        uint64_t copyRanges = 0;
+        uint64_t growCount = 0;
+        uint64_t dispatches = 0;
+        bool gpuTransforms = false;
+
+        void print(std::ostream& out) const;
+    };
+
+    EvilutionInstanceBuffer(EvilutionDevice& device, EvilutionPipelineManager& pipelineManager,
+                            uint32_t framesInFlight, bool gpuTransforms = false,
+                            uint32_t initialCapacity = 1 << 12);
+    ~EvilutionInstanceBuffer();
+
+    EvilutionInstanceBuffer(const EvilutionInstanceBuffer&) = delete;
+    EvilutionInstanceBuffer& operator=(const EvilutionInstanceBuffer&) = delete;
+
+    // For every snapshot the render thread consumes, including ones it ends up not drawing, so no change is
+    // lost. A slot updated again before the next flush keeps only its latest data.
+    void queueUpdates(const std::vector<InstanceUpdate>& updates, uint32_t instanceCount);
+    // the gpuTransforms counterpart of queueUpdates
+    void queueTransformUpdates(const std::vector<TransformUpdate>& updates, uint32_t instanceCount);
+    // Records the queued updates into the frame's command buffer, outside any render pass, followed by a barrier
+    // that makes them visible to vertex and compute shaders. Grows the buffer first if the slots outgrew it.
+    void flush(VkCommandBuffer commandBuffer, int frameIndex);
+
+    // replaced when the buffer grows, so descriptors have to be written after the frame's flush
+    VkBuffer getBuffer() const { return buffer; }
+    uint32_t getCapacity() const { return capacity; }
+    const Stats& getStats() const { return stats; }
+
+  private:
+    struct Staging {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        VkDeviceSize size = 0;
+    };
+
+    void createTransformPipeline(EvilutionPipelineManager& pipelineManager, uint32_t framesInFlight);
+    void reserveSlots(uint32_t instanceCount);
+    void uploadMatrices(VkCommandBuffer commandBuffer, int frameIndex);
+    void computeMatrices(VkCommandBuffer commandBuffer, int frameIndex);
+    void grow(VkCommandBuffer commandBuffer, uint32_t requiredCapacity);
+    void makeVisibleToShaders(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStage,
+                              VkAccessFlags srcAccess);
+    void ensureStaging(Staging& staging, VkDeviceSize size);
+
+    EvilutionDevice& evilutionDevice;
+    const bool gpuTransforms;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    uint32_t capacity = 0;
+    uint32_t instanceCount = 0;
+
+    std::vector<Staging> staging;
+    std::vector<InstanceUpdate> pending;
+    std::vector<TransformUpdate> pendingTransforms;
+    // index into pending or pendingTransforms by slot, UINT32_MAX when the slot has nothing queued
+    std::vector<uint32_t> pendingIndexOf;
+    std::vector<VkBufferCopy> copies;
+
+    // gpuTransforms only: the staged updates and the instance buffer, one set per frame in flight
+    std::unique_ptr<EvilutionDescriptorSetLayout> transformSetLayout;
+    std::unique_ptr<EvilutionDescriptorPool> transformDescriptorPool;
+    std::vector<VkDescriptorSet> transformSets;
+    VkPipelineLayout transformPipelineLayout = VK_NULL_HANDLE;
+    std::unique_ptr<EvilutionComputePipeline> transformPipeline;
+
+    Stats stats{};
+};
+
+} // namespace evilution
@@ -0,0 +1,79 @@
+#include "evilution_instance_tracker.hpp"
+
+namespace evilution {
+
+namespace {
+bool sameTransform(const TransformComponent& a, const TransformComponent& b) {
+    return a.translation == b.translation && a.scale == b.scale && a.rotation == b.rotation;
+}
+} // namespace
+
+EvilutionInstanceTracker::EvilutionInstanceTracker(entt::registry& registry, bool gpuTransforms)
+    : registry{registry}, gpuTransforms{gpuTransforms} {
+    registry.on_destroy<RenderComponent>().connect<&EvilutionInstanceTracker::onRenderableRemoved>(*this);
+    registry.on_destroy<TransformComponent>().connect<&EvilutionInstanceTracker::onRenderableRemoved>(*this);
+    registry.on_destroy<InstanceSlotComponent>().connect<&EvilutionInstanceTracker::onSlotRemoved>(*this);
+}
+
+EvilutionInstanceTracker::~EvilutionInstanceTracker() {
+    registry.on_destroy<RenderComponent>().disconnect<&EvilutionInstanceTracker::onRenderableRemoved>(*this);
+    registry.on_destroy<TransformComponent>().disconnect<&EvilutionInstanceTracker::onRenderableRemoved>(*this);
+    registry.on_destroy<InstanceSlotComponent>().disconnect<&EvilutionInstanceTracker::onSlotRemoved>(*this);
+}
+
+void EvilutionInstanceTracker::onRenderableRemoved(entt::registry&, entt::entity entity) {
+    pendingRemovals.push_back(entity);
+}
+
+void EvilutionInstanceTracker::onSlotRemoved(entt::registry& registry, entt::entity entity) {
+    // nothing draws from a freed slot, so its stale contents never need clearing
+    freeSlots.push_back(registry.get<InstanceSlotComponent>(entity).slot);
+}
+
+uint32_t EvilutionInstanceTracker::allocateSlot() {
+    if (!freeSlots.empty()) {
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    reportedTransforms.emplace_back();
+    return static_cast<uint32_t>(reportedTransforms.size() - 1);
+}
+
+void EvilutionInstanceTracker::update(entt::registry& registry, std::vector<InstanceUpdate>& updates,
+                                      std::vector<TransformUpdate>& transformUpdates) {
+    // destroyed entities already lost their slot along with their other components; this catches entities that
+    // only stopped being renderable
+    for (entt::entity entity : pendingRemovals) {
+        if (registry.valid(entity) && registry.all_of<InstanceSlotComponent>(entity) &&
+            !registry.all_of<TransformComponent, RenderComponent>(entity)) {
+            registry.remove<InstanceSlotComponent>(entity);
+        }
+    }
+    pendingRemovals.clear();
+
+    auto renderables = registry.view<TransformComponent, RenderComponent>();
+    for (entt::entity entity : renderables) {
+        TransformComponent& transform = renderables.get<TransformComponent>(entity);
+        const InstanceSlotComponent* instance = registry.try_get<InstanceSlotComponent>(entity);
+        if (instance == nullptr) {
+            instance = &registry.emplace<InstanceSlotComponent>(entity, allocateSlot());
+        } else if (sameTransform(reportedTransforms[instance->slot], transform)) {
+            continue;
+        }
+
+        reportedTransforms[instance->slot] = transform;
+        if (gpuTransforms) {
+            TransformUpdate update{};
+            update.translation = transform.translation;
+            update.slot = instance->slot;
+            update.rotation = transform.rotation;
+            update.scale = transform.scale;
+            transformUpdates.push_back(update);
+        } else {
+            updates.push_back({instance->slot, {transform.mat4(), transform.normalMatrix()}});
+        }
+    }
+}
+
+} // namespace evilution
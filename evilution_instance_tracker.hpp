@@ -0,0 +1,51 @@
+#pragma once
+
+#include "evilution_components.hpp"
+#include "evilution_render_snapshot.hpp"
+
+#include <entt/entt.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace evilution {
+
+// Gives every entity with a TransformComponent and a RenderComponent a stable slot in the GPU instance buffer and
+// reports the slots whose transform changed since the last update. Changes are found by comparing against the
+// transform last reported for the slot, so systems can keep writing components directly. Runs on the simulation
+// thread.
+//
+// With gpuTransforms the changes are reported as translation, rotation and scale for a compute shader to turn
+// into matrices, and the tracker does no matrix math at all.
+class EvilutionInstanceTracker {
+  public:
+    explicit EvilutionInstanceTracker(entt::registry& registry, bool gpuTransforms = false);
+    ~EvilutionInstanceTracker();
+
+    EvilutionInstanceTracker(const EvilutionInstanceTracker&) = delete;
+    EvilutionInstanceTracker& operator=(const EvilutionInstanceTracker&) = delete;
+
+    // appends an update for every slot that was assigned or whose transform changed since the last call, to
+    // transformUpdates with gpuTransforms and to updates otherwise
+    void update(entt::registry& registry, std::vector<InstanceUpdate>& updates,
+                std::vector<TransformUpdate>& transformUpdates);
+
+    // one past the highest slot ever assigned; freed slots are reused before it grows
+    uint32_t getSlotCount() const { return static_cast<uint32_t>(reportedTransforms.size()); }
+
+  private:
+    void onRenderableRemoved(entt::registry& registry, entt::entity entity);
+    void onSlotRemoved(entt::registry& registry, entt::entity entity);
+    uint32_t allocateSlot();
+
+    entt::registry& registry;
+    const bool gpuTransforms;
+
+    // the registry signals fire during structural changes, which never overlap an update
+    std::vector<entt::entity> pendingRemovals;
+    std::vector<uint32_t> freeSlots;
+    std::vector<TransformComponent> reportedTransforms;
+};
+
+} // namespace evilution
@@ -0,0 +1,209 @@
+#include "evilution_job_system.hpp"
+
+// std
+#include <cassert>
+
+namespace evilution {
+
+namespace {
+
+struct ThreadSlot {
+    const EvilutionJobSystem* jobSystem = nullptr;
+    uint32_t workerIndex = 0;
+};
+thread_local ThreadSlot currentThread{};
+
+// xorshift, only used to spread steal attempts across victims
+uint32_t nextRandom() {
+    thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+} // namespace
+
+EvilutionJobSystem::EvilutionJobSystem(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    workers.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    workerZeroThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    for (uint32_t i = 1; i < threadCount; i++) {
+        workers[i]->thread = std::thread{&EvilutionJobSystem::workerLoop, this, i};
+    }
+}
+
+EvilutionJobSystem::~EvilutionJobSystem() {
+    {
+        std::lock_guard<std::mutex> lock{sleepMutex};
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    assert(queuedJobs.load() <= 0 && "job system destroyed with jobs still queued");
+}
+
+void EvilutionJobSystem::adoptCallingThread() {
+    // worker 0's deque is owned by one thread at a time, so the handover has to happen while it is empty
+    assert(queuedJobs.load() <= 0 && "worker 0 can only be adopted before jobs are submitted");
+    workerZeroThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+}
+
+uint32_t EvilutionJobSystem::currentWorkerIndex() const {
+    if (currentThread.jobSystem == this) {
+        return currentThread.workerIndex;
+    }
+    return workerZeroThread.load(std::memory_order_relaxed) == std::this_thread::get_id() ? 0 : NOT_A_WORKER;
+}
+
+void EvilutionJobSystem::run(std::function<void()> function, EvilutionJobCounter* counter) {
+    if (counter != nullptr) {
+        counter->pending.fetch_add(1, std::memory_order_seq_cst);
+    }
+    push(new EvilutionJob{std::move(function), counter});
+}
+
+void EvilutionJobSystem::runAfter(EvilutionJobCounter& dependency, std::function<void()> function,
+                                  EvilutionJobCounter* counter) {
+    if (counter != nullptr) {
+        counter->pending.fetch_add(1, std::memory_order_seq_cst);
+    }
+    auto job = new EvilutionJob{std::move(function), counter};
+
+    {
+        // finish() empties the list under the same lock after the count reaches zero
+        std::lock_guard<std::mutex> lock{dependency.continuationMutex};
+        if (dependency.pending.load(std::memory_order_seq_cst) != 0) {
+            dependency.continuations.push_back(job);
+            return;
+        }
+    }
+    push(job);
+}
+
+void EvilutionJobSystem::wait(const EvilutionJobCounter& counter) {
+    uint32_t workerIndex = currentWorkerIndex();
+    while (!counter.isDone()) {
+        if (EvilutionJob* job = findJob(workerIndex)) {
+            execute(job);
+        } else {
+            // the remaining jobs are running elsewhere
+            std::this_thread::yield();
+        }
+    }
+}
+
+void EvilutionJobSystem::push(EvilutionJob* job) {
+    uint32_t workerIndex = currentWorkerIndex();
+    if (workerIndex != NOT_A_WORKER) {
+        workers[workerIndex]->deque.push(job);
+    } else {
+        std::lock_guard<std::mutex> lock{injectionMutex};
+        injectionQueue.push_back(job);
+        injectionQueueEmpty.store(false, std::memory_order_relaxed);
+    }
+
+    // a sleeping worker either sees the new count before it waits or is woken here
+    queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepingWorkers.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock{sleepMutex};
+        sleepCondition.notify_one();
+    }
+}
+
+EvilutionJob* EvilutionJobSystem::findJob(uint32_t workerIndex) {
+    EvilutionJob* job = nullptr;
+    if (workerIndex != NOT_A_WORKER) {
+        job = workers[workerIndex]->deque.pop();
+    }
+
+    if (job == nullptr && !injectionQueueEmpty.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock{injectionMutex};
+        if (!injectionQueue.empty()) {
+            job = injectionQueue.front();
+            injectionQueue.pop_front();
+        }
+        injectionQueueEmpty.store(injectionQueue.empty(), std::memory_order_relaxed);
+    }
+
+    if (job == nullptr) {
+        uint32_t workerCount = static_cast<uint32_t>(workers.size());
+        uint32_t start = nextRandom() % workerCount;
+        for (uint32_t i = 0; i < workerCount && job == nullptr; i++) {
+            uint32_t victim = (start + i) % workerCount;
+            if (victim != workerIndex) {
+                job = workers[victim]->deque.steal();
+            }
+        }
+    }
+
+    if (job != nullptr) {
+        queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+void EvilutionJobSystem::execute(EvilutionJob* job) {
+    job->function();
+    EvilutionJobCounter* counter = job->counter;
+    delete job;
+    if (counter != nullptr) {
+        finish(*counter);
+    }
+}
+
+void EvilutionJobSystem::finish(EvilutionJobCounter& counter) {
+    // keeps isDone() false until this thread stops touching the counter
+    counter.finishing.fetch_add(1, std::memory_order_seq_cst);
+    if (counter.pending.fetch_sub(1, std::memory_order_seq_cst) == 1) {
+        std::vector<EvilutionJob*> ready;
+        {
+            std::lock_guard<std::mutex> lock{counter.continuationMutex};
+            ready.swap(counter.continuations);
+        }
+        for (EvilutionJob* job : ready) {
+            push(job);
+        }
+    }
+    counter.finishing.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void EvilutionJobSystem::workerLoop(uint32_t workerIndex) {
+    currentThread = {this, workerIndex};
+
+    int idleSpins = 0;
+    while (!stopping.load(std::memory_order_relaxed)) {
+        if (EvilutionJob* job = findJob(workerIndex)) {
+            execute(job);
+            idleSpins = 0;
+            continue;
+        }
+
+        if (++idleSpins < SPINS_BEFORE_SLEEP) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock{sleepMutex};
+        sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        sleepCondition.wait(lock, [this] {
+            return stopping.load(std::memory_order_relaxed) || queuedJobs.load(std::memory_order_seq_cst) > 0;
+        });
+        sleepingWorkers.fetch_sub(1, std::memory_order_seq_cst);
+        idleSpins = 0;
+    }
+}
+
+} // namespace evilution
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "evilution_work_stealing_deque.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace evilution {
+
+class EvilutionJobSystem;
+struct EvilutionJob;
+
+// Counts outstanding jobs. Wait on it with EvilutionJobSystem::wait, or chain jobs to it with runAfter. Must
+// outlive every job that references it.
+class EvilutionJobCounter {
+  public:
+    EvilutionJobCounter() = default;
+    EvilutionJobCounter(const EvilutionJobCounter&) = delete;
+    EvilutionJobCounter& operator=(const EvilutionJobCounter&) = delete;
+
+    // also false while the last job is still handing off continuations, so a done counter can be destroyed
+    bool isDone() const {
+        return pending.load(std::memory_order_seq_cst) == 0 && finishing.load(std::memory_order_seq_cst) == 0;
+    }
+
+  private:
+    friend class EvilutionJobSystem;
+
+    std::atomic<uint32_t> pending{0};
+    std::atomic<uint32_t> finishing{0};
+    std::mutex continuationMutex;
+    std::vector<EvilutionJob*> continuations;
+};
+
+struct EvilutionJob {
+    std::function<void()> function;
+    EvilutionJobCounter* counter = nullptr;
+};
+
+// Work-stealing thread pool shared by every parallel part of the engine. Each worker owns a Chase-Lev deque:
+// jobs spawned on a worker go to its own deque and run newest-first, idle workers steal the oldest jobs from
+// others. The thread that creates the system counts as worker 0, or whichever thread adopts that role later, and
+// runs jobs whenever it waits; other threads submit through a shared queue and also help while they wait.
+// Dependencies are expressed with counters rather than fibers, so a job never suspends. Jobs must not throw.
+class EvilutionJobSystem {
+  public:
+    // threadCount includes the calling thread; 0 uses one thread per hardware thread
+    explicit EvilutionJobSystem(uint32_t threadCount = 0);
+    ~EvilutionJobSystem();
+
+    EvilutionJobSystem(const EvilutionJobSystem&) = delete;
+    EvilutionJobSystem& operator=(const EvilutionJobSystem&) = delete;
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+    // Makes the calling thread worker 0 in place of the creating thread, for a system built on one thread but
+    // driven from another. Call before any job is submitted; the creating thread then submits like any other.
+    void adoptCallingThread();
+
+    void run(std::function<void()> function, EvilutionJobCounter* counter = nullptr);
+    // queued once dependency reaches zero, immediately if it already has
+    void runAfter(EvilutionJobCounter& dependency, std::function<void()> function,
+                  EvilutionJobCounter* counter = nullptr);
+    // runs other jobs until the counter reaches zero
+    void wait(const EvilutionJobCounter& counter);
+
+    // Calls function(begin, end) on disjoint chunks of [0, count) of at most grainSize items and returns when all
+    // are done. The range is split in halves so a single steal takes a large share of the remaining work.
+    template <typename Function>
+    void parallelFor(uint32_t count, uint32_t grainSize, Function&& function) {
+        if (count == 0) {
+            return;
+        }
+        EvilutionJobCounter counter;
+        splitRange(0, count, std::max(grainSize, 1u), function, counter);
+        wait(counter);
+    }
+
+    // Calls function(entity) for every entity in an entt view. Components may be modified but not added or
+    // removed, and two entities must not write the same data.
+    template <typename View, typename Function>
+    void parallelForEach(const View& view, Function&& function, uint32_t grainSize = 256) {
+        // multi-component view iterators are forward only, so split a copy of the entity list instead
+        using Entity = std::decay_t<decltype(*view.begin())>;
+        std::vector<Entity> entities(view.begin(), view.end());
+        parallelFor(static_cast<uint32_t>(entities.size()), grainSize, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                function(entities[i]);
+            }
+        });
+    }
+
+  private:
+    static constexpr uint32_t NOT_A_WORKER = UINT32_MAX;
+    static constexpr int SPINS_BEFORE_SLEEP = 64;
+
+    struct alignas(64) Worker {
+        EvilutionWorkStealingDeque<EvilutionJob> deque;
+        std::thread thread;
+    };
+
+    template <typename Function>
+    void splitRange(uint32_t begin, uint32_t end, uint32_t grainSize, Function& function,
+                    EvilutionJobCounter& counter) {
+        while (end - begin > grainSize) {
+            uint32_t middle = begin + (end - begin) / 2;
+            run([this, middle, end, grainSize, &function, &counter] {
+                splitRange(middle, end, grainSize, function, counter);
+            }, &counter);
+            end = middle;
+        }
+        function(begin, end);
+    }
+
+    uint32_t currentWorkerIndex() const;
+    void push(EvilutionJob* job);
+    EvilutionJob* findJob(uint32_t workerIndex);
+    void execute(EvilutionJob* job);
+    void finish(EvilutionJobCounter& counter);
+    void workerLoop(uint32_t workerIndex);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    // worker 0 runs on a thread the system did not start, so it is identified by id rather than thread_local
+    std::atomic<std::thread::id> workerZeroThread;
+
+    // for threads that are not workers
+    std::mutex injectionMutex;
+    std::deque<EvilutionJob*> injectionQueue;
+    std::atomic<bool> injectionQueueEmpty{true};
+
+    // jobs pushed but not yet taken, so idle workers can sleep instead of spinning
+    std::atomic<int64_t> queuedJobs{0};
+    std::atomic<uint32_t> sleepingWorkers{0};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<bool> stopping{false};
+};
+
+} // namespace evilution
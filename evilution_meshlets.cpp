@@ -0,0 +1,171 @@
+#include "evilution_meshlets.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace evilution {
+
+namespace {
+void computeMeshletBounds(Meshlet& meshlet, const std::vector<glm::vec3>& positions, const uint32_t* triangles) {
+    uint32_t cornerCount = meshlet.triangleCount * 3;
+
+    // centered on the average corner, which is close enough to the minimal sphere for culling
+    glm::vec3 center{0.f};
+    for (uint32_t i = 0; i < cornerCount; i++) {
+        center += positions[triangles[i]];
+    }
+    center *= 1.f / static_cast<float>(cornerCount);
+    float radius = 0.f;
+    for (uint32_t i = 0; i < cornerCount; i++) {
+        radius = std::max(radius, glm::length(positions[triangles[i]] - center));
+    }
+    meshlet.boundingSphere = glm::vec4{center, radius};
+
+    auto faceNormal = [&](uint32_t triangle, glm::vec3& normal) {
+        const glm::vec3& a = positions[triangles[triangle * 3]];
+        const glm::vec3& b = positions[triangles[triangle * 3 + 1]];
+        const glm::vec3& c = positions[triangles[triangle * 3 + 2]];
+        normal = glm::cross(b - a, c - a);
+        float length = glm::length(normal);
+        if (length == 0.f) {
+            return false;
+        }
+        normal *= 1.f / length;
+        return true;
+    };
+
+    glm::vec3 normalSum{0.f};
+    glm::vec3 normal;
+    for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++) {
+        if (faceNormal(triangle, normal)) {
+            normalSum += normal;
+        }
+    }
+    float axisLength = glm::length(normalSum);
+    if (axisLength == 0.f) {
+        return;
+    }
+    glm::vec3 axis = normalSum * (1.f / axisLength);
+
+    float minDot = 1.f;
+    for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++) {
+        if (faceNormal(triangle, normal)) {
+            minDot = std::min(minDot, glm::dot(axis, normal));
+        }
+    }
+    // normals spread over a hemisphere or more face the camera from every side
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = minDot <= 0.f ? 1.f : std::sqrt(1.f - minDot * minDot);
+}
+} // namespace
+
+std::vector<Meshlet> buildMeshlets(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices,
+                                   uint32_t maxVertices, uint32_t maxTriangles) {
+    assert(indices.size() % 3 == 0 && "Meshlets are built from triangle lists");
+    assert(maxVertices >= 3 && maxTriangles >= 1 && "A meshlet must fit at least one triangle");
+
+    std::vector<Meshlet> meshlets;
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+    if (triangleCount == 0) {
+        return meshlets;
+    }
+
+    // the triangles around each vertex, as offsets into one array
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t index : indices) {
+        adjacencyOffsets[index + 1]++;
+    }
+    for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+        adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            adjacency[adjacencyFill[indices[triangle * 3 + corner]]++] = triangle;
+        }
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    // the meshlet each vertex was last added to, so membership is a single compare
+    std::vector<uint32_t> vertexMeshlet(vertexCount, UINT32_MAX);
+    std::vector<uint32_t> meshletVertices;
+    meshletVertices.reserve(maxVertices);
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    uint32_t seedCursor = 0;
+
+    while (reordered.size() < indices.size()) {
+        uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+        Meshlet meshlet{};
+        meshlet.firstIndex = static_cast<uint32_t>(reordered.size());
+        meshletVertices.clear();
+
+        auto newVertices = [&](uint32_t triangle) {
+            const uint32_t* corners = &indices[triangle * 3];
+            uint32_t count = 0;
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                bool repeated = (corner > 0 && corners[corner] == corners[0]) ||
+                                (corner > 1 && corners[corner] == corners[1]);
+                if (vertexMeshlet[corners[corner]] != meshletIndex && !repeated) {
+                    count++;
+                }
+            }
+            return count;
+        };
+        auto addTriangle = [&](uint32_t triangle) {
+            emitted[triangle] = true;
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                if (vertexMeshlet[vertex] != meshletIndex) {
+                    vertexMeshlet[vertex] = meshletIndex;
+                    meshletVertices.push_back(vertex);
+                }
+                reordered.push_back(vertex);
+            }
+            meshlet.triangleCount++;
+        };
+
+        while (emitted[seedCursor]) {
+            seedCursor++;
+        }
+        addTriangle(seedCursor);
+
+        // grow through neighbours, preferring those that add the fewest vertices
+        while (meshlet.triangleCount < maxTriangles) {
+            uint32_t best = UINT32_MAX;
+            uint32_t bestNewVertices = 4;
+            for (uint32_t vertex : meshletVertices) {
+                for (uint32_t i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++) {
+                    uint32_t triangle = adjacency[i];
+                    if (emitted[triangle]) {
+                        continue;
+                    }
+                    uint32_t added = newVertices(triangle);
+                    if (added < bestNewVertices && meshletVertices.size() + added <= maxVertices) {
+                        best = triangle;
+                        bestNewVertices = added;
+                    }
+                }
+                if (bestNewVertices == 0) {
+                    break;
+                }
+            }
+            if (best == UINT32_MAX) {
+                break;
+            }
+            addTriangle(best);
+        }
+
+        computeMeshletBounds(meshlet, positions, reordered.data() + meshlet.firstIndex);
+        meshlets.push_back(meshlet);
+    }
+
+    indices = std::move(reordered);
+    return meshlets;
+}
+
+} // namespace evilution
@@ -0,0 +1,40 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace evilution {
+
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// A cluster of neighbouring triangles that is culled as a unit. Laid out as the culling shader reads it (std430).
+struct Meshlet {
+    // model space center and radius
+    glm::vec4 boundingSphere{0.f};
+    // Every face normal lies within this cone. The cluster faces away from a camera at c when
+    // dot(center - c, axis) >= cutoff * length(center - c) + radius. A cutoff of 1 never culls.
+    glm::vec3 coneAxis{0.f, 0.f, 1.f};
+    float coneCutoff = 1.f;
+    // relative to the first index of the model's geometry
+    uint32_t firstIndex = 0;
+    uint32_t triangleCount = 0;
+    uint32_t padding[2]{};
+};
+static_assert(sizeof(Meshlet) == 48, "Meshlet must match the layout the culling shader reads");
+
+// Groups the triangles of indexed geometry into meshlets of at most maxVertices unique vertices and maxTriangles
+// triangles, growing each one through triangles that share vertices with it. The triangles are reordered so each
+// meshlet is a contiguous index range. Face normals follow the right-handed winding that
+// VK_FRONT_FACE_COUNTER_CLOCKWISE treats as front facing.
+std::vector<Meshlet> buildMeshlets(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices,
+                                   uint32_t maxVertices = MESHLET_MAX_VERTICES,
+                                   uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+} // namespace evilution
@@ -8,6 +8,8 @@
 #include <glm/gtx/hash.hpp>
 
 //std
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 #include <unordered_map>
 
@@ -24,100 +26,80 @@ namespace std {
 
 namespace evilution {
 
-EvilutionModel::EvilutionModel(EvilutionDevice& device, const Builder& builder)
-    : evilutionDevice{device} {
-    createVertexBuffers(builder.vertices);
-    createIndexBuffers(builder.indices);
+EvilutionModel::EvilutionModel(EvilutionGeometryPool& geometryPool, const Builder& builder)
+    : evilutionGeometryPool{geometryPool} {
+    assert(builder.vertices.size() >= 3 && "Vertex count must be at least 3");
+    assert(builder.indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+    assert(geometryPool.getVertexStride() == sizeof(Vertex) && "Geometry pool was created for another vertex format");
+
+    if (!builder.meshlets.empty() || builder.indices.empty()) {
+        geometryAllocation = evilutionGeometryPool.allocate(
+            builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size()),
+            builder.indices.empty() ? nullptr : builder.indices.data(), static_cast<uint32_t>(builder.indices.size()),
+            builder.meshlets.empty() ? nullptr : builder.meshlets.data(),
+            static_cast<uint32_t>(builder.meshlets.size()));
+    } else {
+        // reordering the triangles leaves the surface unchanged, so the builder does not have to be
+        Builder clustered{};
+        clustered.vertices = builder.vertices;
+        clustered.indices = builder.indices;
+        clustered.buildMeshlets();
+        geometryAllocation = evilutionGeometryPool.allocate(
+            clustered.vertices.data(), static_cast<uint32_t>(clustered.vertices.size()), clustered.indices.data(),
+            static_cast<uint32_t>(clustered.indices.size()), clustered.meshlets.data(),
+            static_cast<uint32_t>(clustered.meshlets.size()));
+    }
+    computeBounds(builder.vertices);
 }
 
-EvilutionModel::~EvilutionModel() {
-    vkDestroyBuffer(evilutionDevice.device(), vertexBuffer, nullptr);
-    vkFreeMemory(evilutionDevice.device(), vertexBufferMemory, nullptr);
-
-    if (hasIndexBuffer) {
-        vkDestroyBuffer(evilutionDevice.device(), indexBuffer, nullptr);
-        vkFreeMemory(evilutionDevice.device(), indexBufferMemory, nullptr);
-    }
+EvilutionModel::EvilutionModel(EvilutionGeometryPool& geometryPool, GeometryAllocationId allocation,
+                               const Builder& builder)
+    : evilutionGeometryPool{geometryPool}, geometryAllocation{allocation} {
+    computeBounds(builder.vertices);
 }
 
-std::unique_ptr<EvilutionModel> EvilutionModel::createModelFromFile(EvilutionDevice& device, const std::string& filepath) {
+// frames in flight may still draw the range; the pool only reuses it once they have completed
+EvilutionModel::~EvilutionModel() { evilutionGeometryPool.free(geometryAllocation); }
+
+std::unique_ptr<EvilutionModel> EvilutionModel::createModelFromFile(EvilutionGeometryPool& geometryPool,
+                                                                   const std::string& filepath) {
     Builder builder {};
     builder.loadModel(filepath);
+    builder.buildMeshlets();
     std::cout << "Vertex count: " << builder.vertices.size() << std::endl;
-    return std::make_unique<EvilutionModel>(device, builder);
+    return std::make_unique<EvilutionModel>(geometryPool, builder);
 }
 
-void EvilutionModel::createIndexBuffers(const std::vector<uint32_t>& indices) {
-    indexCount = static_cast<uint32_t>(indices.size());
-    hasIndexBuffer = indexCount > 0;
-
-    if (!hasIndexBuffer) {
+void EvilutionModel::computeBounds(const std::vector<Vertex>& vertices) {
+    if (vertices.empty()) {
         return;
     }
 
-    assert(indexCount % 3 == 0 && "Index count must be a multiple of 3");
-    VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    evilutionDevice.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                 stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(evilutionDevice.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(evilutionDevice.device(), stagingBufferMemory);
-
-    evilutionDevice.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
-
-    evilutionDevice.copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-
-    vkDestroyBuffer(evilutionDevice.device(), stagingBuffer, nullptr);
-    vkFreeMemory(evilutionDevice.device(), stagingBufferMemory, nullptr);
-}
-
-void EvilutionModel::createVertexBuffers(const std::vector<Vertex>& vertices) {
-    vertexCount = static_cast<uint32_t>(vertices.size());
-    assert(vertexCount >= 3 && "Vertex count must be at least 3");
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-
-    evilutionDevice.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                 stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(evilutionDevice.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-    vkUnmapMemory(evilutionDevice.device(), stagingBufferMemory);
-
-    evilutionDevice.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
-
-    evilutionDevice.copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-    vkDestroyBuffer(evilutionDevice.device(), stagingBuffer, nullptr);
-    vkFreeMemory(evilutionDevice.device(), stagingBufferMemory, nullptr);
-}
+    // centre of the bounding box; not the tightest sphere but close enough for culling
+    glm::vec3 minPosition = vertices[0].position;
+    glm::vec3 maxPosition = vertices[0].position;
+    for (const Vertex& vertex : vertices) {
+        minPosition = glm::min(minPosition, vertex.position);
+        maxPosition = glm::max(maxPosition, vertex.position);
+    }
+    boundsCenter = (minPosition + maxPosition) * 0.5f;
 
-void EvilutionModel::draw(VkCommandBuffer commandBuffer) { 
-    if (hasIndexBuffer) {
-        vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
-    } else {
-        vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    float radiusSquared = 0.0f;
+    for (const Vertex& vertex : vertices) {
+        glm::vec3 offset = vertex.position - boundsCenter;
+        radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
     }
+    boundsRadius = glm::sqrt(radiusSquared);
 }
 
+void EvilutionModel::draw(VkCommandBuffer commandBuffer) { drawGeometry(commandBuffer, getGeometry()); }
+
 void EvilutionModel::bind(VkCommandBuffer commandBuffer) {
-    VkBuffer buffers[] = {vertexBuffer};
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-    if (hasIndexBuffer) {
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    GeometryRange geometry = getGeometry();
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &geometry.vertexBuffer, &offset);
+    if (geometry.indexCount > 0) {
+        vkCmdBindIndexBuffer(commandBuffer, geometry.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
     }
 }
 
@@ -196,4 +178,96 @@ void EvilutionModel::Builder::loadModel(const std::string& filepath) {
     }
 }
 
+void EvilutionModel::Builder::simplify(uint32_t cellsPerAxis) {
+    if (vertices.empty() || indices.empty() || cellsPerAxis == 0) {
+        return;
+    }
+
+    glm::vec3 minimum = vertices[0].position;
+    glm::vec3 maximum = vertices[0].position;
+    for (const Vertex& vertex : vertices) {
+        minimum = glm::min(minimum, vertex.position);
+        maximum = glm::max(maximum, vertex.position);
+    }
+    glm::vec3 cellScale = static_cast<float>(cellsPerAxis) / glm::max(maximum - minimum, glm::vec3{1e-6f});
+    uint32_t lastCell = cellsPerAxis - 1;
+
+    // each occupied cell becomes one vertex, the average of the vertices inside it
+    std::unordered_map<uint64_t, uint32_t> clusterOfCell{};
+    std::vector<uint32_t> clusterOfVertex(vertices.size());
+    std::vector<Vertex> clusters{};
+    std::vector<uint32_t> clusterSizes{};
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& vertex = vertices[i];
+        glm::vec3 cell = glm::floor((vertex.position - minimum) * cellScale);
+        uint64_t x = std::min(static_cast<uint32_t>(cell.x), lastCell);
+        uint64_t y = std::min(static_cast<uint32_t>(cell.y), lastCell);
+        uint64_t z = std::min(static_cast<uint32_t>(cell.z), lastCell);
+        uint64_t key = (x * cellsPerAxis + y) * cellsPerAxis + z;
+
+        auto [found, inserted] = clusterOfCell.try_emplace(key, static_cast<uint32_t>(clusters.size()));
+        if (inserted) {
+            clusters.push_back({glm::vec3{0.f}, glm::vec3{0.f}, glm::vec3{0.f}, glm::vec2{0.f}});
+            clusterSizes.push_back(0);
+        }
+        uint32_t cluster = found->second;
+        clusterOfVertex[i] = cluster;
+        clusters[cluster].position += vertex.position;
+        clusters[cluster].color += vertex.color;
+        clusters[cluster].normal += vertex.normal;
+        clusters[cluster].uv += vertex.uv;
+        clusterSizes[cluster]++;
+    }
+
+    for (size_t i = 0; i < clusters.size(); i++) {
+        float weight = 1.f / static_cast<float>(clusterSizes[i]);
+        clusters[i].position *= weight;
+        clusters[i].color *= weight;
+        clusters[i].uv *= weight;
+        float normalLength = glm::length(clusters[i].normal);
+        if (normalLength > 0.f) {
+            clusters[i].normal /= normalLength;
+        }
+    }
+
+    // triangles that collapsed to a line or point are dropped
+    std::vector<uint32_t> simplifiedIndices{};
+    simplifiedIndices.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t a = clusterOfVertex[indices[i]];
+        uint32_t b = clusterOfVertex[indices[i + 1]];
+        uint32_t c = clusterOfVertex[indices[i + 2]];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+        simplifiedIndices.insert(simplifiedIndices.end(), {a, b, c});
+    }
+    if (simplifiedIndices.empty()) {
+        return;
+    }
+
+    // clusters only referenced by dropped triangles are left out
+    std::vector<uint32_t> remap(clusters.size(), UINT32_MAX);
+    std::vector<Vertex> simplifiedVertices{};
+    for (uint32_t& index : simplifiedIndices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(simplifiedVertices.size());
+            simplifiedVertices.push_back(clusters[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(simplifiedVertices);
+    indices = std::move(simplifiedIndices);
+}
+
+void EvilutionModel::Builder::buildMeshlets() {
+    std::vector<glm::vec3> positions{};
+    positions.reserve(vertices.size());
+    for (const Vertex& vertex : vertices) {
+        positions.push_back(vertex.position);
+    }
+    meshlets = evilution::buildMeshlets(positions, indices);
+}
+
 } // namespace evilution
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "evilution_device.hpp"
+#include "evilution_geometry_pool.hpp"
+#include "evilution_meshlets.hpp"
 
 //libs
 #define GLM_FORCE_RADIANS
@@ -33,34 +35,50 @@ class EvilutionModel {
     struct Builder {
         std::vector<Vertex> vertices{};
         std::vector<uint32_t> indices{};
+        // empty until buildMeshlets(); the model builds its own from the indices when none are given
+        std::vector<Meshlet> meshlets{};
 
         void loadModel(const std::string& filenames);
+        // Coarsens indexed geometry by merging every vertex inside the same cell of a grid laid over its bounds.
+        // Leaves the geometry unchanged if nothing would be left of it.
+        void simplify(uint32_t cellsPerAxis);
+        // Splits indexed geometry into meshlets, reordering the indices so each meshlet is a contiguous range.
+        void buildMeshlets();
     };
 
-    EvilutionModel(EvilutionDevice& device, const Builder& builder);
+    // the geometry lives in the pool; the model only records where
+    EvilutionModel(EvilutionGeometryPool& geometryPool, const Builder& builder);
+    // takes over an allocation that already holds the builder's geometry, for uploads made in batches
+    EvilutionModel(EvilutionGeometryPool& geometryPool, GeometryAllocationId allocation, const Builder& builder);
     ~EvilutionModel();
 
     EvilutionModel(const EvilutionModel&) = delete;
     EvilutionModel& operator=(const EvilutionModel&) = delete;
 
-    static std::unique_ptr<EvilutionModel> createModelFromFile(EvilutionDevice& device, const std::string& filepath);
+    static std::unique_ptr<EvilutionModel> createModelFromFile(EvilutionGeometryPool& geometryPool,
+                                                               const std::string& filepath);
     
     void bind(VkCommandBuffer commandBuffer);
     void draw(VkCommandBuffer commandBuffer);
 
+    // For callers that track bound state themselves. The buffers are shared with every other model and can
+    // change when the pool compacts, so bind and draw from the same range.
+    GeometryRange getGeometry() const { return evilutionGeometryPool.getRange(geometryAllocation); }
+    // for looking up the ranges of many models at once with EvilutionGeometryPool::getRanges
+    GeometryAllocationId getGeometryAllocation() const { return geometryAllocation; }
+
+    // bounding sphere in model space, for culling
+    const glm::vec3& getBoundsCenter() const { return boundsCenter; }
+    float getBoundsRadius() const { return boundsRadius; }
+
   private:
-    void createVertexBuffers(const std::vector<Vertex>& vertices);
-    void createIndexBuffers(const std::vector<uint32_t>& indices);
-    
-    EvilutionDevice& evilutionDevice;
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
-    VkBuffer indexBuffer;
-
-    bool hasIndexBuffer = false;
-    VkDeviceMemory indexBufferMemory;
-    uint32_t vertexCount;
-    uint32_t indexCount;
+    void computeBounds(const std::vector<Vertex>& vertices);
+
+    EvilutionGeometryPool& evilutionGeometryPool;
+    GeometryAllocationId geometryAllocation;
+
+    glm::vec3 boundsCenter{0.0f};
+    float boundsRadius = 0.0f;
 };
 
 } // namespace evilution
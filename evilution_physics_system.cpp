@@ -0,0 +1,108 @@
+#include "evilution_physics_system.hpp"
+#include "evilution_components.hpp"
+
+// std
+#include <algorithm>
+
+namespace evilution {
+
+EvilutionPhysicsSystem::EvilutionPhysicsSystem(EvilutionJobSystem& jobSystem, entt::registry& registry,
+                                               const PhysicsSettings& settings)
+    : jobSystem{jobSystem}, registry{registry}, world{jobSystem, settings} {
+    registry.on_construct<RigidBodyComponent>().connect<&EvilutionPhysicsSystem::onBodyAdded>(*this);
+    registry.on_construct<RigidBody2dComponent>().connect<&EvilutionPhysicsSystem::onBodyAdded>(*this);
+    registry.on_destroy<RigidBodyComponent>().connect<&EvilutionPhysicsSystem::onBodyRemoved>(*this);
+    registry.on_destroy<RigidBody2dComponent>().connect<&EvilutionPhysicsSystem::onBodyRemoved>(*this);
+
+    for (entt::entity entity : registry.view<RigidBodyComponent>()) {
+        pendingAdds.push_back(entity);
+    }
+    for (entt::entity entity : registry.view<RigidBody2dComponent>()) {
+        pendingAdds.push_back(entity);
+    }
+}
+
+EvilutionPhysicsSystem::~EvilutionPhysicsSystem() {
+    registry.on_construct<RigidBodyComponent>().disconnect<&EvilutionPhysicsSystem::onBodyAdded>(*this);
+    registry.on_construct<RigidBody2dComponent>().disconnect<&EvilutionPhysicsSystem::onBodyAdded>(*this);
+    registry.on_destroy<RigidBodyComponent>().disconnect<&EvilutionPhysicsSystem::onBodyRemoved>(*this);
+    registry.on_destroy<RigidBody2dComponent>().disconnect<&EvilutionPhysicsSystem::onBodyRemoved>(*this);
+}
+
+void EvilutionPhysicsSystem::onBodyAdded(entt::registry&, entt::entity entity) { pendingAdds.push_back(entity); }
+
+void EvilutionPhysicsSystem::onBodyRemoved(entt::registry&, entt::entity entity) {
+    pendingRemovals.push_back(entity);
+}
+
+void EvilutionPhysicsSystem::applyPendingChanges(entt::registry& registry) {
+    for (entt::entity entity : pendingRemovals) {
+        // added and removed again before an update
+        pendingAdds.erase(std::remove(pendingAdds.begin(), pendingAdds.end(), entity), pendingAdds.end());
+
+        auto found = bodyIndexOf.find(entity);
+        if (found == bodyIndexOf.end()) {
+            continue;
+        }
+        uint32_t index = found->second;
+        world.removeBody(bodies[index].second);
+        bodyIndexOf.erase(found);
+
+        bodies[index] = bodies.back();
+        bodies.pop_back();
+        if (index < bodies.size()) {
+            bodyIndexOf[bodies[index].first] = index;
+        }
+    }
+    pendingRemovals.clear();
+
+    for (entt::entity entity : pendingAdds) {
+        if (!registry.valid(entity) || !registry.all_of<TransformComponent>(entity) ||
+            bodyIndexOf.count(entity) != 0) {
+            continue;
+        }
+
+        const TransformComponent& transform = registry.get<TransformComponent>(entity);
+        PhysicsBodyDesc desc{};
+        desc.position = {transform.translation.x, transform.translation.y, transform.translation.z};
+        if (auto* body = registry.try_get<RigidBodyComponent>(entity)) {
+            desc.velocity = {body->velocity.x, body->velocity.y, body->velocity.z};
+            desc.mass = body->mass;
+            desc.radius = body->radius;
+        } else if (auto* body2d = registry.try_get<RigidBody2dComponent>(entity)) {
+            desc.velocity = {body2d->velocity.x, body2d->velocity.y, 0.f};
+            desc.mass = body2d->mass;
+            desc.radius = body2d->radius;
+            desc.planar = true;
+        } else {
+            continue;
+        }
+
+        bodyIndexOf[entity] = static_cast<uint32_t>(bodies.size());
+        bodies.emplace_back(entity, world.addBody(desc));
+    }
+    pendingAdds.clear();
+}
+
+void EvilutionPhysicsSystem::update(entt::registry& registry, float frameTime) {
+    applyPendingChanges(registry);
+    world.update(frameTime);
+
+    // each job touches different entities' components, which entt allows concurrently
+    jobSystem.parallelFor(static_cast<uint32_t>(bodies.size()), 1024, [this, &registry](uint32_t begin,
+                                                                                        uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            auto [entity, body] = bodies[i];
+            std::array<float, 3> position = world.getInterpolatedPosition(body);
+            std::array<float, 3> velocity = world.getVelocity(body);
+            registry.get<TransformComponent>(entity).translation = {position[0], position[1], position[2]};
+            if (auto* body3d = registry.try_get<RigidBodyComponent>(entity)) {
+                body3d->velocity = {velocity[0], velocity[1], velocity[2]};
+            } else if (auto* body2d = registry.try_get<RigidBody2dComponent>(entity)) {
+                body2d->velocity = {velocity[0], velocity[1]};
+            }
+        }
+    });
+}
+
+} // namespace evilution
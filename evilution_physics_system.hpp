@@ -0,0 +1,49 @@
+#pragma once
+
+#include "evilution_job_system.hpp"
+#include "evilution_physics_world.hpp"
+
+#include <entt/entt.hpp>
+
+// std
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace evilution {
+
+// Keeps an EvilutionPhysicsWorld in step with the entities that have a TransformComponent and a RigidBodyComponent
+// or RigidBody2dComponent. Bodies are added and removed as those components are, and after each update the
+// interpolated positions and current velocities are written back to the components.
+class EvilutionPhysicsSystem {
+  public:
+    EvilutionPhysicsSystem(EvilutionJobSystem& jobSystem, entt::registry& registry,
+                           const PhysicsSettings& settings = {});
+    ~EvilutionPhysicsSystem();
+
+    EvilutionPhysicsSystem(const EvilutionPhysicsSystem&) = delete;
+    EvilutionPhysicsSystem& operator=(const EvilutionPhysicsSystem&) = delete;
+
+    void update(entt::registry& registry, float frameTime);
+
+    // velocity changes have to go through the world; component velocities are overwritten every update
+    EvilutionPhysicsWorld& getWorld() { return world; }
+
+  private:
+    void onBodyAdded(entt::registry& registry, entt::entity entity);
+    void onBodyRemoved(entt::registry& registry, entt::entity entity);
+    void applyPendingChanges(entt::registry& registry);
+
+    EvilutionJobSystem& jobSystem;
+    entt::registry& registry;
+    EvilutionPhysicsWorld world;
+
+    // the registry signals fire during structural changes, which never overlap a running update
+    std::vector<entt::entity> pendingAdds;
+    std::vector<entt::entity> pendingRemovals;
+
+    std::vector<std::pair<entt::entity, PhysicsBodyId>> bodies;
+    std::unordered_map<entt::entity, uint32_t> bodyIndexOf;
+};
+
+} // namespace evilution
@@ -0,0 +1,708 @@
+#include "evilution_physics_world.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EVILUTION_PHYSICS_SSE 1
+#endif
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+namespace evilution {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+// cells per broadphase job, and bodies per chunk of the cell sort
+constexpr uint32_t BROADPHASE_CELLS_PER_CHUNK = 512;
+constexpr uint32_t SORT_CHUNK_SIZE = 8192;
+constexpr uint32_t RADIX_BITS = 11;
+constexpr uint32_t RADIX_BUCKETS = 1u << RADIX_BITS;
+// penetration allowed to remain, and the share of the rest corrected per step, to avoid jitter
+constexpr float PENETRATION_SLOP = 0.005f;
+constexpr float CORRECTION_PERCENT = 0.8f;
+
+// Cell keys hold the grid level above row-major coordinates of 20 bits per axis, x lowest, so the cells of one
+// row sort next to each other.
+constexpr uint32_t MAX_GRID_LEVELS = 16;
+constexpr uint32_t GRID_LEVEL_SHIFT = 60;
+constexpr uint32_t GRID_COORDINATE_BITS = 20;
+// level 0 cells across the bodies' extent; leaves room for the origin alignment below 2^20
+constexpr uint32_t MAX_GRID_EXTENT = 1u << 19;
+
+uint64_t gridCellKey(uint32_t level, int32_t x, int32_t y, int32_t z) {
+    return (static_cast<uint64_t>(level) << GRID_LEVEL_SHIFT) |
+           (static_cast<uint64_t>(static_cast<uint32_t>(z)) << (2 * GRID_COORDINATE_BITS)) |
+           (static_cast<uint64_t>(static_cast<uint32_t>(y)) << GRID_COORDINATE_BITS) | static_cast<uint32_t>(x);
+}
+
+// the finest level whose cells are at least as wide as the body, given its width in level 0 cells
+uint32_t gridLevel(float widthInCells) {
+    int exponent;
+    float mantissa = std::frexp(widthInCells, &exponent);
+    int level = mantissa == 0.5f ? exponent - 1 : exponent;
+    return static_cast<uint32_t>(std::min(std::max(level, 0), static_cast<int>(MAX_GRID_LEVELS) - 1));
+}
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct AxisBounds {
+    bool enabled;
+    float min;
+    float max;
+    // velocity multiplier when a body hits a wall
+    float bounce;
+};
+
+void integrateAxisScalar(float& position, float& velocity, float scale, bool dynamic, float gravityStep, float dt,
+                         float bodyRadius, const AxisBounds& bounds) {
+    velocity = (velocity + (dynamic ? gravityStep : 0.f)) * scale;
+    position += velocity * dt;
+    if (bounds.enabled) {
+        float low = bounds.min + bodyRadius;
+        float high = bounds.max - bodyRadius;
+        if ((position < low && velocity < 0.f) || (position > high && velocity > 0.f)) {
+            velocity *= bounds.bounce;
+        }
+        position = std::min(std::max(position, low), high);
+    }
+}
+
+#ifdef EVILUTION_PHYSICS_SSE
+// four bodies of one axis; scale is null for axes that are never locked
+void integrateAxisSse(float* position, float* velocity, const float* scale, __m128 dynamic, __m128 gravityStep,
+                      __m128 dt, __m128 bodyRadius, const AxisBounds& bounds) {
+    __m128 v = _mm_add_ps(_mm_loadu_ps(velocity), _mm_and_ps(dynamic, gravityStep));
+    if (scale != nullptr) {
+        v = _mm_mul_ps(v, _mm_loadu_ps(scale));
+    }
+    __m128 p = _mm_add_ps(_mm_loadu_ps(position), _mm_mul_ps(v, dt));
+
+    if (bounds.enabled) {
+        const __m128 zero = _mm_setzero_ps();
+        __m128 low = _mm_add_ps(_mm_set1_ps(bounds.min), bodyRadius);
+        __m128 high = _mm_sub_ps(_mm_set1_ps(bounds.max), bodyRadius);
+        // only bounce bodies moving further out, so one pushed outside cannot get stuck flipping
+        __m128 hit = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(p, low), _mm_cmplt_ps(v, zero)),
+                               _mm_and_ps(_mm_cmpgt_ps(p, high), _mm_cmpgt_ps(v, zero)));
+        __m128 bounced = _mm_mul_ps(v, _mm_set1_ps(bounds.bounce));
+        v = _mm_or_ps(_mm_and_ps(hit, bounced), _mm_andnot_ps(hit, v));
+        p = _mm_min_ps(_mm_max_ps(p, low), high);
+    }
+
+    _mm_storeu_ps(velocity, v);
+    _mm_storeu_ps(position, p);
+}
+#endif
+
+} // namespace
+
+EvilutionPhysicsWorld::EvilutionPhysicsWorld(EvilutionJobSystem& jobSystem, const PhysicsSettings& settings)
+    : jobSystem{jobSystem}, settings{settings} {
+    assert(settings.fixedTimeStep > 0.f && "fixed time step must be positive");
+    assert(settings.maxSubSteps > 0 && "at least one step per update is required");
+}
+
+PhysicsBodyId EvilutionPhysicsWorld::addBody(const PhysicsBodyDesc& desc) {
+    assert(desc.mass >= 0.f && desc.radius > 0.f && "invalid body");
+
+    PhysicsBodyId id;
+    if (!freeIds.empty()) {
+        id = freeIds.back();
+        freeIds.pop_back();
+    } else {
+        id = static_cast<PhysicsBodyId>(denseIndexOf.size());
+        denseIndexOf.push_back(INVALID_INDEX);
+    }
+
+    uint32_t index = getBodyCount();
+    denseIndexOf[id] = index;
+    bodyIdOf.push_back(id);
+
+    float scale = desc.planar ? 0.f : 1.f;
+    positionX.push_back(desc.position[0]);
+    positionY.push_back(desc.position[1]);
+    positionZ.push_back(desc.position[2]);
+    previousX.push_back(desc.position[0]);
+    previousY.push_back(desc.position[1]);
+    previousZ.push_back(desc.position[2]);
+    velocityX.push_back(desc.velocity[0]);
+    velocityY.push_back(desc.velocity[1]);
+    velocityZ.push_back(desc.velocity[2] * scale);
+    inverseMass.push_back(desc.mass > 0.f ? 1.f / desc.mass : 0.f);
+    radius.push_back(desc.radius);
+    zScale.push_back(scale);
+
+    return id;
+}
+
+void EvilutionPhysicsWorld::removeBody(PhysicsBodyId body) {
+    assert(body < denseIndexOf.size() && denseIndexOf[body] != INVALID_INDEX && "body does not exist");
+
+    // the last body moves into the removed one's slot
+    uint32_t index = denseIndexOf[body];
+    uint32_t last = getBodyCount() - 1;
+    auto moveLast = [index](std::vector<float>& values) {
+        values[index] = values.back();
+        values.pop_back();
+    };
+    for (auto* values : {&positionX, &positionY, &positionZ, &previousX, &previousY, &previousZ, &velocityX,
+                         &velocityY, &velocityZ, &inverseMass, &radius, &zScale}) {
+        moveLast(*values);
+    }
+
+    bodyIdOf[index] = bodyIdOf[last];
+    bodyIdOf.pop_back();
+    if (index != last) {
+        denseIndexOf[bodyIdOf[index]] = index;
+    }
+    denseIndexOf[body] = INVALID_INDEX;
+    freeIds.push_back(body);
+}
+
+uint32_t EvilutionPhysicsWorld::update(float frameTime) {
+    auto start = Clock::now();
+    stats.integrateMs = 0.0;
+    stats.broadphaseMs = 0.0;
+    stats.solveMs = 0.0;
+
+    accumulator += frameTime;
+    uint32_t subSteps = 0;
+    while (accumulator >= settings.fixedTimeStep && subSteps < settings.maxSubSteps) {
+        step(settings.fixedTimeStep);
+        accumulator -= settings.fixedTimeStep;
+        subSteps++;
+    }
+    // behind by more than the cap allows: drop the time instead of trying to catch up
+    if (accumulator >= settings.fixedTimeStep) {
+        accumulator = std::fmod(accumulator, settings.fixedTimeStep);
+    }
+
+    stats.bodies = getBodyCount();
+    stats.subSteps = subSteps;
+    stats.totalMs = millisecondsSince(start);
+    return subSteps;
+}
+
+std::array<float, 3> EvilutionPhysicsWorld::getInterpolatedPosition(PhysicsBodyId body) const {
+    uint32_t i = denseIndexOf[body];
+    float alpha = getInterpolationAlpha();
+    return {previousX[i] + (positionX[i] - previousX[i]) * alpha, previousY[i] + (positionY[i] - previousY[i]) * alpha,
+            previousZ[i] + (positionZ[i] - previousZ[i]) * alpha};
+}
+
+std::array<float, 3> EvilutionPhysicsWorld::getVelocity(PhysicsBodyId body) const {
+    uint32_t i = denseIndexOf[body];
+    return {velocityX[i], velocityY[i], velocityZ[i]};
+}
+
+void EvilutionPhysicsWorld::setVelocity(PhysicsBodyId body, const std::array<float, 3>& velocity) {
+    uint32_t i = denseIndexOf[body];
+    velocityX[i] = velocity[0];
+    velocityY[i] = velocity[1];
+    velocityZ[i] = velocity[2] * zScale[i];
+}
+
+void EvilutionPhysicsWorld::step(float dt) {
+    previousX = positionX;
+    previousY = positionY;
+    previousZ = positionZ;
+
+    auto start = Clock::now();
+    integrate(dt);
+    stats.integrateMs += millisecondsSince(start);
+
+    start = Clock::now();
+    findContacts();
+    stats.broadphaseMs += millisecondsSince(start);
+
+    start = Clock::now();
+    buildIslands();
+    uint32_t islandCount = static_cast<uint32_t>(islandContactOffsets.size()) - 1;
+    jobSystem.parallelFor(islandCount, 16, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t island = begin; island < end; island++) {
+            solveIsland(island);
+        }
+    });
+    stats.solveMs += millisecondsSince(start);
+}
+
+void EvilutionPhysicsWorld::integrate(float dt) {
+    const uint32_t count = getBodyCount();
+    const float bounce = -settings.restitution;
+    const AxisBounds bounds[3] = {
+        {settings.useBounds, settings.boundsMin[0], settings.boundsMax[0], bounce},
+        {settings.useBounds, settings.boundsMin[1], settings.boundsMax[1], bounce},
+        {settings.useBounds, settings.boundsMin[2], settings.boundsMax[2], bounce},
+    };
+    const float gravityStep[3] = {settings.gravity[0] * dt, settings.gravity[1] * dt, settings.gravity[2] * dt};
+
+    uint32_t i = 0;
+#ifdef EVILUTION_PHYSICS_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 dtv = _mm_set1_ps(dt);
+    const __m128 gravityX = _mm_set1_ps(gravityStep[0]);
+    const __m128 gravityY = _mm_set1_ps(gravityStep[1]);
+    const __m128 gravityZ = _mm_set1_ps(gravityStep[2]);
+    for (; i + 4 <= count; i += 4) {
+        __m128 dynamic = _mm_cmpgt_ps(_mm_loadu_ps(&inverseMass[i]), zero);
+        __m128 bodyRadius = _mm_loadu_ps(&radius[i]);
+        integrateAxisSse(&positionX[i], &velocityX[i], nullptr, dynamic, gravityX, dtv, bodyRadius, bounds[0]);
+        integrateAxisSse(&positionY[i], &velocityY[i], nullptr, dynamic, gravityY, dtv, bodyRadius, bounds[1]);
+        integrateAxisSse(&positionZ[i], &velocityZ[i], &zScale[i], dynamic, gravityZ, dtv, bodyRadius, bounds[2]);
+    }
+#endif
+    for (; i < count; i++) {
+        bool dynamic = inverseMass[i] > 0.f;
+        integrateAxisScalar(positionX[i], velocityX[i], 1.f, dynamic, gravityStep[0], dt, radius[i], bounds[0]);
+        integrateAxisScalar(positionY[i], velocityY[i], 1.f, dynamic, gravityStep[1], dt, radius[i], bounds[1]);
+        integrateAxisScalar(positionZ[i], velocityZ[i], zScale[i], dynamic, gravityStep[2], dt, radius[i], bounds[2]);
+    }
+}
+
+void EvilutionPhysicsWorld::findContacts() {
+    const uint32_t count = getBodyCount();
+    contacts.clear();
+    stats.contacts = 0;
+    if (count == 0) {
+        return;
+    }
+
+    sortBodiesByCell(count);
+
+    // Each cell tests itself and the 13 neighbours that come after it on its own level, so every pair of cells
+    // is visited once, plus the 27 cells around it on every coarser occupied level, so pairs across levels are
+    // only found from the smaller body's side. Cell keys are row-major, so neighbours along x are adjacent in
+    // sorted order and each row of neighbours is a contiguous run: walking the cells in order, the start of every
+    // neighbour row only moves forward. Chunks walk cells in sorted order, which keeps the contact order stable.
+    uint32_t cellCount = static_cast<uint32_t>(cells.size());
+    uint32_t chunkCount = (cellCount + BROADPHASE_CELLS_PER_CHUNK - 1) / BROADPHASE_CELLS_PER_CHUNK;
+    if (chunkContacts.size() < chunkCount) {
+        chunkContacts.resize(chunkCount);
+    }
+    jobSystem.parallelFor(chunkCount, 1, [this, cellCount](uint32_t beginChunk, uint32_t endChunk) {
+        // raw pointers, because pushing contacts would otherwise force every vector to be reloaded
+        const SortedBody* sorted = sortedBodies.data();
+        const Cell* cellData = cells.data();
+        const uint64_t* keys = cellKeys.data();
+
+        // the rows after a cell: x + 1 in its own row, then x - 1 to x + 1 in the other four
+        constexpr int32_t NEIGHBOUR_ROWS[5][3] = {{1, 0, 0}, {-1, 1, 0}, {-1, -1, 1}, {-1, 0, 1}, {-1, 1, 1}};
+        struct CoarserCells {
+            int32_t x = 0, y = 0, z = 0;
+            uint32_t count = 0;
+            uint32_t cells[27]{};
+            bool valid = false;
+        };
+        CoarserCells coarser[MAX_GRID_LEVELS];
+
+        for (uint32_t chunk = beginChunk; chunk < endChunk; chunk++) {
+            std::vector<Contact>& found = chunkContacts[chunk];
+            found.clear();
+
+            auto testPair = [&](const SortedBody& a, const SortedBody& b) {
+                if (a.inverseMass == 0.f && b.inverseMass == 0.f) {
+                    return;
+                }
+                float radiusSum = a.radius + b.radius;
+                float offsetX = b.x - a.x;
+                float offsetY = b.y - a.y;
+                float offsetZ = b.z - a.z;
+                float distanceSquared = offsetX * offsetX + offsetY * offsetY + offsetZ * offsetZ;
+                if (distanceSquared >= radiusSum * radiusSum) {
+                    return;
+                }
+
+                float distance = std::sqrt(distanceSquared);
+                Contact contact{a.body, b.body, 1.f, 0.f, 0.f, radiusSum - distance};
+                if (distance > 1e-6f) {
+                    contact.normalX = offsetX / distance;
+                    contact.normalY = offsetY / distance;
+                    contact.normalZ = offsetZ / distance;
+                }
+                found.push_back(contact);
+            };
+            // a run of cells is a run of bodies too, since bodies are sorted by cell
+            auto testRange = [&](const Cell& cell, uint32_t begin, uint32_t end) {
+                for (uint32_t k = cell.begin; k < cell.end; k++) {
+                    for (uint32_t m = begin; m < end; m++) {
+                        testPair(sorted[k], sorted[m]);
+                    }
+                }
+            };
+
+            uint32_t begin = chunk * BROADPHASE_CELLS_PER_CHUNK;
+            uint32_t end = std::min(cellCount, begin + BROADPHASE_CELLS_PER_CHUNK);
+            uint32_t rowCursors[5];
+            for (uint32_t row = 0; row < 5; row++) {
+                const Cell& first = cellData[begin];
+                uint64_t rowStart = gridCellKey(first.level, first.x + NEIGHBOUR_ROWS[row][0],
+                                                first.y + NEIGHBOUR_ROWS[row][1], first.z + NEIGHBOUR_ROWS[row][2]);
+                rowCursors[row] = static_cast<uint32_t>(std::lower_bound(keys, keys + cellCount, rowStart) - keys);
+            }
+
+            for (uint32_t c = begin; c < end; c++) {
+                const Cell& cell = cellData[c];
+                for (uint32_t k = cell.begin; k < cell.end; k++) {
+                    for (uint32_t m = k + 1; m < cell.end; m++) {
+                        testPair(sorted[k], sorted[m]);
+                    }
+                }
+
+                for (uint32_t row = 0; row < 5; row++) {
+                    int32_t y = cell.y + NEIGHBOUR_ROWS[row][1];
+                    int32_t z = cell.z + NEIGHBOUR_ROWS[row][2];
+                    uint64_t rowStart = gridCellKey(cell.level, cell.x + NEIGHBOUR_ROWS[row][0], y, z);
+                    uint64_t rowEnd = gridCellKey(cell.level, cell.x + 1, y, z);
+                    uint32_t& cursor = rowCursors[row];
+                    while (cursor < cellCount && keys[cursor] < rowStart) {
+                        cursor++;
+                    }
+                    uint32_t last = cursor;
+                    while (last < cellCount && keys[last] <= rowEnd) {
+                        last++;
+                    }
+                    if (last != cursor) {
+                        testRange(cell, cellData[cursor].begin, cellData[last - 1].end);
+                    }
+                }
+
+                uint32_t levels = occupiedLevels >> (cell.level + 1);
+                for (uint32_t level = cell.level + 1; levels != 0; level++, levels >>= 1) {
+                    if ((levels & 1) == 0) {
+                        continue;
+                    }
+                    // cells nest, so the coarser cell holding this one is found by shifting its coordinates
+                    uint32_t shift = level - cell.level;
+                    int32_t x = cell.x >> shift;
+                    int32_t y = cell.y >> shift;
+                    int32_t z = cell.z >> shift;
+                    CoarserCells& around = coarser[level];
+                    if (!around.valid || around.x != x || around.y != y || around.z != z) {
+                        around = {};
+                        around.x = x;
+                        around.y = y;
+                        around.z = z;
+                        around.valid = true;
+                        for (int32_t dz = -1; dz <= 1; dz++) {
+                            for (int32_t dy = -1; dy <= 1; dy++) {
+                                uint64_t rowStart = gridCellKey(level, x - 1, y + dy, z + dz);
+                                uint64_t rowEnd = gridCellKey(level, x + 1, y + dy, z + dz);
+                                for (auto n = std::lower_bound(keys, keys + cellCount, rowStart);
+                                     n != keys + cellCount && *n <= rowEnd; n++) {
+                                    around.cells[around.count++] = static_cast<uint32_t>(n - keys);
+                                }
+                            }
+                        }
+                    }
+                    for (uint32_t i = 0; i < around.count; i++) {
+                        testRange(cell, cellData[around.cells[i]].begin, cellData[around.cells[i]].end);
+                    }
+                }
+            }
+        }
+    });
+
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+        contacts.insert(contacts.end(), chunkContacts[chunk].begin(), chunkContacts[chunk].end());
+    }
+    stats.contacts = static_cast<uint32_t>(contacts.size());
+}
+
+void EvilutionPhysicsWorld::sortBodiesByCell(uint32_t count) {
+    uint32_t sortChunkCount = (count + SORT_CHUNK_SIZE - 1) / SORT_CHUNK_SIZE;
+    chunkBounds.resize(sortChunkCount);
+    jobSystem.parallelFor(sortChunkCount, 1, [this, count](uint32_t beginChunk, uint32_t endChunk) {
+        for (uint32_t chunk = beginChunk; chunk < endChunk; chunk++) {
+            ChunkBounds bounds{};
+            uint32_t begin = chunk * SORT_CHUNK_SIZE;
+            uint32_t end = std::min(count, begin + SORT_CHUNK_SIZE);
+            bounds.min = {positionX[begin], positionY[begin], positionZ[begin]};
+            bounds.max = bounds.min;
+            bounds.minRadius = bounds.maxRadius = radius[begin];
+            for (uint32_t i = begin; i < end; i++) {
+                bounds.min = {std::min(bounds.min[0], positionX[i]), std::min(bounds.min[1], positionY[i]),
+                              std::min(bounds.min[2], positionZ[i])};
+                bounds.max = {std::max(bounds.max[0], positionX[i]), std::max(bounds.max[1], positionY[i]),
+                              std::max(bounds.max[2], positionZ[i])};
+                bounds.minRadius = std::min(bounds.minRadius, radius[i]);
+                bounds.maxRadius = std::max(bounds.maxRadius, radius[i]);
+            }
+            chunkBounds[chunk] = bounds;
+        }
+    });
+    ChunkBounds bounds = chunkBounds[0];
+    for (const ChunkBounds& chunk : chunkBounds) {
+        for (int axis = 0; axis < 3; axis++) {
+            bounds.min[axis] = std::min(bounds.min[axis], chunk.min[axis]);
+            bounds.max[axis] = std::max(bounds.max[axis], chunk.max[axis]);
+        }
+        bounds.minRadius = std::min(bounds.minRadius, chunk.minRadius);
+        bounds.maxRadius = std::max(bounds.maxRadius, chunk.maxRadius);
+    }
+
+    // Level 0 fits the smallest body. The base only grows if the largest body would not fit the top level, or if
+    // the bodies spread over more cells than the key has bits for.
+    float extent = std::max({bounds.max[0] - bounds.min[0], bounds.max[1] - bounds.min[1],
+                             bounds.max[2] - bounds.min[2]});
+    float baseCellSize = std::max({2.f * bounds.minRadius,
+                                   2.f * bounds.maxRadius / static_cast<float>(1u << (MAX_GRID_LEVELS - 1)),
+                                   extent / static_cast<float>(MAX_GRID_EXTENT)});
+    float inverseBaseCellSize = 1.f / baseCellSize;
+    uint32_t topLevel = gridLevel(2.f * bounds.maxRadius * inverseBaseCellSize);
+
+    // Coordinates are taken relative to an origin aligned to the top level's cells and one of them short of the
+    // lowest body, so a coarser cell is a finer one shifted right and no neighbour coordinate goes negative.
+    std::array<int32_t, 3> origin;
+    for (int axis = 0; axis < 3; axis++) {
+        int32_t lowest = static_cast<int32_t>(std::floor(bounds.min[axis] * inverseBaseCellSize));
+        origin[axis] = ((lowest >> topLevel) - 1) * (1 << topLevel);
+    }
+
+    cellX.resize(count);
+    cellY.resize(count);
+    cellZ.resize(count);
+    bodyKeys.resize(count);
+    bodyOrder.resize(count);
+    chunkKeyBits.resize(sortChunkCount);
+    jobSystem.parallelFor(sortChunkCount, 1, [&](uint32_t beginChunk, uint32_t endChunk) {
+        for (uint32_t chunk = beginChunk; chunk < endChunk; chunk++) {
+            uint64_t changedBits = 0;
+            uint32_t end = std::min(count, (chunk + 1) * SORT_CHUNK_SIZE);
+            for (uint32_t i = chunk * SORT_CHUNK_SIZE; i < end; i++) {
+                uint32_t level = gridLevel(2.f * radius[i] * inverseBaseCellSize);
+                float inverseCellSize = std::ldexp(inverseBaseCellSize, -static_cast<int>(level));
+                cellX[i] = static_cast<int32_t>(std::floor(positionX[i] * inverseCellSize)) - (origin[0] >> level);
+                cellY[i] = static_cast<int32_t>(std::floor(positionY[i] * inverseCellSize)) - (origin[1] >> level);
+                cellZ[i] = static_cast<int32_t>(std::floor(positionZ[i] * inverseCellSize)) - (origin[2] >> level);
+                bodyKeys[i] = gridCellKey(level, cellX[i], cellY[i], cellZ[i]);
+                bodyOrder[i] = i;
+                changedBits |= bodyKeys[i] ^ bodyKeys[0];
+            }
+            chunkKeyBits[chunk] = changedBits;
+        }
+    });
+    uint64_t changedBits = 0;
+    for (uint64_t bits : chunkKeyBits) {
+        changedBits |= bits;
+    }
+
+    // LSD radix sort, skipping digits every key shares; bodies in one region differ in few key bits. Each pass
+    // counts per chunk, so chunks scatter in parallel and the sort stays stable.
+    sortScratchKeys.resize(count);
+    sortScratchOrder.resize(count);
+    radixCounts.resize(static_cast<size_t>(sortChunkCount) * RADIX_BUCKETS);
+    for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS) {
+        if (((changedBits >> shift) & (RADIX_BUCKETS - 1)) == 0) {
+            continue;
+        }
+
+        jobSystem.parallelFor(sortChunkCount, 1, [&](uint32_t beginChunk, uint32_t endChunk) {
+            for (uint32_t chunk = beginChunk; chunk < endChunk; chunk++) {
+                uint32_t* counts = &radixCounts[static_cast<size_t>(chunk) * RADIX_BUCKETS];
+                std::fill(counts, counts + RADIX_BUCKETS, 0u);
+                uint32_t end = std::min(count, (chunk + 1) * SORT_CHUNK_SIZE);
+                for (uint32_t i = chunk * SORT_CHUNK_SIZE; i < end; i++) {
+                    counts[(bodyKeys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+                }
+            }
+        });
+        // digit-major offsets, so earlier chunks come first within a digit
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < RADIX_BUCKETS; digit++) {
+            for (uint32_t chunk = 0; chunk < sortChunkCount; chunk++) {
+                uint32_t& slot = radixCounts[static_cast<size_t>(chunk) * RADIX_BUCKETS + digit];
+                uint32_t bucketCount = slot;
+                slot = offset;
+                offset += bucketCount;
+            }
+        }
+        jobSystem.parallelFor(sortChunkCount, 1, [&](uint32_t beginChunk, uint32_t endChunk) {
+            for (uint32_t chunk = beginChunk; chunk < endChunk; chunk++) {
+                uint32_t* cursors = &radixCounts[static_cast<size_t>(chunk) * RADIX_BUCKETS];
+                uint32_t end = std::min(count, (chunk + 1) * SORT_CHUNK_SIZE);
+                for (uint32_t i = chunk * SORT_CHUNK_SIZE; i < end; i++) {
+                    uint32_t target = cursors[(bodyKeys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+                    sortScratchKeys[target] = bodyKeys[i];
+                    sortScratchOrder[target] = bodyOrder[i];
+                }
+            }
+        });
+        bodyKeys.swap(sortScratchKeys);
+        bodyOrder.swap(sortScratchOrder);
+    }
+
+    sortedBodies.resize(count);
+    jobSystem.parallelFor(count, 4096, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t k = begin; k < end; k++) {
+            uint32_t i = bodyOrder[k];
+            sortedBodies[k] = {positionX[i], positionY[i], positionZ[i], radius[i], inverseMass[i], i};
+        }
+    });
+
+    cellKeys.clear();
+    cells.clear();
+    occupiedLevels = 0;
+    for (uint32_t k = 0; k < count; k++) {
+        if (k == 0 || bodyKeys[k] != cellKeys.back()) {
+            uint32_t i = bodyOrder[k];
+            uint32_t level = static_cast<uint32_t>(bodyKeys[k] >> GRID_LEVEL_SHIFT);
+            if (!cells.empty()) {
+                cells.back().end = k;
+            }
+            cellKeys.push_back(bodyKeys[k]);
+            cells.push_back({cellX[i], cellY[i], cellZ[i], level, k, count});
+            occupiedLevels |= 1u << level;
+        }
+    }
+}
+
+uint32_t EvilutionPhysicsWorld::findRoot(uint32_t body) {
+    // parents only ever point at lower indices, so a stale read still lands on an ancestor
+    uint32_t parent = islandParent[body].load(std::memory_order_relaxed);
+    while (parent != body) {
+        uint32_t grandparent = islandParent[parent].load(std::memory_order_relaxed);
+        // path halving; losing the race to another thread only means less compression
+        islandParent[body].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+        body = grandparent;
+        parent = islandParent[body].load(std::memory_order_relaxed);
+    }
+    return body;
+}
+
+void EvilutionPhysicsWorld::uniteIslands(uint32_t a, uint32_t b) {
+    while (true) {
+        a = findRoot(a);
+        b = findRoot(b);
+        if (a == b) {
+            return;
+        }
+        // the higher root joins the lower, so each island's root is its lowest body however unions interleave
+        if (a < b) {
+            std::swap(a, b);
+        }
+        uint32_t expected = a;
+        if (islandParent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+void EvilutionPhysicsWorld::buildIslands() {
+    const uint32_t count = getBodyCount();
+    const uint32_t contactCount = static_cast<uint32_t>(contacts.size());
+    if (islandParentCapacity < count) {
+        islandParentCapacity = std::max(count, islandParentCapacity * 2);
+        islandParent = std::make_unique<std::atomic<uint32_t>[]>(islandParentCapacity);
+    }
+    jobSystem.parallelFor(count, 4096, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            islandParent[i].store(i, std::memory_order_relaxed);
+        }
+    });
+
+    // kinematic bodies do not join islands, otherwise everything resting on one would become a single island
+    jobSystem.parallelFor(contactCount, 2048, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t c = begin; c < end; c++) {
+            const Contact& contact = contacts[c];
+            if (inverseMass[contact.a] > 0.f && inverseMass[contact.b] > 0.f) {
+                uniteIslands(contact.a, contact.b);
+            }
+        }
+    });
+
+    contactIslands.resize(contactCount);
+    jobSystem.parallelFor(contactCount, 2048, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t c = begin; c < end; c++) {
+            uint32_t dynamicBody = inverseMass[contacts[c].a] > 0.f ? contacts[c].a : contacts[c].b;
+            contactIslands[c] = findRoot(dynamicBody);
+        }
+    });
+
+    // Counting sort of the contacts by island. Kept serial: islands are numbered in order of their first contact
+    // and keep their contacts in broadphase order, which keeps the solver deterministic.
+    islandRoots.assign(count, INVALID_INDEX);
+    islandContactOffsets.assign(1, 0);
+    for (uint32_t c = 0; c < contactCount; c++) {
+        uint32_t& island = islandRoots[contactIslands[c]];
+        if (island == INVALID_INDEX) {
+            island = static_cast<uint32_t>(islandContactOffsets.size()) - 1;
+            islandContactOffsets.push_back(0);
+        }
+        contactIslands[c] = island;
+        islandContactOffsets[island + 1]++;
+    }
+    std::partial_sum(islandContactOffsets.begin(), islandContactOffsets.end(), islandContactOffsets.begin());
+
+    islandContacts.resize(contactCount);
+    islandCursors.assign(islandContactOffsets.begin(), islandContactOffsets.end() - 1);
+    for (uint32_t c = 0; c < contactCount; c++) {
+        islandContacts[islandCursors[contactIslands[c]]++] = contacts[c];
+    }
+    stats.islands = static_cast<uint32_t>(islandContactOffsets.size()) - 1;
+}
+
+void EvilutionPhysicsWorld::solveIsland(uint32_t island) {
+    const uint32_t begin = islandContactOffsets[island];
+    const uint32_t end = islandContactOffsets[island + 1];
+
+    // kinematic bodies can be shared between islands, so they are only ever read here
+    for (uint32_t iteration = 0; iteration < settings.solverIterations; iteration++) {
+        for (uint32_t c = begin; c < end; c++) {
+            const Contact& contact = islandContacts[c];
+            uint32_t a = contact.a;
+            uint32_t b = contact.b;
+            float massA = inverseMass[a];
+            float massB = inverseMass[b];
+
+            float relativeVelocity = (velocityX[b] - velocityX[a]) * contact.normalX +
+                                     (velocityY[b] - velocityY[a]) * contact.normalY +
+                                     (velocityZ[b] - velocityZ[a]) * contact.normalZ;
+            if (relativeVelocity >= 0.f) {
+                continue;
+            }
+
+            float impulse = -(1.f + settings.restitution) * relativeVelocity / (massA + massB);
+            if (massA > 0.f) {
+                velocityX[a] -= contact.normalX * impulse * massA;
+                velocityY[a] -= contact.normalY * impulse * massA;
+                velocityZ[a] -= contact.normalZ * impulse * massA * zScale[a];
+            }
+            if (massB > 0.f) {
+                velocityX[b] += contact.normalX * impulse * massB;
+                velocityY[b] += contact.normalY * impulse * massB;
+                velocityZ[b] += contact.normalZ * impulse * massB * zScale[b];
+            }
+        }
+    }
+
+    for (uint32_t c = begin; c < end; c++) {
+        const Contact& contact = islandContacts[c];
+        uint32_t a = contact.a;
+        uint32_t b = contact.b;
+        float massA = inverseMass[a];
+        float massB = inverseMass[b];
+        float correction =
+            std::max(contact.penetration - PENETRATION_SLOP, 0.f) / (massA + massB) * CORRECTION_PERCENT;
+        if (massA > 0.f) {
+            positionX[a] -= contact.normalX * correction * massA;
+            positionY[a] -= contact.normalY * correction * massA;
+            positionZ[a] -= contact.normalZ * correction * massA * zScale[a];
+        }
+        if (massB > 0.f) {
+            positionX[b] += contact.normalX * correction * massB;
+            positionY[b] += contact.normalY * correction * massB;
+            positionZ[b] += contact.normalZ * correction * massB * zScale[b];
+        }
+    }
+}
+
+} // namespace evilution
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "evilution_job_system.hpp"
+
+// std
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace evilution {
+
+using PhysicsBodyId = uint32_t;
+
+struct PhysicsSettings {
+    float fixedTimeStep = 1.f / 120.f;
+    // steps per update are capped so a long frame cannot make the next one longer still
+    uint32_t maxSubSteps = 4;
+    std::array<float, 3> gravity{0.f, 0.f, 0.f};
+    float restitution = 0.5f;
+    uint32_t solverIterations = 4;
+    // bodies bounce off the sides of this box when enabled
+    bool useBounds = false;
+    std::array<float, 3> boundsMin{-50.f, -50.f, -50.f};
+    std::array<float, 3> boundsMax{50.f, 50.f, 50.f};
+};
+
+struct PhysicsBodyDesc {
+    std::array<float, 3> position{};
+    std::array<float, 3> velocity{};
+    // 0 makes the body kinematic: it keeps its velocity and is never pushed by contacts
+    float mass = 1.f;
+    float radius = 0.5f;
+    // keeps the body in its starting z plane, for 2D bodies
+    bool planar = false;
+};
+
+// Sphere bodies stepped at a fixed rate independent of the render frame time. Body state is stored as separate
+// arrays per field so integration runs four bodies per SSE instruction. Broadphase sorts bodies into a hierarchy
+// of grids whose cells double in width per level; each body lives in the finest level its size fits, so only
+// neighbouring cells of its own level and the cells around it on coarser levels need testing, and a few large
+// bodies cannot coarsen the grid for everything else. Contacts are split into islands of touching dynamic
+// bodies, and islands are solved in parallel on the job system.
+class EvilutionPhysicsWorld {
+  public:
+    struct Stats {
+        uint32_t bodies = 0;
+        uint32_t subSteps = 0;
+        uint32_t contacts = 0;
+        uint32_t islands = 0;
+        // of the last update, summed over its steps
+        double integrateMs = 0.0;
+        double broadphaseMs = 0.0;
+        double solveMs = 0.0;
+        double totalMs = 0.0;
+    };
+
+    EvilutionPhysicsWorld(EvilutionJobSystem& jobSystem, const PhysicsSettings& settings = {});
+
+    EvilutionPhysicsWorld(const EvilutionPhysicsWorld&) = delete;
+    EvilutionPhysicsWorld& operator=(const EvilutionPhysicsWorld&) = delete;
+
+    PhysicsBodyId addBody(const PhysicsBodyDesc& desc);
+    void removeBody(PhysicsBodyId body);
+    uint32_t getBodyCount() const { return static_cast<uint32_t>(positionX.size()); }
+
+    // Advances by whole fixed steps and keeps the remainder for the next call. Returns the number of steps taken.
+    uint32_t update(float frameTime);
+    // how far the current time is between the last two steps, for interpolating positions
+    float getInterpolationAlpha() const { return accumulator / settings.fixedTimeStep; }
+
+    // position blended between the last two steps by the interpolation alpha
+    std::array<float, 3> getInterpolatedPosition(PhysicsBodyId body) const;
+    std::array<float, 3> getVelocity(PhysicsBodyId body) const;
+    void setVelocity(PhysicsBodyId body, const std::array<float, 3>& velocity);
+
+    const PhysicsSettings& getSettings() const { return settings; }
+    const Stats& getStats() const { return stats; }
+
+  private:
+    struct Contact {
+        uint32_t a;
+        uint32_t b;
+        // from a to b
+        float normalX, normalY, normalZ;
+        float penetration;
+    };
+
+    void step(float dt);
+    void integrate(float dt);
+    void findContacts();
+    void sortBodiesByCell(uint32_t count);
+    void buildIslands();
+    void solveIsland(uint32_t island);
+    uint32_t findRoot(uint32_t body);
+    void uniteIslands(uint32_t a, uint32_t b);
+
+    EvilutionJobSystem& jobSystem;
+    PhysicsSettings settings;
+    float accumulator = 0.f;
+    Stats stats{};
+
+    // body state, indexed densely
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> previousX, previousY, previousZ;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> inverseMass;
+    std::vector<float> radius;
+    // 0 for planar bodies, 1 otherwise; multiplies z velocity
+    std::vector<float> zScale;
+
+    // ids stay stable while dense indices move when bodies are removed
+    std::vector<uint32_t> denseIndexOf;
+    std::vector<PhysicsBodyId> bodyIdOf;
+    std::vector<PhysicsBodyId> freeIds;
+
+    // broadphase: bodies sorted by grid level and cell, then grouped into one run per cell
+    struct ChunkBounds {
+        std::array<float, 3> min, max;
+        float minRadius, maxRadius;
+    };
+    std::vector<ChunkBounds> chunkBounds;
+    std::vector<int32_t> cellX, cellY, cellZ;
+    std::vector<uint64_t> bodyKeys, sortScratchKeys;
+    std::vector<uint32_t> bodyOrder, sortScratchOrder;
+    std::vector<uint32_t> radixCounts;
+    std::vector<uint64_t> chunkKeyBits;
+    struct Cell {
+        int32_t x, y, z;
+        uint32_t level;
+        // range in sortedBodies
+        uint32_t begin, end;
+    };
+    std::vector<uint64_t> cellKeys;
+    std::vector<Cell> cells;
+    uint32_t occupiedLevels = 0;
+    // what the pair search reads, copied in cell order so each cell is one contiguous run
+    struct SortedBody {
+        float x, y, z;
+        float radius;
+        float inverseMass;
+        uint32_t body;
+    };
+    std::vector<SortedBody> sortedBodies;
+    std::vector<std::vector<Contact>> chunkContacts;
+    std::vector<Contact> contacts;
+
+    // islands, as union-find parents and contact ranges grouped per island. Parents are atomic so contacts can
+    // be merged from every worker at once.
+    std::unique_ptr<std::atomic<uint32_t>[]> islandParent;
+    uint32_t islandParentCapacity = 0;
+    std::vector<uint32_t> islandRoots;
+    std::vector<uint32_t> contactIslands;
+    std::vector<uint32_t> islandCursors;
+    std::vector<uint32_t> islandContactOffsets;
+    std::vector<Contact> islandContacts;
+};
+
+} // namespace evilution
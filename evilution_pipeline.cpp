@@ -2,61 +2,38 @@
 #include "evilution_model.hpp"
 
 #include <cassert>
-#include <fstream>
-#include <iostream>
 #include <stdexcept>
 #include <vector>
 
 namespace evilution {
 
-EvilutionPipeline::EvilutionPipeline(EvilutionDevice& device, const std::string& vertFilepath,
-                                     const std::string& fragFilepath, const PipelineConfigInfo& configInfo)
+EvilutionPipeline::EvilutionPipeline(EvilutionDevice& device, EvilutionShaderModuleCache& shaderModules,
+                                     const ShaderCode& vertShader, const ShaderCode& fragShader,
+                                     const PipelineConfigInfo& configInfo, VkPipelineCache pipelineCache,
+                                     VkPipelineCreateFlags createFlags)
     : evilutionDevice{device} {
-    createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
+    createGraphicsPipeline(shaderModules, vertShader, fragShader, configInfo, pipelineCache, createFlags);
 }
 
-EvilutionPipeline::~EvilutionPipeline() {
-    vkDestroyShaderModule(evilutionDevice.device(), vertShaderModule, nullptr);
-    vkDestroyShaderModule(evilutionDevice.device(), fragShaderModule, nullptr);
-    vkDestroyPipeline(evilutionDevice.device(), graphicsPipeline, nullptr);
-}
-
-std::vector<char> EvilutionPipeline::readFile(const std::string& filepath) {
-    std::ifstream file{filepath, std::ios::ate | std::ios::binary};
-
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file: " + filepath);
-    }
+EvilutionPipeline::~EvilutionPipeline() { evilutionDevice.deletionQueue().destroyPipeline(graphicsPipeline); }
 
-    size_t fileSize = static_cast<size_t>(file.tellg());
-    std::vector<char> buffer(fileSize);
-
-    std::cout << "fileSize: " << fileSize << std::endl;
-
-    file.seekg(0, std::ios::beg);
-    file.read(buffer.data(), fileSize);
-    file.close();
-
-    return buffer;
-}
-
-void EvilutionPipeline::createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath,
-                                               const PipelineConfigInfo& configInfo) {
+void EvilutionPipeline::createGraphicsPipeline(EvilutionShaderModuleCache& shaderModules, const ShaderCode& vertShader,
+                                               const ShaderCode& fragShader, const PipelineConfigInfo& configInfo,
+                                               VkPipelineCache pipelineCache, VkPipelineCreateFlags createFlags) {
     assert(configInfo.pipelineLayout != VK_NULL_HANDLE &&
            "Cannot create graphics pipeline: no pipelineLayout provided in configInfo");
-    assert(configInfo.renderPass != VK_NULL_HANDLE &&
-           "Cannot create graphics pipeline: no renderPass provided in configInfo");
-
-    auto vertCode = readFile(vertFilepath);
-    auto fragCode = readFile(fragFilepath);
+    assert((configInfo.renderPass != VK_NULL_HANDLE || !configInfo.colorAttachmentFormats.empty() ||
+            configInfo.depthAttachmentFormat != VK_FORMAT_UNDEFINED) &&
+           "Cannot create graphics pipeline: no renderPass or attachment formats provided in configInfo");
 
-    createShaderModule(vertCode, &vertShaderModule);
-    createShaderModule(fragCode, &fragShaderModule);
+    // modules are only referenced during creation, the cache destroys them once nobody else needs them
+    ScopedShaderModule vertShaderModule{shaderModules, vertShader};
+    ScopedShaderModule fragShaderModule{shaderModules, fragShader};
 
     VkPipelineShaderStageCreateInfo shaderStages[2];
     shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].module = vertShaderModule.get();
     shaderStages[0].pName = "main";
     shaderStages[0].flags = 0;
     shaderStages[0].pNext = nullptr;
@@ -64,14 +41,14 @@ void EvilutionPipeline::createGraphicsPipeline(const std::string& vertFilepath,
 
     shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].module = fragShaderModule.get();
     shaderStages[1].pName = "main";
     shaderStages[1].flags = 0;
     shaderStages[1].pNext = nullptr;
     shaderStages[1].pSpecializationInfo = nullptr;
 
-    auto bindingDescriptions = EvilutionModel::Vertex::getBindingDescriptions();
-    auto attributeDescriptions = EvilutionModel::Vertex::getAttributeDescriptions();
+    auto& bindingDescriptions = configInfo.bindingDescriptions;
+    auto& attributeDescriptions = configInfo.attributeDescriptions;
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -82,6 +59,7 @@ void EvilutionPipeline::createGraphicsPipeline(const std::string& vertFilepath,
 
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.flags = createFlags;
     pipelineInfo.stageCount = 2;
     pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -100,20 +78,26 @@ void EvilutionPipeline::createGraphicsPipeline(const std::string& vertFilepath,
     pipelineInfo.basePipelineIndex = -1;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(evilutionDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                                  &graphicsPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create graphics pipeline!");
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    if (configInfo.renderPass == VK_NULL_HANDLE) {
+        renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        renderingInfo.colorAttachmentCount = static_cast<uint32_t>(configInfo.colorAttachmentFormats.size());
+        renderingInfo.pColorAttachmentFormats = configInfo.colorAttachmentFormats.data();
+        renderingInfo.depthAttachmentFormat = configInfo.depthAttachmentFormat;
+        pipelineInfo.pNext = &renderingInfo;
     }
-}
 
-void EvilutionPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    VkResult result = vkCreateGraphicsPipelines(evilutionDevice.device(), pipelineCache, 1, &pipelineInfo, nullptr,
+                                                &graphicsPipeline);
 
-    if (vkCreateShaderModule(evilutionDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module!");
+    if (result == VK_PIPELINE_COMPILE_REQUIRED_EXT &&
+        (createFlags & VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT)) {
+        // not an error: the caller asked for a cache-only attempt
+        graphicsPipeline = VK_NULL_HANDLE;
+        return;
+    }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline!");
     }
 }
 
@@ -121,6 +105,67 @@ void EvilutionPipeline::bind(VkCommandBuffer commandBuffer) {
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 }
 
+EvilutionComputePipeline::EvilutionComputePipeline(EvilutionDevice& device, EvilutionShaderModuleCache& shaderModules,
+                                                   const ShaderCode& computeShader, VkPipelineLayout pipelineLayout,
+                                                   VkPipelineCache pipelineCache)
+    : evilutionDevice{device} {
+    assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: no pipelineLayout provided");
+
+    VkPipelineShaderStageCreateInfo shaderStage{};
+    shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStage.module = shaderModules.acquire(computeShader);
+    shaderStage.pName = "main";
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = shaderStage;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.basePipelineIndex = -1;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkResult result =
+        vkCreateComputePipelines(evilutionDevice.device(), pipelineCache, 1, &pipelineInfo, nullptr, &computePipeline);
+    shaderModules.release(computeShader);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+}
+
+EvilutionComputePipeline::~EvilutionComputePipeline() {
+    evilutionDevice.deletionQueue().destroyPipeline(computePipeline);
+}
+
+void EvilutionComputePipeline::bind(VkCommandBuffer commandBuffer) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+}
+
+void EvilutionPipeline::copyPipelineConfigInfo(const PipelineConfigInfo& src, PipelineConfigInfo& dst) {
+    assert(src.colorBlendInfo.attachmentCount <= 1 &&
+           "copyPipelineConfigInfo only supports the single embedded color blend attachment");
+
+    dst.viewportInfo = src.viewportInfo;
+    dst.inputAssemblyInfo = src.inputAssemblyInfo;
+    dst.rasterizationInfo = src.rasterizationInfo;
+    dst.multisampleInfo = src.multisampleInfo;
+    dst.colorBlendAttachment = src.colorBlendAttachment;
+    dst.colorBlendInfo = src.colorBlendInfo;
+    dst.depthStencilInfo = src.depthStencilInfo;
+    dst.dynamicStateEnables = src.dynamicStateEnables;
+    dst.dynamicStateInfo = src.dynamicStateInfo;
+    dst.pipelineLayout = src.pipelineLayout;
+    dst.renderPass = src.renderPass;
+    dst.subpass = src.subpass;
+    dst.colorAttachmentFormats = src.colorAttachmentFormats;
+    dst.depthAttachmentFormat = src.depthAttachmentFormat;
+    dst.bindingDescriptions = src.bindingDescriptions;
+    dst.attributeDescriptions = src.attributeDescriptions;
+
+    dst.colorBlendInfo.pAttachments = &dst.colorBlendAttachment;
+    dst.dynamicStateInfo.pDynamicStates = dst.dynamicStateEnables.data();
+    dst.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(dst.dynamicStateEnables.size());
+}
+
 void EvilutionPipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
 
     configInfo.inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -189,6 +234,14 @@ void EvilutionPipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo
     configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
     configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
     configInfo.dynamicStateInfo.flags = 0;
+
+    configInfo.bindingDescriptions = EvilutionModel::Vertex::getBindingDescriptions();
+    configInfo.attributeDescriptions = EvilutionModel::Vertex::getAttributeDescriptions();
+}
+
+void EvilutionPipeline::enableVertexPulling(PipelineConfigInfo& configInfo) {
+    configInfo.bindingDescriptions.clear();
+    configInfo.attributeDescriptions.clear();
 }
 
 } // namespace evilution
\ No newline at end of file
@@ -1,14 +1,21 @@
 #pragma once
 
 #include "evilution_device.hpp"
+#include "evilution_shader_module_cache.hpp"
 
+// std
+#include <vector>
 
 namespace evilution {
 
 struct PipelineConfigInfo {
+    PipelineConfigInfo() = default;
     PipelineConfigInfo(const PipelineConfigInfo&) = delete;
     PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
+    // EvilutionModel::Vertex by default; empty for shaders that fetch their vertices from storage buffers
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
     VkPipelineViewportStateCreateInfo viewportInfo;
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
     VkPipelineRasterizationStateCreateInfo rasterizationInfo;
@@ -21,30 +28,54 @@ struct PipelineConfigInfo {
     VkPipelineLayout pipelineLayout = nullptr;
     VkRenderPass renderPass = nullptr;
     uint32_t subpass = 0;
+    // dynamic rendering: used instead of renderPass when renderPass is null
+    std::vector<VkFormat> colorAttachmentFormats;
+    VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
 };
 class EvilutionPipeline {
   public:
-    EvilutionPipeline(EvilutionDevice& device, const std::string& vertFilepath, const std::string& fragFilepath,
-                      const PipelineConfigInfo& configInfo);
+    EvilutionPipeline(EvilutionDevice& device, EvilutionShaderModuleCache& shaderModules, const ShaderCode& vertShader,
+                      const ShaderCode& fragShader, const PipelineConfigInfo& configInfo,
+                      VkPipelineCache pipelineCache = VK_NULL_HANDLE, VkPipelineCreateFlags createFlags = 0);
     ~EvilutionPipeline();
 
     EvilutionPipeline(const EvilutionPipeline&) = delete;
     EvilutionPipeline& operator=(const EvilutionPipeline&) = delete;
 
     void bind(VkCommandBuffer commandBuffer);
+    // false only when created with VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT and the
+    // pipeline cache could not satisfy the request
+    bool isCompiled() const { return graphicsPipeline != VK_NULL_HANDLE; }
+
     static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
+    // no fixed-function vertex input: the vertex shader reads its vertices by gl_VertexIndex
+    static void enableVertexPulling(PipelineConfigInfo& configInfo);
+    // PipelineConfigInfo holds pointers into itself, so a plain member-wise copy is not safe
+    static void copyPipelineConfigInfo(const PipelineConfigInfo& src, PipelineConfigInfo& dst);
 
   private:
-    static std::vector<char> readFile(const std::string& filepath);
+    void createGraphicsPipeline(EvilutionShaderModuleCache& shaderModules, const ShaderCode& vertShader,
+                                const ShaderCode& fragShader, const PipelineConfigInfo& configInfo,
+                                VkPipelineCache pipelineCache, VkPipelineCreateFlags createFlags);
+
+    EvilutionDevice& evilutionDevice;
+    VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+};
 
-    void createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath,
-                                const PipelineConfigInfo& configInfo);
+class EvilutionComputePipeline {
+  public:
+    EvilutionComputePipeline(EvilutionDevice& device, EvilutionShaderModuleCache& shaderModules,
+                             const ShaderCode& computeShader, VkPipelineLayout pipelineLayout,
+                             VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+    ~EvilutionComputePipeline();
+
+    EvilutionComputePipeline(const EvilutionComputePipeline&) = delete;
+    EvilutionComputePipeline& operator=(const EvilutionComputePipeline&) = delete;
 
-    void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
+    void bind(VkCommandBuffer commandBuffer);
 
+  private:
     EvilutionDevice& evilutionDevice;
-    VkPipeline graphicsPipeline;
-    VkShaderModule vertShaderModule;
-    VkShaderModule fragShaderModule;
+    VkPipeline computePipeline = VK_NULL_HANDLE;
 };
 } // namespace evilution
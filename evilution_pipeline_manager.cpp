@@ -0,0 +1,322 @@
+#include "evilution_pipeline_manager.hpp"
+#include "evilution_utils.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+
+namespace evilution {
+
+EvilutionPipelineManager::EvilutionPipelineManager(EvilutionDevice& device, const std::string& cacheFilepath,
+                                                   uint32_t workerCount)
+    : evilutionDevice{device}, shaderModules{device}, cacheFilepath{cacheFilepath} {
+    createPipelineCache();
+
+    workerCount = std::max(1u, workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+EvilutionPipelineManager::~EvilutionPipelineManager() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    // jobs still queued at shutdown never compile; fail them so no handle is left pending for good
+    for (auto& job : compileQueue) {
+        shaderModules.release(job->variant->vertShader);
+        shaderModules.release(job->variant->fragShader);
+        job->variant->state.store(PipelineState::Failed, std::memory_order_release);
+    }
+    compileQueue.clear();
+    pendingJobs = 0;
+    readyCondition.notify_all();
+
+    savePipelineCache();
+    vkDestroyPipelineCache(evilutionDevice.device(), pipelineCache, nullptr);
+}
+
+void EvilutionPipelineManager::createPipelineCache() {
+    std::vector<char> initialData;
+    std::ifstream file{cacheFilepath, std::ios::ate | std::ios::binary};
+    if (file.is_open()) {
+        initialData.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(initialData.data(), initialData.size());
+    }
+
+    // the driver validates the header and silently ignores data written by a different device or driver
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = initialData.size();
+    cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    if (vkCreatePipelineCache(evilutionDevice.device(), &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+}
+
+void EvilutionPipelineManager::savePipelineCache() {
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(evilutionDevice.device(), pipelineCache, &dataSize, nullptr) != VK_SUCCESS ||
+        dataSize == 0) {
+        return;
+    }
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(evilutionDevice.device(), pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+        return;
+    }
+
+    std::ofstream file{cacheFilepath, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+        std::cerr << "failed to write pipeline cache: " << cacheFilepath << std::endl;
+        return;
+    }
+    file.write(data.data(), dataSize);
+}
+
+PipelineHandle EvilutionPipelineManager::requestPipeline(const ShaderCode& vertShader, const ShaderCode& fragShader,
+                                                         const PipelineConfigInfo& configInfo) {
+    size_t key = hashPipelineConfigInfo(configInfo);
+    hashCombine(key, vertShader.hash, fragShader.hash);
+
+    std::shared_ptr<PipelineVariant> variant;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        auto range = variants.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            const PipelineVariant& existing = *it->second;
+            if (shaderCodeEqual(existing.vertShader, vertShader) && shaderCodeEqual(existing.fragShader, fragShader) &&
+                pipelineConfigInfoEqual(*existing.configInfo, configInfo)) {
+                return PipelineHandle{it->second};
+            }
+        }
+        variant = std::make_shared<PipelineVariant>();
+        variant->key = key;
+        variant->vertShader = vertShader;
+        variant->fragShader = fragShader;
+        variant->configInfo = std::make_unique<PipelineConfigInfo>();
+        EvilutionPipeline::copyPipelineConfigInfo(configInfo, *variant->configInfo);
+        variants.emplace(key, variant);
+    }
+
+    if (evilutionDevice.pipelineCacheControlSupported()) {
+        // fast path: a cache hit is cheap enough to take on the calling thread, a miss fails immediately
+        std::unique_ptr<EvilutionPipeline> pipeline;
+        try {
+            pipeline = std::make_unique<EvilutionPipeline>(
+                evilutionDevice, shaderModules, vertShader, fragShader, configInfo, pipelineCache,
+                VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT_EXT);
+        } catch (...) {
+            settleVariant(*variant, PipelineState::Failed);
+            throw;
+        }
+        if (pipeline->isCompiled()) {
+            variant->pipeline = std::move(pipeline);
+            settleVariant(*variant, PipelineState::Ready);
+            return PipelineHandle{variant};
+        }
+    }
+
+    // hold the modules while the job is queued so variants that share shaders compile from the same modules
+    try {
+        ScopedShaderModule vertShaderModule{shaderModules, vertShader};
+        ScopedShaderModule fragShaderModule{shaderModules, fragShader};
+
+        auto job = std::make_unique<CompileJob>();
+        job->variant = variant;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            compileQueue.push_back(std::move(job));
+            pendingJobs++;
+        }
+        // the queued job releases both in compile(), or the destructor does if it never runs
+        vertShaderModule.dismiss();
+        fragShaderModule.dismiss();
+    } catch (...) {
+        settleVariant(*variant, PipelineState::Failed);
+        throw;
+    }
+    queueCondition.notify_one();
+
+    return PipelineHandle{variant};
+}
+
+void EvilutionPipelineManager::waitForPipeline(const PipelineHandle& handle) {
+    assert(handle.isValid() && "Cannot wait on an empty pipeline handle");
+
+    std::unique_lock<std::mutex> lock{mutex};
+    readyCondition.wait(lock, [&handle] {
+        return handle.variant->state.load(std::memory_order_acquire) != PipelineState::Pending;
+    });
+}
+
+std::unique_ptr<EvilutionComputePipeline> EvilutionPipelineManager::createComputePipeline(
+    const ShaderCode& computeShader, VkPipelineLayout pipelineLayout) {
+    return std::make_unique<EvilutionComputePipeline>(evilutionDevice, shaderModules, computeShader, pipelineLayout,
+                                                      pipelineCache);
+}
+
+size_t EvilutionPipelineManager::variantCount() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return variants.size();
+}
+
+size_t EvilutionPipelineManager::pendingCount() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return pendingJobs;
+}
+
+void EvilutionPipelineManager::workerLoop() {
+    while (true) {
+        std::unique_ptr<CompileJob> job;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            queueCondition.wait(lock, [this] { return stopping || !compileQueue.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(compileQueue.front());
+            compileQueue.pop_front();
+        }
+
+        compile(*job);
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            pendingJobs--;
+        }
+        readyCondition.notify_all();
+    }
+}
+
+void EvilutionPipelineManager::compile(CompileJob& job) {
+    PipelineVariant& variant = *job.variant;
+    try {
+        variant.pipeline = std::make_unique<EvilutionPipeline>(evilutionDevice, shaderModules, variant.vertShader,
+                                                               variant.fragShader, *variant.configInfo, pipelineCache);
+        variant.state.store(PipelineState::Ready, std::memory_order_release);
+    } catch (const std::exception& e) {
+        std::cerr << "failed to compile pipeline variant " << variant.key << ": " << e.what() << std::endl;
+        variant.state.store(PipelineState::Failed, std::memory_order_release);
+    }
+    shaderModules.release(variant.vertShader);
+    shaderModules.release(variant.fragShader);
+}
+
+void EvilutionPipelineManager::settleVariant(PipelineVariant& variant, PipelineState state) {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        variant.state.store(state, std::memory_order_release);
+    }
+    readyCondition.notify_all();
+}
+
+size_t EvilutionPipelineManager::hashPipelineConfigInfo(const PipelineConfigInfo& configInfo) {
+    size_t seed = 0;
+
+    hashCombine(seed, configInfo.viewportInfo.viewportCount, configInfo.viewportInfo.scissorCount);
+
+    hashCombine(seed, configInfo.inputAssemblyInfo.topology, configInfo.inputAssemblyInfo.primitiveRestartEnable);
+
+    const auto& raster = configInfo.rasterizationInfo;
+    hashCombine(seed, raster.depthClampEnable, raster.rasterizerDiscardEnable, raster.polygonMode, raster.lineWidth,
+                raster.cullMode, raster.frontFace, raster.depthBiasEnable, raster.depthBiasConstantFactor,
+                raster.depthBiasClamp, raster.depthBiasSlopeFactor);
+
+    const auto& multisample = configInfo.multisampleInfo;
+    hashCombine(seed, multisample.rasterizationSamples, multisample.sampleShadingEnable, multisample.minSampleShading,
+                multisample.alphaToCoverageEnable, multisample.alphaToOneEnable);
+
+    const auto& blend = configInfo.colorBlendAttachment;
+    hashCombine(seed, blend.colorWriteMask, blend.blendEnable, blend.srcColorBlendFactor, blend.dstColorBlendFactor,
+                blend.colorBlendOp, blend.srcAlphaBlendFactor, blend.dstAlphaBlendFactor, blend.alphaBlendOp);
+
+    const auto& blendInfo = configInfo.colorBlendInfo;
+    hashCombine(seed, blendInfo.logicOpEnable, blendInfo.logicOp, blendInfo.attachmentCount,
+                blendInfo.blendConstants[0], blendInfo.blendConstants[1], blendInfo.blendConstants[2],
+                blendInfo.blendConstants[3]);
+
+    const auto& depth = configInfo.depthStencilInfo;
+    hashCombine(seed, depth.depthTestEnable, depth.depthWriteEnable, depth.depthCompareOp,
+                depth.depthBoundsTestEnable, depth.minDepthBounds, depth.maxDepthBounds, depth.stencilTestEnable);
+
+    for (VkDynamicState state : configInfo.dynamicStateEnables) {
+        hashCombine(seed, state);
+    }
+
+    hashCombine(seed, configInfo.pipelineLayout, configInfo.renderPass, configInfo.subpass);
+    for (VkFormat format : configInfo.colorAttachmentFormats) {
+        hashCombine(seed, format);
+    }
+    hashCombine(seed, configInfo.depthAttachmentFormat);
+
+    for (const auto& binding : configInfo.bindingDescriptions) {
+        hashCombine(seed, binding.binding, binding.stride, binding.inputRate);
+    }
+    for (const auto& attribute : configInfo.attributeDescriptions) {
+        hashCombine(seed, attribute.location, attribute.binding, attribute.format, attribute.offset);
+    }
+    return seed;
+}
+
+bool EvilutionPipelineManager::pipelineConfigInfoEqual(const PipelineConfigInfo& a, const PipelineConfigInfo& b) {
+    auto viewportFields = [](const PipelineConfigInfo& c) {
+        return std::tie(c.viewportInfo.viewportCount, c.viewportInfo.scissorCount, c.inputAssemblyInfo.topology,
+                        c.inputAssemblyInfo.primitiveRestartEnable);
+    };
+    auto rasterFields = [](const PipelineConfigInfo& c) {
+        const auto& r = c.rasterizationInfo;
+        return std::tie(r.depthClampEnable, r.rasterizerDiscardEnable, r.polygonMode, r.lineWidth, r.cullMode,
+                        r.frontFace, r.depthBiasEnable, r.depthBiasConstantFactor, r.depthBiasClamp,
+                        r.depthBiasSlopeFactor);
+    };
+    auto multisampleFields = [](const PipelineConfigInfo& c) {
+        const auto& m = c.multisampleInfo;
+        return std::tie(m.rasterizationSamples, m.sampleShadingEnable, m.minSampleShading, m.alphaToCoverageEnable,
+                        m.alphaToOneEnable);
+    };
+    auto blendFields = [](const PipelineConfigInfo& c) {
+        const auto& b = c.colorBlendAttachment;
+        const auto& i = c.colorBlendInfo;
+        return std::tie(b.colorWriteMask, b.blendEnable, b.srcColorBlendFactor, b.dstColorBlendFactor,
+                        b.colorBlendOp, b.srcAlphaBlendFactor, b.dstAlphaBlendFactor, b.alphaBlendOp,
+                        i.logicOpEnable, i.logicOp, i.attachmentCount, i.blendConstants[0], i.blendConstants[1],
+                        i.blendConstants[2], i.blendConstants[3]);
+    };
+    auto depthFields = [](const PipelineConfigInfo& c) {
+        const auto& d = c.depthStencilInfo;
+        return std::tie(d.depthTestEnable, d.depthWriteEnable, d.depthCompareOp, d.depthBoundsTestEnable,
+                        d.minDepthBounds, d.maxDepthBounds, d.stencilTestEnable);
+    };
+    auto targetFields = [](const PipelineConfigInfo& c) {
+        return std::tie(c.dynamicStateEnables, c.pipelineLayout, c.renderPass, c.subpass, c.colorAttachmentFormats,
+                        c.depthAttachmentFormat);
+    };
+    auto bindingEqual = [](const VkVertexInputBindingDescription& x, const VkVertexInputBindingDescription& y) {
+        return x.binding == y.binding && x.stride == y.stride && x.inputRate == y.inputRate;
+    };
+    auto attributeEqual = [](const VkVertexInputAttributeDescription& x, const VkVertexInputAttributeDescription& y) {
+        return x.location == y.location && x.binding == y.binding && x.format == y.format && x.offset == y.offset;
+    };
+
+    return viewportFields(a) == viewportFields(b) && rasterFields(a) == rasterFields(b) &&
+           multisampleFields(a) == multisampleFields(b) && blendFields(a) == blendFields(b) &&
+           depthFields(a) == depthFields(b) && targetFields(a) == targetFields(b) &&
+           std::equal(a.bindingDescriptions.begin(), a.bindingDescriptions.end(), b.bindingDescriptions.begin(),
+                      b.bindingDescriptions.end(), bindingEqual) &&
+           std::equal(a.attributeDescriptions.begin(), a.attributeDescriptions.end(),
+                      b.attributeDescriptions.begin(), b.attributeDescriptions.end(), attributeEqual);
+}
+
+} // namespace evilution
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "evilution_device.hpp"
+#include "evilution_pipeline.hpp"
+#include "evilution_shader_module_cache.hpp"
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace evilution {
+
+enum class PipelineState : uint8_t { Pending, Ready, Failed };
+
+struct PipelineVariant {
+    size_t key = 0;
+    // the full key behind the hash; lookups compare it so a hash collision never returns the wrong pipeline
+    ShaderCode vertShader;
+    ShaderCode fragShader;
+    std::unique_ptr<PipelineConfigInfo> configInfo;
+    std::atomic<PipelineState> state{PipelineState::Pending};
+    std::unique_ptr<EvilutionPipeline> pipeline;
+};
+
+// Cheap to copy; all handles for the same config + shaders share one variant.
+class PipelineHandle {
+  public:
+    PipelineHandle() = default;
+
+    bool isValid() const { return variant != nullptr; }
+    bool isReady() const { return variant && variant->state.load(std::memory_order_acquire) == PipelineState::Ready; }
+    bool hasFailed() const {
+        return variant && variant->state.load(std::memory_order_acquire) == PipelineState::Failed;
+    }
+    size_t key() const { return variant ? variant->key : 0; }
+
+    // nullptr until the variant has finished compiling
+    EvilutionPipeline* get() const { return isReady() ? variant->pipeline.get() : nullptr; }
+
+  private:
+    friend class EvilutionPipelineManager;
+    explicit PipelineHandle(std::shared_ptr<PipelineVariant> variant) : variant{std::move(variant)} {}
+
+    std::shared_ptr<PipelineVariant> variant;
+};
+
+class EvilutionPipelineManager {
+  public:
+    EvilutionPipelineManager(EvilutionDevice& device, const std::string& cacheFilepath = "pipeline_cache.bin",
+                             uint32_t workerCount = 2);
+    ~EvilutionPipelineManager();
+
+    EvilutionPipelineManager(const EvilutionPipelineManager&) = delete;
+    EvilutionPipelineManager& operator=(const EvilutionPipelineManager&) = delete;
+
+    // Returns immediately. Identical requests share a variant; new variants are compiled on a worker thread
+    // unless the pipeline cache can satisfy them on the spot. The shader code must outlive the request.
+    PipelineHandle requestPipeline(const ShaderCode& vertShader, const ShaderCode& fragShader,
+                                   const PipelineConfigInfo& configInfo);
+    // Blocks until the variant is ready or has failed. Meant for loading screens, not the frame loop.
+    void waitForPipeline(const PipelineHandle& handle);
+    // Compiled on the calling thread through the same module and pipeline caches; compute pipelines have no
+    // variants to share.
+    std::unique_ptr<EvilutionComputePipeline> createComputePipeline(const ShaderCode& computeShader,
+                                                                    VkPipelineLayout pipelineLayout);
+
+    size_t variantCount() const;
+    size_t pendingCount() const;
+    size_t residentShaderModuleCount() const { return shaderModules.residentCount(); }
+
+    static size_t hashPipelineConfigInfo(const PipelineConfigInfo& configInfo);
+    // compares every field hashPipelineConfigInfo hashes
+    static bool pipelineConfigInfoEqual(const PipelineConfigInfo& a, const PipelineConfigInfo& b);
+
+  private:
+    struct CompileJob {
+        std::shared_ptr<PipelineVariant> variant;
+    };
+
+    void createPipelineCache();
+    void savePipelineCache();
+    void workerLoop();
+    void compile(CompileJob& job);
+    // for variants settled on the requesting thread; under the mutex so a concurrent waitForPipeline wakes up
+    void settleVariant(PipelineVariant& variant, PipelineState state);
+
+    EvilutionDevice& evilutionDevice;
+    EvilutionShaderModuleCache shaderModules;
+    std::string cacheFilepath;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+    mutable std::mutex mutex;
+    std::condition_variable queueCondition;
+    std::condition_variable readyCondition;
+    std::unordered_multimap<size_t, std::shared_ptr<PipelineVariant>> variants;
+    std::deque<std::unique_ptr<CompileJob>> compileQueue;
+    size_t pendingJobs = 0;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+};
+} // namespace evilution
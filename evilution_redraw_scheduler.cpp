@@ -0,0 +1,94 @@
+#include "evilution_redraw_scheduler.hpp"
+
+// std
+#include <algorithm>
+#include <iomanip>
+
+namespace evilution {
+
+namespace {
+using MillisecondsDouble = std::chrono::duration<double, std::milli>;
+using SecondsDouble = std::chrono::duration<double>;
+} // namespace
+
+EvilutionRedrawScheduler::EvilutionRedrawScheduler() : startTime{Clock::now()} {}
+
+void EvilutionRedrawScheduler::invalidate(Clock::time_point requestTime) {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (!pending || requestTime < this->requestTime) {
+            this->requestTime = requestTime;
+        }
+        pending = true;
+    }
+    condition.notify_all();
+}
+
+void EvilutionRedrawScheduler::markIdleWakeup() {
+    std::lock_guard<std::mutex> lock{mutex};
+    idleWakeups++;
+}
+
+bool EvilutionRedrawScheduler::waitForFrame(Clock::time_point& wakeTime) {
+    std::unique_lock<std::mutex> lock{mutex};
+    wakeTime = {};
+    if (!pending && !stopping) {
+        auto idleStart = Clock::now();
+        condition.wait(lock, [this] { return pending || stopping; });
+        if (!stopping) {
+            idlePeriods++;
+            idleTime += Clock::now() - idleStart;
+            wakeTime = requestTime;
+        }
+    }
+    if (stopping) {
+        return false;
+    }
+
+    pending = false;
+    activeFrames++;
+    return true;
+}
+
+void EvilutionRedrawScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    condition.notify_all();
+}
+
+void EvilutionRedrawScheduler::markWakePresented(Clock::time_point wakeTime) {
+    double latencyMs = std::chrono::duration_cast<MillisecondsDouble>(Clock::now() - wakeTime).count();
+    std::lock_guard<std::mutex> lock{mutex};
+    wakeSamples++;
+    totalWakeLatencyMs += latencyMs;
+    maxWakeLatencyMs = std::max(maxWakeLatencyMs, latencyMs);
+}
+
+EvilutionRedrawScheduler::Stats EvilutionRedrawScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    Stats stats{};
+    stats.activeFrames = activeFrames;
+    stats.idlePeriods = idlePeriods;
+    stats.idleWakeups = idleWakeups;
+    stats.idleSeconds = std::chrono::duration_cast<SecondsDouble>(idleTime).count();
+    stats.runSeconds = std::chrono::duration_cast<SecondsDouble>(Clock::now() - startTime).count();
+    stats.wakeSamples = wakeSamples;
+    stats.meanWakeLatencyMs = wakeSamples > 0 ? totalWakeLatencyMs / wakeSamples : 0.0;
+    stats.maxWakeLatencyMs = maxWakeLatencyMs;
+    return stats;
+}
+
+void EvilutionRedrawScheduler::printStats(std::ostream& out) const {
+    Stats stats = getStats();
+    double idlePercent = stats.runSeconds > 0.0 ? 100.0 * stats.idleSeconds / stats.runSeconds : 0.0;
+    out << std::fixed << std::setprecision(2) << "on-demand rendering: " << stats.activeFrames << " active frames, "
+        << stats.idlePeriods << " idle periods (" << stats.idleSeconds << " s, " << idlePercent << "% of the run), "
+        << stats.idleWakeups << " idle wake-ups" << std::endl
+        << "\twake-up latency mean " << stats.meanWakeLatencyMs << " ms, max " << stats.maxWakeLatencyMs
+        << " ms over " << stats.wakeSamples << " wake-ups" << std::endl;
+    out.unsetf(std::ios::floatfield);
+}
+
+} // namespace evilution
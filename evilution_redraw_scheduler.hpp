@@ -0,0 +1,71 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+
+namespace evilution {
+
+// Decides when an on-demand loop builds a frame: only after something invalidated it, be it input, a window
+// event, an animation that is still running or an explicit request. Between those the simulation thread blocks in
+// waitForFrame() and the render thread, with no snapshot to draw, blocks behind it. Safe to use from any thread.
+class EvilutionRedrawScheduler {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t activeFrames = 0;
+        // the frame loop had nothing to do and went to sleep
+        uint64_t idlePeriods = 0;
+        // the main thread woke up to events or a timeout that changed nothing
+        uint64_t idleWakeups = 0;
+        double idleSeconds = 0.0;
+        double runSeconds = 0.0;
+        // from the invalidation that ended an idle period to that frame's present
+        uint64_t wakeSamples = 0;
+        double meanWakeLatencyMs = 0.0;
+        double maxWakeLatencyMs = 0.0;
+    };
+
+    EvilutionRedrawScheduler();
+
+    EvilutionRedrawScheduler(const EvilutionRedrawScheduler&) = delete;
+    EvilutionRedrawScheduler& operator=(const EvilutionRedrawScheduler&) = delete;
+
+    // Requests a frame. While one is already pending, the earliest request is the one wake latency is measured
+    // from.
+    void invalidate(Clock::time_point requestTime = Clock::now());
+    void markIdleWakeup();
+
+    // Blocks until a frame is requested; false once stop() was called. wakeTime is the request that ended an
+    // idle period, or left at its default when a frame was already pending.
+    bool waitForFrame(Clock::time_point& wakeTime);
+    // wakes every waiter for good
+    void stop();
+    // for a frame that waitForFrame() returned a wake time for, once it has been presented
+    void markWakePresented(Clock::time_point wakeTime);
+
+    Stats getStats() const;
+    void printStats(std::ostream& out) const;
+
+  private:
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    bool pending = false;
+    bool stopping = false;
+    Clock::time_point requestTime{};
+
+    Clock::time_point startTime;
+    Clock::duration idleTime{};
+    uint64_t activeFrames = 0;
+    uint64_t idlePeriods = 0;
+    uint64_t idleWakeups = 0;
+    uint64_t wakeSamples = 0;
+    double totalWakeLatencyMs = 0.0;
+    double maxWakeLatencyMs = 0.0;
+};
+
+} // namespace evilution
@@ -0,0 +1,580 @@
+#include "evilution_render_graph.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+namespace evilution {
+
+namespace {
+constexpr VkAccessFlags WRITE_ACCESS_MASK = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+                                            VK_ACCESS_TRANSFER_WRITE_BIT;
+
+bool isDepthFormat(VkFormat format) {
+    return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT ||
+           format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+           format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+VkImageAspectFlags aspectMaskFor(VkFormat format) {
+    if (!isDepthFormat(format)) {
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+    if (format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+        format == VK_FORMAT_D32_SFLOAT_S8_UINT) {
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    return VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+} // namespace
+
+EvilutionRenderGraph::EvilutionRenderGraph(EvilutionDevice& device) : evilutionDevice{device} {}
+
+EvilutionRenderGraph::~EvilutionRenderGraph() { releaseTransientImages(); }
+
+RenderGraphResource EvilutionRenderGraph::importBackbuffer(VkFormat format) {
+    assert(backbuffer == UINT32_MAX && "Render graph already has a backbuffer");
+    Resource resource{};
+    resource.name = "backbuffer";
+    resource.format = format;
+    resource.imported = true;
+    resources.push_back(resource);
+    backbuffer = static_cast<RenderGraphResource>(resources.size() - 1);
+    dirty = true;
+    return backbuffer;
+}
+
+RenderGraphResource EvilutionRenderGraph::createImage(const std::string& name, VkFormat format, float extentScale) {
+    Resource resource{};
+    resource.name = name;
+    resource.format = format;
+    resource.extentScale = extentScale;
+    resources.push_back(resource);
+    dirty = true;
+    return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphPass EvilutionRenderGraph::addPass(const std::string& name, RecordFunction record) {
+    passes.push_back({name, std::move(record), {}, false});
+    dirty = true;
+    return static_cast<RenderGraphPass>(passes.size() - 1);
+}
+
+void EvilutionRenderGraph::writeColor(RenderGraphPass pass, RenderGraphResource resource) {
+    addUse(pass, {resource, Usage::ColorWrite});
+}
+
+void EvilutionRenderGraph::writeColor(RenderGraphPass pass, RenderGraphResource resource,
+                                      const VkClearColorValue& clearValue) {
+    ResourceUse use{resource, Usage::ColorWrite, true};
+    use.clearValue.color = clearValue;
+    addUse(pass, use);
+}
+
+void EvilutionRenderGraph::writeDepth(RenderGraphPass pass, RenderGraphResource resource) {
+    addUse(pass, {resource, Usage::DepthWrite});
+}
+
+void EvilutionRenderGraph::writeDepth(RenderGraphPass pass, RenderGraphResource resource, float clearDepth) {
+    ResourceUse use{resource, Usage::DepthWrite, true};
+    use.clearValue.depthStencil = {clearDepth, 0};
+    addUse(pass, use);
+}
+
+void EvilutionRenderGraph::readDepth(RenderGraphPass pass, RenderGraphResource resource) {
+    addUse(pass, {resource, Usage::DepthRead});
+}
+
+void EvilutionRenderGraph::readTexture(RenderGraphPass pass, RenderGraphResource resource,
+                                       VkPipelineStageFlags stages) {
+    ResourceUse use{resource, Usage::Sampled};
+    use.stages = stages;
+    addUse(pass, use);
+}
+
+void EvilutionRenderGraph::setSideEffects(RenderGraphPass pass) {
+    assert(pass < passes.size() && "Unknown render graph pass");
+    passes[pass].sideEffects = true;
+    dirty = true;
+}
+
+void EvilutionRenderGraph::setSecondaryCommandBuffers(RenderGraphPass pass) {
+    assert(pass < passes.size() && "Unknown render graph pass");
+    // only changes how the pass is recorded, so the compiled graph stays valid
+    passes[pass].secondaryCommandBuffers = true;
+}
+
+void EvilutionRenderGraph::addUse(RenderGraphPass pass, const ResourceUse& use) {
+    assert(pass < passes.size() && "Unknown render graph pass");
+    assert(use.resource < resources.size() && "Unknown render graph resource");
+    assert((use.usage == Usage::Sampled ||
+            (use.usage == Usage::ColorWrite) != isDepthFormat(resources[use.resource].format)) &&
+           "Depth usages need a depth format, color usages a color format");
+    passes[pass].uses.push_back(use);
+    dirty = true;
+}
+
+RenderTargetInfo EvilutionRenderGraph::getRenderTargetInfo(RenderGraphPass pass) const {
+    RenderTargetInfo info{};
+    for (const auto& use : passes[pass].uses) {
+        if (use.usage == Usage::ColorWrite) {
+            info.colorAttachmentFormats.push_back(resources[use.resource].format);
+        } else if (use.usage == Usage::DepthWrite || use.usage == Usage::DepthRead) {
+            info.depthAttachmentFormat = resources[use.resource].format;
+        }
+    }
+    return info;
+}
+
+VkImageView EvilutionRenderGraph::getImageView(RenderGraphResource resource) const {
+    assert(!resources[resource].imported && "The backbuffer view changes every frame");
+    return resources[resource].view;
+}
+
+VkExtent2D EvilutionRenderGraph::getImageExtent(RenderGraphResource resource) const {
+    assert(!dirty && "Render graph must be compiled before its images have an extent");
+    return resourceExtent(resources[resource]);
+}
+
+VkExtent2D EvilutionRenderGraph::resourceExtent(const Resource& resource) const {
+    return {std::max(1u, static_cast<uint32_t>(std::lround(compiledExtent.width * resource.extentScale))),
+            std::max(1u, static_cast<uint32_t>(std::lround(compiledExtent.height * resource.extentScale)))};
+}
+
+void EvilutionRenderGraph::compile(VkExtent2D outputExtent) {
+    if (!dirty && outputExtent.width == compiledExtent.width && outputExtent.height == compiledExtent.height) {
+        return;
+    }
+
+    // frames already submitted may still use the old images; they are destroyed once those complete
+    releaseTransientImages();
+    compiledPasses.clear();
+    compiledExtent = outputExtent;
+    uint32_t compileCount = stats.compileCount + 1;
+    stats = {};
+    stats.compileCount = compileCount;
+
+    cullPasses();
+    allocateTransientImages();
+    computeBarriers();
+    dirty = false;
+}
+
+void EvilutionRenderGraph::cullPasses() {
+    // walk backwards from the backbuffer: a pass survives if something later needs what it writes
+    std::vector<bool> needed(resources.size(), false);
+    if (backbuffer != UINT32_MAX) {
+        needed[backbuffer] = true;
+    }
+
+    std::vector<bool> keep(passes.size(), false);
+    for (size_t i = passes.size(); i-- > 0;) {
+        const auto& pass = passes[i];
+        keep[i] = pass.sideEffects;
+        for (const auto& use : pass.uses) {
+            bool writes = use.usage == Usage::ColorWrite || use.usage == Usage::DepthWrite;
+            if (writes && needed[use.resource]) {
+                keep[i] = true;
+            }
+        }
+        if (!keep[i]) {
+            continue;
+        }
+
+        // a clear overwrites everything earlier passes wrote; loads and reads depend on them
+        for (const auto& use : pass.uses) {
+            if (use.clear) {
+                needed[use.resource] = false;
+            }
+        }
+        for (const auto& use : pass.uses) {
+            if (!use.clear) {
+                needed[use.resource] = true;
+            }
+        }
+    }
+
+    for (auto& resource : resources) {
+        resource.used = false;
+        resource.usageFlags = 0;
+    }
+
+    for (uint32_t i = 0; i < passes.size(); i++) {
+        if (!keep[i]) {
+            stats.culledPassCount++;
+            continue;
+        }
+
+        CompiledPass compiled{};
+        compiled.passIndex = i;
+        compiled.extent = compiledExtent;
+        uint32_t compiledIndex = static_cast<uint32_t>(compiledPasses.size());
+        for (const auto& use : passes[i].uses) {
+            auto& resource = resources[use.resource];
+            if (!resource.used) {
+                resource.used = true;
+                resource.firstUse = compiledIndex;
+            }
+            resource.lastUse = compiledIndex;
+
+            switch (use.usage) {
+            case Usage::ColorWrite:
+                resource.usageFlags |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+                break;
+            case Usage::DepthWrite:
+            case Usage::DepthRead:
+                resource.usageFlags |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+                break;
+            case Usage::Sampled:
+                resource.usageFlags |= VK_IMAGE_USAGE_SAMPLED_BIT;
+                break;
+            }
+            if (use.usage != Usage::Sampled) {
+                compiled.extent = resourceExtent(resource);
+            }
+        }
+        compiledPasses.push_back(std::move(compiled));
+    }
+    stats.passCount = static_cast<uint32_t>(compiledPasses.size());
+}
+
+void EvilutionRenderGraph::allocateTransientImages() {
+    std::vector<RenderGraphResource> transients;
+    std::vector<VkMemoryRequirements> requirements(resources.size());
+    for (RenderGraphResource r = 0; r < resources.size(); r++) {
+        auto& resource = resources[r];
+        if (resource.imported || !resource.used) {
+            continue;
+        }
+
+        VkExtent2D extent = resourceExtent(resource);
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = extent.width;
+        imageInfo.extent.height = extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = resource.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = resource.usageFlags;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        // the image shares memory with others and starts every frame with undefined contents
+        imageInfo.flags = VK_IMAGE_CREATE_ALIAS_BIT;
+
+        if (vkCreateImage(evilutionDevice.device(), &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create render graph image!");
+        }
+        vkGetImageMemoryRequirements(evilutionDevice.device(), resource.image, &requirements[r]);
+        stats.requestedTransientBytes += requirements[r].size;
+        transients.push_back(r);
+    }
+
+    // largest first, each into the first slot whose memory type fits and whose occupants are done by then
+    std::sort(transients.begin(), transients.end(), [&requirements](RenderGraphResource a, RenderGraphResource b) {
+        return requirements[a].size > requirements[b].size;
+    });
+    for (RenderGraphResource r : transients) {
+        auto& resource = resources[r];
+        auto overlaps = [this, &resource](RenderGraphResource other) {
+            return resources[other].firstUse <= resource.lastUse && resource.firstUse <= resources[other].lastUse;
+        };
+
+        uint32_t slotIndex = 0;
+        for (; slotIndex < memorySlots.size(); slotIndex++) {
+            const auto& slot = memorySlots[slotIndex];
+            if ((slot.memoryTypeBits & requirements[r].memoryTypeBits) != 0 &&
+                std::none_of(slot.occupants.begin(), slot.occupants.end(), overlaps)) {
+                break;
+            }
+        }
+        if (slotIndex == memorySlots.size()) {
+            MemorySlot slot{};
+            slot.memoryTypeBits = requirements[r].memoryTypeBits;
+            memorySlots.push_back(slot);
+        }
+
+        auto& slot = memorySlots[slotIndex];
+        // images always bind at offset 0, so the alignment requirement is met by any allocation
+        slot.size = std::max(slot.size, requirements[r].size);
+        slot.memoryTypeBits &= requirements[r].memoryTypeBits;
+        slot.occupants.push_back(r);
+        resource.memorySlot = slotIndex;
+    }
+
+    for (auto& slot : memorySlots) {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = slot.size;
+        allocInfo.memoryTypeIndex =
+            evilutionDevice.findMemoryType(slot.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (vkAllocateMemory(evilutionDevice.device(), &allocInfo, nullptr, &slot.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate render graph memory!");
+        }
+        stats.allocatedTransientBytes += slot.size;
+
+        std::sort(slot.occupants.begin(), slot.occupants.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+            return resources[a].firstUse < resources[b].firstUse;
+        });
+        for (RenderGraphResource r : slot.occupants) {
+            if (vkBindImageMemory(evilutionDevice.device(), resources[r].image, slot.memory, 0) != VK_SUCCESS) {
+                throw std::runtime_error("failed to bind render graph image memory!");
+            }
+        }
+    }
+
+    for (RenderGraphResource r : transients) {
+        auto& resource = resources[r];
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = resource.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = resource.format;
+        // samplers read one aspect; the depth aspect alone still works as a depth attachment
+        bool sampled = (resource.usageFlags & VK_IMAGE_USAGE_SAMPLED_BIT) != 0;
+        viewInfo.subresourceRange.aspectMask =
+            sampled && isDepthFormat(resource.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : aspectMaskFor(resource.format);
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(evilutionDevice.device(), &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create render graph image view!");
+        }
+    }
+    stats.transientImageCount = static_cast<uint32_t>(transients.size());
+}
+
+void EvilutionRenderGraph::computeBarriers() {
+    struct State {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+    };
+    std::vector<State> states(resources.size());
+
+    for (auto& compiled : compiledPasses) {
+        for (const auto& use : passes[compiled.passIndex].uses) {
+            State target{};
+            switch (use.usage) {
+            case Usage::ColorWrite:
+                target = {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                          use.clear ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                    : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+                break;
+            case Usage::DepthWrite:
+                target = {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                          VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT};
+                break;
+            case Usage::DepthRead:
+                target = {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                          VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT};
+                break;
+            case Usage::Sampled:
+                target = {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, use.stages, VK_ACCESS_SHADER_READ_BIT};
+                break;
+            }
+
+            State& current = states[use.resource];
+            bool firstUse = current.stages == 0;
+            bool layoutChange = current.layout != target.layout;
+            bool hazard = (current.access & WRITE_ACCESS_MASK) != 0 || (target.access & WRITE_ACCESS_MASK) != 0;
+
+            if (firstUse) {
+                // contents are discarded; transient images still have to wait for whatever used their memory last
+                Barrier barrier{use.resource, VK_IMAGE_LAYOUT_UNDEFINED, target.layout,
+                                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, target.stages, 0, target.access};
+                barrier.waitsOnMemorySlot = !resources[use.resource].imported;
+                compiled.barriers.push_back(barrier);
+                current = target;
+            } else if (layoutChange || hazard) {
+                compiled.barriers.push_back({use.resource, current.layout, target.layout, current.stages,
+                                             target.stages, current.access & WRITE_ACCESS_MASK, target.access});
+                current = target;
+            } else {
+                // read after read in the same layout needs nothing, later writers just have to wait on both
+                current.stages |= target.stages;
+                current.access |= target.access;
+            }
+        }
+    }
+
+    for (RenderGraphResource r = 0; r < resources.size(); r++) {
+        resources[r].finalLayout = states[r].layout;
+        resources[r].finalStages = states[r].stages;
+        resources[r].finalAccess = states[r].access;
+    }
+
+    for (auto& compiled : compiledPasses) {
+        for (auto& barrier : compiled.barriers) {
+            if (!barrier.waitsOnMemorySlot) {
+                continue;
+            }
+
+            // the previous occupant this frame, or the last one from the previous frame
+            const auto& resource = resources[barrier.resource];
+            const auto& occupants = memorySlots[resource.memorySlot].occupants;
+            RenderGraphResource previous = occupants.back();
+            for (RenderGraphResource other : occupants) {
+                if (resources[other].lastUse < resource.firstUse) {
+                    previous = other;
+                }
+            }
+            barrier.srcStages = resources[previous].finalStages;
+            barrier.srcAccess = resources[previous].finalAccess & WRITE_ACCESS_MASK;
+        }
+        stats.barrierCount += static_cast<uint32_t>(compiled.barriers.size());
+    }
+}
+
+void EvilutionRenderGraph::execute(VkCommandBuffer commandBuffer, VkImage backbufferImage,
+                                   VkImageView backbufferView) {
+    assert(!dirty && "Render graph must be compiled before it is executed");
+
+    auto imageFor = [&](RenderGraphResource r) { return r == backbuffer ? backbufferImage : resources[r].image; };
+    auto viewFor = [&](RenderGraphResource r) { return r == backbuffer ? backbufferView : resources[r].view; };
+
+    auto recordBarriers = [&](const std::vector<Barrier>& barriers) {
+        if (barriers.empty()) {
+            return;
+        }
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        imageBarriers.reserve(barriers.size());
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        for (const auto& barrier : barriers) {
+            VkImageMemoryBarrier imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.srcAccessMask = barrier.srcAccess;
+            imageBarrier.dstAccessMask = barrier.dstAccess;
+            imageBarrier.oldLayout = barrier.oldLayout;
+            imageBarrier.newLayout = barrier.newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = imageFor(barrier.resource);
+            imageBarrier.subresourceRange = {aspectMaskFor(resources[barrier.resource].format), 0, 1, 0, 1};
+            imageBarriers.push_back(imageBarrier);
+            srcStages |= barrier.srcStages;
+            dstStages |= barrier.dstStages;
+        }
+        vkCmdPipelineBarrier(commandBuffer, srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             dstStages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()),
+                             imageBarriers.data());
+    };
+
+    for (uint32_t compiledIndex = 0; compiledIndex < compiledPasses.size(); compiledIndex++) {
+        const auto& compiled = compiledPasses[compiledIndex];
+        recordBarriers(compiled.barriers);
+
+        const auto& pass = passes[compiled.passIndex];
+        std::vector<VkRenderingAttachmentInfo> colorAttachments;
+        VkRenderingAttachmentInfo depthAttachment{};
+        bool hasDepth = false;
+        for (const auto& use : pass.uses) {
+            if (use.usage == Usage::Sampled) {
+                continue;
+            }
+
+            bool firstUse = std::any_of(compiled.barriers.begin(), compiled.barriers.end(), [&use](const Barrier& b) {
+                return b.resource == use.resource && b.oldLayout == VK_IMAGE_LAYOUT_UNDEFINED;
+            });
+            VkRenderingAttachmentInfo attachment{};
+            attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+            attachment.imageView = viewFor(use.resource);
+            attachment.loadOp = use.clear  ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                                : firstUse ? VK_ATTACHMENT_LOAD_OP_DONT_CARE
+                                           : VK_ATTACHMENT_LOAD_OP_LOAD;
+            // only what a later pass or the presentation engine reads has to reach memory
+            bool readLater = use.resource == backbuffer || resources[use.resource].lastUse > compiledIndex;
+            attachment.storeOp = readLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.clearValue = use.clearValue;
+
+            if (use.usage == Usage::ColorWrite) {
+                attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                colorAttachments.push_back(attachment);
+            } else {
+                attachment.imageLayout = use.usage == Usage::DepthWrite
+                                             ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                                             : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+                depthAttachment = attachment;
+                hasDepth = true;
+            }
+        }
+
+        if (colorAttachments.empty() && !hasDepth) {
+            pass.record(commandBuffer);
+            continue;
+        }
+
+        VkRenderingInfo renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+        renderingInfo.renderArea.offset = {0, 0};
+        renderingInfo.renderArea.extent = compiled.extent;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+        renderingInfo.pColorAttachments = colorAttachments.data();
+        renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+        if (pass.secondaryCommandBuffers) {
+            renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+            evilutionDevice.cmdBeginRendering(commandBuffer, renderingInfo);
+            pass.record(commandBuffer);
+            evilutionDevice.cmdEndRendering(commandBuffer);
+            continue;
+        }
+        evilutionDevice.cmdBeginRendering(commandBuffer, renderingInfo);
+
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(compiled.extent.width);
+        viewport.height = static_cast<float>(compiled.extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        VkRect2D scissor{{0, 0}, compiled.extent};
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        pass.record(commandBuffer);
+        evilutionDevice.cmdEndRendering(commandBuffer);
+    }
+
+    if (backbuffer != UINT32_MAX && resources[backbuffer].used) {
+        const auto& resource = resources[backbuffer];
+        recordBarriers({{backbuffer, resource.finalLayout, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, resource.finalStages,
+                         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, resource.finalAccess & WRITE_ACCESS_MASK, 0}});
+    }
+}
+
+void EvilutionRenderGraph::releaseTransientImages() {
+    // earlier frames may still be using them
+    auto& deletionQueue = evilutionDevice.deletionQueue();
+    for (auto& resource : resources) {
+        if (resource.image != VK_NULL_HANDLE) {
+            deletionQueue.destroyImage(resource.image, resource.view, VK_NULL_HANDLE);
+        }
+        resource.view = VK_NULL_HANDLE;
+        resource.image = VK_NULL_HANDLE;
+    }
+    for (auto& slot : memorySlots) {
+        deletionQueue.freeMemory(slot.memory);
+    }
+    memorySlots.clear();
+}
+
+void EvilutionRenderGraph::Stats::print(std::ostream& out) const {
+    out << "render graph: " << passCount << " passes (" << culledPassCount << " culled), " << barrierCount
+        << " barriers, " << transientImageCount << " transient images in " << allocatedTransientBytes / 1024
+        << " KiB (" << requestedTransientBytes / 1024 << " KiB without aliasing), compiled " << compileCount
+        << " times" << std::endl;
+}
+
+} // namespace evilution
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "evilution_device.hpp"
+#include "evilution_swap_chain.hpp"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace evilution {
+
+using RenderGraphResource = uint32_t;
+using RenderGraphPass = uint32_t;
+
+// Frame description built from passes that declare what they read and write. compile() culls passes that do not
+// contribute to the backbuffer, precomputes the barriers between passes and places transient images with
+// disjoint lifetimes in shared memory. It only reruns when passes are added or the output extent changes.
+// Passes render with dynamic rendering, so the graph requires EvilutionDevice::dynamicRenderingSupported().
+class EvilutionRenderGraph {
+  public:
+    using RecordFunction = std::function<void(VkCommandBuffer)>;
+
+    struct Stats {
+        uint32_t passCount = 0;
+        uint32_t culledPassCount = 0;
+        uint32_t transientImageCount = 0;
+        uint32_t barrierCount = 0;
+        // memory the transient images would need without aliasing, and what was actually allocated
+        VkDeviceSize requestedTransientBytes = 0;
+        VkDeviceSize allocatedTransientBytes = 0;
+        // times the graph was compiled; the other counts describe the latest compile
+        uint32_t compileCount = 0;
+
+        void print(std::ostream& out) const;
+    };
+
+    explicit EvilutionRenderGraph(EvilutionDevice& device);
+    ~EvilutionRenderGraph();
+
+    EvilutionRenderGraph(const EvilutionRenderGraph&) = delete;
+    EvilutionRenderGraph& operator=(const EvilutionRenderGraph&) = delete;
+
+    // The swap chain image; provided per frame to execute() and transitioned for present after its last use.
+    RenderGraphResource importBackbuffer(VkFormat format);
+    // Owned by the graph and only valid within a frame. Sized relative to the output extent.
+    RenderGraphResource createImage(const std::string& name, VkFormat format, float extentScale = 1.0f);
+
+    // Passes run in the order they were added; a pass must be added after the passes whose output it reads.
+    RenderGraphPass addPass(const std::string& name, RecordFunction record);
+    void writeColor(RenderGraphPass pass, RenderGraphResource resource);
+    void writeColor(RenderGraphPass pass, RenderGraphResource resource, const VkClearColorValue& clearValue);
+    void writeDepth(RenderGraphPass pass, RenderGraphResource resource);
+    void writeDepth(RenderGraphPass pass, RenderGraphResource resource, float clearDepth);
+    // depth test against an earlier pass's depth without writing it
+    void readDepth(RenderGraphPass pass, RenderGraphResource resource);
+    // sampled from the given shader stages; depth images are sampled through their depth aspect
+    void readTexture(RenderGraphPass pass, RenderGraphResource resource,
+                     VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    // Kept even though nothing the backbuffer needs depends on it, for passes whose results live outside the
+    // graph, like compute passes writing buffers.
+    void setSideEffects(RenderGraphPass pass);
+    // The pass records nothing but vkCmdExecuteCommands, so its secondary command buffers have to set their own
+    // viewport and scissor.
+    void setSecondaryCommandBuffers(RenderGraphPass pass);
+
+    // Formats the pass's pipelines must be created with.
+    RenderTargetInfo getRenderTargetInfo(RenderGraphPass pass) const;
+    // Valid after compile(), for binding transient images as textures.
+    VkImageView getImageView(RenderGraphResource resource) const;
+    VkExtent2D getImageExtent(RenderGraphResource resource) const;
+
+    void compile(VkExtent2D outputExtent);
+    void execute(VkCommandBuffer commandBuffer, VkImage backbufferImage, VkImageView backbufferView);
+
+    const Stats& getStats() const { return stats; }
+
+  private:
+    enum class Usage : uint8_t { ColorWrite, DepthWrite, DepthRead, Sampled };
+
+    struct ResourceUse {
+        RenderGraphResource resource;
+        Usage usage;
+        bool clear = false;
+        VkClearValue clearValue{};
+        // Sampled only
+        VkPipelineStageFlags stages = 0;
+    };
+
+    struct Pass {
+        std::string name;
+        RecordFunction record;
+        std::vector<ResourceUse> uses;
+        bool sideEffects = false;
+        bool secondaryCommandBuffers = false;
+    };
+
+    struct Resource {
+        std::string name;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        float extentScale = 1.0f;
+        bool imported = false;
+
+        // filled in by compile()
+        VkImageUsageFlags usageFlags = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        uint32_t firstUse = 0;
+        uint32_t lastUse = 0;
+        bool used = false;
+        uint32_t memorySlot = 0;
+        // state after the resource's last use in a frame
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags finalStages = 0;
+        VkAccessFlags finalAccess = 0;
+    };
+
+    struct Barrier {
+        RenderGraphResource resource;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+        VkPipelineStageFlags srcStages;
+        VkPipelineStageFlags dstStages;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+        // first use of an image in a frame waits on the previous image that used its memory, filled in late
+        bool waitsOnMemorySlot = false;
+    };
+
+    struct CompiledPass {
+        uint32_t passIndex;
+        std::vector<Barrier> barriers;
+        VkExtent2D extent;
+    };
+
+    struct MemorySlot {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeBits = 0;
+        // resources placed here, ordered by first use
+        std::vector<RenderGraphResource> occupants;
+    };
+
+    void addUse(RenderGraphPass pass, const ResourceUse& use);
+    void cullPasses();
+    void allocateTransientImages();
+    void computeBarriers();
+    void releaseTransientImages();
+    VkExtent2D resourceExtent(const Resource& resource) const;
+
+    EvilutionDevice& evilutionDevice;
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    RenderGraphResource backbuffer = UINT32_MAX;
+
+    bool dirty = true;
+    VkExtent2D compiledExtent{0, 0};
+    std::vector<CompiledPass> compiledPasses;
+    std::vector<MemorySlot> memorySlots;
+    Stats stats{};
+};
+
+} // namespace evilution
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "evilution_camera.hpp"
+#include "evilution_draw_list.hpp"
+#include "evilution_resource_registry.hpp"
+
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace evilution {
+
+struct RenderObject {
+    ModelHandle model{};
+    // only filled for SimpleRenderSystem; meshlet rendering reads the instance buffer instead
+    glm::mat4 transform{1.0f};
+    glm::mat4 normalMatrix{1.0f};
+    // stable across frames, for per-object state kept on the GPU
+    uint32_t id = 0;
+    // where the instance buffer holds this object's transform
+    uint32_t instance = 0;
+    // also in staticObjects; renderers that replay those skip it here
+    bool isStatic = false;
+};
+
+// one slot of the GPU instance buffer, laid out as the shaders read it
+struct InstanceData {
+    glm::mat4 modelMatrix{1.0f};
+    glm::mat4 normalMatrix{1.0f};
+};
+
+struct InstanceUpdate {
+    uint32_t slot = 0;
+    InstanceData data{};
+};
+
+// a slot's translation, rotation and scale, from which a compute shader builds its InstanceData; laid out as
+// the shader reads it
+struct TransformUpdate {
+    glm::vec3 translation{};
+    uint32_t slot = 0;
+    glm::vec3 rotation{};
+    float padding0 = 0.f;
+    glm::vec3 scale{1.f};
+    float padding1 = 0.f;
+};
+
+// Everything the render thread needs to draw one simulated frame. Built by the simulation thread and not
+// modified once published, so recording never touches the registry.
+struct RenderSnapshot {
+    uint64_t frameNumber = 0;
+    // when the input this frame was simulated from was sampled, for input-to-present latency
+    std::chrono::steady_clock::time_point inputSampleTime{};
+    // in on-demand mode, when the frame was requested if it ended an idle period; default otherwise
+    std::chrono::steady_clock::time_point wakeTime{};
+    EvilutionCamera camera{};
+    // only the objects that passed frustum culling
+    std::vector<RenderObject> objects;
+    // objects in the order to draw them, sorted by key
+    std::vector<DrawItem> drawOrder;
+    // the instance slots whose transform changed since the previous snapshot, for every renderable entity and
+    // not only the visible ones
+    std::vector<InstanceUpdate> instanceUpdates;
+    // the same changes as raw transforms, in place of instanceUpdates when the matrices are built on the GPU
+    std::vector<TransformUpdate> transformUpdates;
+    // slots in use or freed, one past the highest ever assigned
+    uint32_t instanceCount = 0;
+    // every resident static object, culled or not; only rebuilt when staticVersion changes, so the snapshots of
+    // the triple buffer each keep their own copy
+    std::vector<RenderObject> staticObjects;
+    // changes whenever staticObjects does; 0 before the first build
+    uint64_t staticVersion = 0;
+};
+
+} // namespace evilution
@@ -1,14 +1,18 @@
 #include "evilution_renderer.hpp"
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <stdexcept>
+#include <thread>
 
 namespace evilution {
 
-EvilutionRenderer::EvilutionRenderer(EvilutionWindow& window, EvilutionDevice& device)
-    : evilutionWindow{window}, evilutionDevice{device} {
+EvilutionRenderer::EvilutionRenderer(EvilutionWindow& window, EvilutionDevice& device,
+                                     const SwapChainSettings& settings)
+    : evilutionWindow{window}, evilutionDevice{device}, swapChainSettings{settings} {
     recreateSwapChain();
     createCommandBuffers();
 }
@@ -18,22 +22,32 @@ EvilutionRenderer::~EvilutionRenderer() { freeCommandBuffers(); }
 void EvilutionRenderer::recreateSwapChain() {
     auto extent = evilutionWindow.getExtent();
     while (extent.width == 0 || extent.height == 0) {
+        // minimized; events are handled on the main thread, which may not be this one
+        if (evilutionWindow.shouldClose()) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
         extent = evilutionWindow.getExtent();
-        glfwWaitEvents();
     }
-    vkDeviceWaitIdle(evilutionDevice.device());
 
     if (evilutionSwapChain == nullptr) {
-        evilutionSwapChain = std::make_unique<EvilutionSwapChain>(evilutionDevice, extent);
+        evilutionSwapChain = std::make_unique<EvilutionSwapChain>(evilutionDevice, extent, swapChainSettings);
     } else {
         std::shared_ptr<EvilutionSwapChain> oldSwapChain = std::move(evilutionSwapChain);
-        evilutionSwapChain = std::make_unique<EvilutionSwapChain>(evilutionDevice, extent, oldSwapChain);
+        evilutionSwapChain =
+            std::make_unique<EvilutionSwapChain>(evilutionDevice, extent, swapChainSettings, oldSwapChain);
         if (!oldSwapChain->compareSwapFormats(*evilutionSwapChain.get())) {
             throw std::runtime_error("Swap chain image(or depth) format has changed!");
         }
+
+        // No device idle: the old swap chain lives until the GPU is a few frames past it. Waiting for the
+        // frames after its last submission also gives the presentation engine time to release its images.
+        auto& timeline = evilutionDevice.timeline();
+        retiredSwapChains.push_back({oldSwapChain, timeline.lastSubmittedValue() + oldSwapChain->getFramesInFlight()});
     }
-    // if reder pass is compatible, do nothing here
-    // we'll come back to this in just a moment
+
+    // the new swap chain starts its sync objects at frame 0, keep the command buffers in step
+    currentFrameIndex = 0;
 }
 
 void EvilutionRenderer::createCommandBuffers() {
@@ -56,9 +70,22 @@ void EvilutionRenderer::freeCommandBuffers() {
     commandBuffers.clear();
 }
 
+void EvilutionRenderer::destroyRetiredSwapChains() {
+    auto& timeline = evilutionDevice.timeline();
+    retiredSwapChains.erase(std::remove_if(retiredSwapChains.begin(), retiredSwapChains.end(),
+                                           [&timeline](const RetiredSwapChain& retired) {
+                                               return retired.retireValue <= timeline.lastSubmittedValue() &&
+                                                      timeline.isComplete(retired.retireValue);
+                                           }),
+                            retiredSwapChains.end());
+}
+
 VkCommandBuffer EvilutionRenderer::beginFrame() {
     assert(!isFrameStarted && "Cannot call beginFrame while already in progress");
 
+    destroyRetiredSwapChains();
+    evilutionDevice.deletionQueue().collect();
+
     auto result = evilutionSwapChain->acquireNextImage(&currentImageIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreateSwapChain();
@@ -91,22 +118,39 @@ void EvilutionRenderer::endFrame() {
     }
 
     auto result = evilutionSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+    // the render thread is the only one submitting frames, so the last value submitted is at least this frame's
+    evilutionDevice.deletionQueue().markFrameSubmitted(evilutionDevice.timeline().lastSubmittedValue());
+    frameMetrics.recordFrame(evilutionSwapChain->getPresentMode(), evilutionSwapChain->getFramesInFlight(),
+                             evilutionSwapChain->takeBlockedMilliseconds());
+
+    isFrameStarted = false;
+    currentFrameIndex = (currentFrameIndex + 1) % static_cast<int>(evilutionSwapChain->getFramesInFlight());
+
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || evilutionWindow.wasWindowResized()) {
         evilutionWindow.resetWindowResizedFlag();
         recreateSwapChain();
     } else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to present swap chain image!");
     }
-
-    isFrameStarted = false;
-    currentFrameIndex = (currentFrameIndex + 1) % EvilutionSwapChain::MAX_FRAMES_IN_FLIGHT;
 }
 
-void EvilutionRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+void EvilutionRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents) {
     assert(isFrameStarted && "Cannot call beginSwapChainRenderPass if frame is not in progress");
     assert(commandBuffer == getCurrentCommandBuffer() &&
            "Cannot begin render pass on command buffer from a different frame");
 
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
+    clearValues[1].depthStencil = {1.0f, 0};
+
+    if (evilutionSwapChain->usesDynamicRendering()) {
+        beginSwapChainRendering(commandBuffer, clearValues[0], clearValues[1], contents);
+        if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+            setViewportAndScissor(commandBuffer);
+        }
+        return;
+    }
+
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = evilutionSwapChain->getRenderPass();
@@ -115,14 +159,16 @@ void EvilutionRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
     renderPassInfo.renderArea.offset = {0, 0};
     renderPassInfo.renderArea.extent = evilutionSwapChain->getSwapChainExtent();
 
-    std::array<VkClearValue, 2> clearValues{};
-    clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
-    clearValues[1].depthStencil = {1.0f, 0};
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+    if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+        setViewportAndScissor(commandBuffer);
+    }
+}
 
+void EvilutionRenderer::setViewportAndScissor(VkCommandBuffer commandBuffer) {
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -141,7 +187,110 @@ void EvilutionRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
     assert(commandBuffer == getCurrentCommandBuffer() &&
            "Cannot end render pass on command buffer from a different frame");
 
+    if (evilutionSwapChain->usesDynamicRendering()) {
+        endSwapChainRendering(commandBuffer);
+        return;
+    }
     vkCmdEndRenderPass(commandBuffer);
 }
 
+void EvilutionRenderer::executeRenderGraph(VkCommandBuffer commandBuffer, EvilutionRenderGraph& renderGraph) {
+    assert(isFrameStarted && "Cannot call executeRenderGraph if frame is not in progress");
+    assert(commandBuffer == getCurrentCommandBuffer() &&
+           "Cannot execute render graph on command buffer from a different frame");
+    assert(evilutionSwapChain->usesDynamicRendering() && "The render graph requires dynamic rendering");
+
+    renderGraph.compile(evilutionSwapChain->getSwapChainExtent());
+    renderGraph.execute(commandBuffer, evilutionSwapChain->getImage(currentImageIndex),
+                        evilutionSwapChain->getImageView(currentImageIndex));
+}
+
+void EvilutionRenderer::beginSwapChainRendering(VkCommandBuffer commandBuffer, const VkClearValue& colorClear,
+                                                const VkClearValue& depthClear, VkSubpassContents contents) {
+    assert(evilutionSwapChain->hasDepthImages() &&
+           "Swap chain rendering needs depth images; they were disabled in the swap chain settings");
+    // without a render pass the layout transitions are ours; both images are cleared so old contents can go
+    VkFormat depthFormat = evilutionSwapChain->getSwapChainDepthFormat();
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+        depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+
+    std::array<VkImageMemoryBarrier, 2> barriers{};
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = evilutionSwapChain->getImage(currentImageIndex);
+    barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barriers[1].dstAccessMask =
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[1].image = evilutionSwapChain->getDepthImage(currentImageIndex);
+    barriers[1].subresourceRange = {depthAspect, 0, 1, 0, 1};
+
+    // the color stage matches the acquire semaphore's wait stage, so the transition waits for the image
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    VkRenderingAttachmentInfo colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    colorAttachment.imageView = evilutionSwapChain->getImageView(currentImageIndex);
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue = colorClear;
+
+    VkRenderingAttachmentInfo depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depthAttachment.imageView = evilutionSwapChain->getDepthImageView(currentImageIndex);
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue = depthClear;
+
+    VkRenderingInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.renderArea.offset = {0, 0};
+    renderingInfo.renderArea.extent = evilutionSwapChain->getSwapChainExtent();
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+    if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+        renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+    }
+
+    evilutionDevice.cmdBeginRendering(commandBuffer, renderingInfo);
+}
+
+void EvilutionRenderer::endSwapChainRendering(VkCommandBuffer commandBuffer) {
+    evilutionDevice.cmdEndRendering(commandBuffer);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = evilutionSwapChain->getImage(currentImageIndex);
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
 } // namespace evilution
\ No newline at end of file
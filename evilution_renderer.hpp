@@ -1,5 +1,7 @@
 #pragma once
 
+#include "evilution_frame_metrics.hpp"
+#include "evilution_render_graph.hpp"
 #include "evilution_swap_chain.hpp"
 #include "evilution_window.hpp"
 
@@ -12,15 +14,31 @@
 namespace evilution {
 class EvilutionRenderer {
   public:
-    EvilutionRenderer(EvilutionWindow& window, EvilutionDevice& device);
+    EvilutionRenderer(EvilutionWindow& window, EvilutionDevice& device, const SwapChainSettings& settings = {});
     ~EvilutionRenderer();
 
     EvilutionRenderer(const EvilutionRenderer&) = delete;
     EvilutionRenderer& operator=(const EvilutionRenderer&) = delete;
 
     VkRenderPass getSwapChainRenderPass() const { return evilutionSwapChain->getRenderPass(); }
+    RenderTargetInfo getSwapChainRenderTargetInfo() const { return evilutionSwapChain->getRenderTargetInfo(); }
     float getAspectRatio() const { return evilutionSwapChain->extentAspectRatio(); }
+    VkExtent2D getSwapChainExtent() const { return evilutionSwapChain->getSwapChainExtent(); }
     bool isFrameInProgress() const { return isFrameStarted; }
+    // the render graph path needs this; otherwise use begin/endSwapChainRenderPass
+    bool usesDynamicRendering() const { return evilutionSwapChain->usesDynamicRendering(); }
+
+    // fixed at construction and applied again on every swap chain recreation
+    const SwapChainSettings& getSwapChainSettings() const { return swapChainSettings; }
+    VkPresentModeKHR getPresentMode() const { return evilutionSwapChain->getPresentMode(); }
+    uint32_t getFramesInFlight() const { return evilutionSwapChain->getFramesInFlight(); }
+
+    // call right after polling input so the next presented frame can be attributed to it
+    void markInputSampled() { frameMetrics.markInputSampled(); }
+    void markInputSampled(EvilutionFrameMetrics::Clock::time_point sampleTime) {
+        frameMetrics.markInputSampled(sampleTime);
+    }
+    const EvilutionFrameMetrics& getFrameMetrics() const { return frameMetrics; }
 
     VkCommandBuffer getCurrentCommandBuffer() const {
         assert(isFrameStarted && "Cannot get command buffer when frame is not in progress");
@@ -34,18 +52,37 @@ class EvilutionRenderer {
 
     VkCommandBuffer beginFrame();
     void endFrame();
-    void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    // With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS only vkCmdExecuteCommands may follow, and the secondary
+    // command buffers set their own viewport and scissor.
+    void beginSwapChainRenderPass(VkCommandBuffer commandBuffer,
+                                  VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
     void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    // Records the graph into the frame with the current swap chain image as its backbuffer, recompiling it first
+    // if the swap chain extent changed. Replaces begin/endSwapChainRenderPass.
+    void executeRenderGraph(VkCommandBuffer commandBuffer, EvilutionRenderGraph& renderGraph);
 
   private:
     void createCommandBuffers();
     void freeCommandBuffers();
     void recreateSwapChain();
+    void destroyRetiredSwapChains();
+    void beginSwapChainRendering(VkCommandBuffer commandBuffer, const VkClearValue& colorClear,
+                                 const VkClearValue& depthClear, VkSubpassContents contents);
+    void endSwapChainRendering(VkCommandBuffer commandBuffer);
+    void setViewportAndScissor(VkCommandBuffer commandBuffer);
 
     EvilutionWindow& evilutionWindow;
     EvilutionDevice& evilutionDevice;
     std::unique_ptr<EvilutionSwapChain> evilutionSwapChain;
+    struct RetiredSwapChain {
+        std::shared_ptr<EvilutionSwapChain> swapChain;
+        // destroyed once the timeline reaches this value
+        uint64_t retireValue;
+    };
+    std::vector<RetiredSwapChain> retiredSwapChains;
     std::vector<VkCommandBuffer> commandBuffers;
+    const SwapChainSettings swapChainSettings;
+    EvilutionFrameMetrics frameMetrics;
 
     uint32_t currentImageIndex;
     int currentFrameIndex{0};
@@ -0,0 +1,157 @@
+#include "evilution_resource_registry.hpp"
+
+// std
+#include <cassert>
+#include <mutex>
+#include <stdexcept>
+
+namespace evilution {
+
+EvilutionResourceRegistry::EvilutionResourceRegistry(EvilutionDeletionQueue& deletionQueue)
+    : deletionQueue{deletionQueue} {}
+
+ModelHandle EvilutionResourceRegistry::addModel(std::shared_ptr<EvilutionModel> model) {
+    ModelHandle handle = reserveModel();
+    setModel(handle, std::move(model));
+    return handle;
+}
+
+ModelHandle EvilutionResourceRegistry::reserveModel() {
+    std::unique_lock<std::shared_mutex> lock{mutex};
+    uint32_t slot = allocateSlot();
+    slots[slot].reserved = true;
+    // slot 0 with generation 0 would collide with the null handle; generations start at 1 and skip 0 on wrap
+    return ModelHandle{(slots[slot].generation << ModelHandle::INDEX_BITS) | slot};
+}
+
+void EvilutionResourceRegistry::setModel(ModelHandle reserved, std::shared_ptr<EvilutionModel> model) {
+    assert(model && "Cannot register a null model!");
+    glm::vec4 modelBounds{model->getBoundsCenter(), model->getBoundsRadius()};
+    GeometryAllocationId allocation = model->getGeometryAllocation();
+
+    std::unique_lock<std::shared_mutex> lock{mutex};
+    assert(isCurrent(reserved) && slots[reserved.index()].reserved && "Model handle was not reserved!");
+
+    Slot& slot = slots[reserved.index()];
+    slot.reserved = false;
+    slot.denseIndex = static_cast<uint32_t>(models.size());
+    models.push_back(std::move(model));
+    bounds.push_back(modelBounds);
+    geometryAllocations.push_back(allocation);
+    slotOfModel.push_back(reserved.index());
+}
+
+void EvilutionResourceRegistry::removeModel(ModelHandle handle) {
+    std::shared_ptr<EvilutionModel> removed;
+    {
+        std::unique_lock<std::shared_mutex> lock{mutex};
+        assert(isCurrent(handle) && "Cannot remove a model that is not registered!");
+
+        uint32_t index = slots[handle.index()].denseIndex;
+        if (index != INVALID_INDEX) {
+            // keep the pool dense by moving the last model into the gap
+            removed = std::move(models[index]);
+            uint32_t last = static_cast<uint32_t>(models.size()) - 1;
+            if (index != last) {
+                models[index] = std::move(models[last]);
+                bounds[index] = bounds[last];
+                geometryAllocations[index] = geometryAllocations[last];
+                slotOfModel[index] = slotOfModel[last];
+                slots[slotOfModel[index]].denseIndex = index;
+            }
+            models.pop_back();
+            bounds.pop_back();
+            geometryAllocations.pop_back();
+            slotOfModel.pop_back();
+        }
+        releaseSlot(handle.index());
+        removalCount.fetch_add(1, std::memory_order_release);
+    }
+
+    // a frame being recorded may hold the pointer; the geometry itself is deferred again by the pool
+    if (removed) {
+        deletionQueue.defer([removed] {});
+    }
+}
+
+bool EvilutionResourceRegistry::isValid(ModelHandle handle) const {
+    std::shared_lock<std::shared_mutex> lock{mutex};
+    return denseIndex(handle) != INVALID_INDEX;
+}
+
+bool EvilutionResourceRegistry::isPending(ModelHandle handle) const {
+    std::shared_lock<std::shared_mutex> lock{mutex};
+    return isCurrent(handle) && slots[handle.index()].reserved;
+}
+
+EvilutionModel* EvilutionResourceRegistry::getModel(ModelHandle handle) const {
+    std::shared_lock<std::shared_mutex> lock{mutex};
+    uint32_t index = denseIndex(handle);
+    return index != INVALID_INDEX ? models[index].get() : nullptr;
+}
+
+std::shared_ptr<EvilutionModel> EvilutionResourceRegistry::shareModel(ModelHandle handle) const {
+    std::shared_lock<std::shared_mutex> lock{mutex};
+    uint32_t index = denseIndex(handle);
+    return index != INVALID_INDEX ? models[index] : nullptr;
+}
+
+bool EvilutionResourceRegistry::tryGetBounds(ModelHandle handle, glm::vec4& modelBounds) const {
+    std::shared_lock<std::shared_mutex> lock{mutex};
+    uint32_t index = denseIndex(handle);
+    if (index == INVALID_INDEX) {
+        return false;
+    }
+    modelBounds = bounds[index];
+    return true;
+}
+
+bool EvilutionResourceRegistry::tryGetGeometry(ModelHandle handle, GeometryAllocationId& allocation) const {
+    std::shared_lock<std::shared_mutex> lock{mutex};
+    uint32_t index = denseIndex(handle);
+    if (index == INVALID_INDEX) {
+        return false;
+    }
+    allocation = geometryAllocations[index];
+    return true;
+}
+
+uint32_t EvilutionResourceRegistry::getModelCount() const {
+    std::shared_lock<std::shared_mutex> lock{mutex};
+    return static_cast<uint32_t>(models.size());
+}
+
+uint32_t EvilutionResourceRegistry::allocateSlot() {
+    if (!freeSlots.empty()) {
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    if (slots.size() > ModelHandle::INDEX_MASK) {
+        throw std::runtime_error("failed to register model, too many models!");
+    }
+    slots.emplace_back();
+    return static_cast<uint32_t>(slots.size() - 1);
+}
+
+void EvilutionResourceRegistry::releaseSlot(uint32_t index) {
+    Slot& slot = slots[index];
+    slot.denseIndex = INVALID_INDEX;
+    slot.reserved = false;
+    slot.generation = (slot.generation + 1) & ModelHandle::GENERATION_MASK;
+    if (slot.generation == 0) {
+        slot.generation = 1;
+    }
+    freeSlots.push_back(index);
+}
+
+bool EvilutionResourceRegistry::isCurrent(ModelHandle handle) const {
+    return !handle.isNull() && handle.index() < slots.size() &&
+           slots[handle.index()].generation == handle.generation();
+}
+
+uint32_t EvilutionResourceRegistry::denseIndex(ModelHandle handle) const {
+    return isCurrent(handle) ? slots[handle.index()].denseIndex : INVALID_INDEX;
+}
+
+} // namespace evilution
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "evilution_deletion_queue.hpp"
+#include "evilution_model.hpp"
+
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+namespace evilution {
+
+// 32-bit reference to a model in an EvilutionResourceRegistry: the low bits index a slot and the high bits hold
+// the slot's generation, so a handle to a removed model never resolves to whatever reuses its slot.
+// The default handle is null.
+struct ModelHandle {
+    static constexpr uint32_t INDEX_BITS = 20;
+    static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    uint32_t value = 0;
+
+    uint32_t index() const { return value & INDEX_MASK; }
+    uint32_t generation() const { return value >> INDEX_BITS; }
+    bool isNull() const { return value == 0; }
+
+    bool operator==(ModelHandle other) const { return value == other.value; }
+    bool operator!=(ModelHandle other) const { return value != other.value; }
+    bool operator<(ModelHandle other) const { return value < other.value; }
+};
+
+// Owns every model and hands out handles to them. What culling and drawing read, the bounding sphere and the
+// geometry allocation, is copied into dense arrays indexed alongside each other, so the hot paths read neither
+// the model nor its slot. The models themselves are only held to keep their geometry alive.
+//
+// Safe to use from several threads: loaders add models while the simulation culls and the render thread draws.
+// A removed model is kept alive until the frames that may have looked it up have completed, so a pointer from
+// getModel() stays valid for the rest of the frame it was taken in.
+class EvilutionResourceRegistry {
+  public:
+    explicit EvilutionResourceRegistry(EvilutionDeletionQueue& deletionQueue);
+
+    EvilutionResourceRegistry(const EvilutionResourceRegistry&) = delete;
+    EvilutionResourceRegistry& operator=(const EvilutionResourceRegistry&) = delete;
+
+    ModelHandle addModel(std::shared_ptr<EvilutionModel> model);
+    // A handle for a model that is still loading. It resolves to nothing until setModel() fills it in.
+    ModelHandle reserveModel();
+    void setModel(ModelHandle reserved, std::shared_ptr<EvilutionModel> model);
+    // Also cancels a reservation.
+    void removeModel(ModelHandle handle);
+
+    // false while the model is still loading
+    bool isValid(ModelHandle handle) const;
+    bool isPending(ModelHandle handle) const;
+    // nullptr for null, stale or pending handles
+    EvilutionModel* getModel(ModelHandle handle) const;
+    // for registering the same model under a second handle
+    std::shared_ptr<EvilutionModel> shareModel(ModelHandle handle) const;
+    // model space bounding sphere as (center, radius); false if the model is not resident
+    bool tryGetBounds(ModelHandle handle, glm::vec4& bounds) const;
+    // where the model's geometry lives in the pool it was loaded into; false if the model is not resident
+    bool tryGetGeometry(ModelHandle handle, GeometryAllocationId& allocation) const;
+
+    uint32_t getModelCount() const;
+    // changes whenever a model is removed, for anything that holds on to what a set of handles resolved to
+    uint64_t getRemovalCount() const { return removalCount.load(std::memory_order_acquire); }
+
+  private:
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    struct Slot {
+        uint32_t generation = 1;
+        uint32_t denseIndex = INVALID_INDEX;
+        bool reserved = false;
+    };
+
+    // called with mutex held
+    uint32_t allocateSlot();
+    void releaseSlot(uint32_t slot);
+    bool isCurrent(ModelHandle handle) const;
+    uint32_t denseIndex(ModelHandle handle) const;
+
+    EvilutionDeletionQueue& deletionQueue;
+
+    mutable std::shared_mutex mutex;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+
+    // dense, indexed by Slot::denseIndex
+    std::vector<glm::vec4> bounds;
+    std::vector<GeometryAllocationId> geometryAllocations;
+    // owners only, nothing on a per-frame path dereferences these
+    std::vector<std::shared_ptr<EvilutionModel>> models;
+    std::vector<uint32_t> slotOfModel;
+    std::atomic<uint64_t> removalCount{0};
+};
+
+} // namespace evilution
@@ -0,0 +1,65 @@
+#include "evilution_shader_module_cache.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace evilution {
+
+EvilutionShaderModuleCache::EvilutionShaderModuleCache(EvilutionDevice& device) : evilutionDevice{device} {}
+
+EvilutionShaderModuleCache::~EvilutionShaderModuleCache() {
+    for (auto& kv : modules) {
+        vkDestroyShaderModule(evilutionDevice.device(), kv.second.module, nullptr);
+    }
+}
+
+VkShaderModule EvilutionShaderModuleCache::acquire(const ShaderCode& shader) {
+    assert(shader.code != nullptr && shader.size % sizeof(uint32_t) == 0 && "Invalid SPIR-V code");
+
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = find(shader);
+    if (it == modules.end()) {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = shader.size;
+        createInfo.pCode = shader.code;
+
+        VkShaderModule module;
+        if (vkCreateShaderModule(evilutionDevice.device(), &createInfo, nullptr, &module) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shader module!");
+        }
+        it = modules.emplace(shader.hash, Entry{shader, module, 0});
+    }
+    it->second.refCount++;
+    return it->second.module;
+}
+
+void EvilutionShaderModuleCache::release(const ShaderCode& shader) {
+    std::lock_guard<std::mutex> lock{mutex};
+    auto it = find(shader);
+    assert(it != modules.end() && it->second.refCount > 0 && "Releasing a shader module that was not acquired");
+
+    if (--it->second.refCount == 0) {
+        vkDestroyShaderModule(evilutionDevice.device(), it->second.module, nullptr);
+        modules.erase(it);
+    }
+}
+
+std::unordered_multimap<uint64_t, EvilutionShaderModuleCache::Entry>::iterator EvilutionShaderModuleCache::find(
+    const ShaderCode& shader) {
+    auto range = modules.equal_range(shader.hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (shaderCodeEqual(it->second.shader, shader)) {
+            return it;
+        }
+    }
+    return modules.end();
+}
+
+size_t EvilutionShaderModuleCache::residentCount() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return modules.size();
+}
+
+} // namespace evilution
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "evilution_device.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace evilution {
+
+// A view of SPIR-V words that live elsewhere (usually the arrays embedded by evilution_shaders.hpp).
+struct ShaderCode {
+    const uint32_t* code = nullptr;
+    size_t size = 0; // in bytes, as VkShaderModuleCreateInfo::codeSize expects
+    uint64_t hash = 0;
+};
+
+// FNV-1a over the SPIR-V words, usable at compile time for the embedded shaders
+constexpr uint64_t hashShaderCode(const uint32_t* code, size_t wordCount) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < wordCount; i++) {
+        hash ^= code[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// the hash only rules out a match; equal hashes are confirmed word for word
+inline bool shaderCodeEqual(const ShaderCode& a, const ShaderCode& b) {
+    if (a.hash != b.hash || a.size != b.size) {
+        return false;
+    }
+    return a.code == b.code || std::memcmp(a.code, b.code, a.size) == 0;
+}
+
+template <size_t N> constexpr ShaderCode makeShaderCode(const uint32_t (&words)[N]) {
+    return ShaderCode{words, N * sizeof(uint32_t), hashShaderCode(words, N)};
+}
+
+// Shares VkShaderModules between pipelines by content, looked up by hash. Modules are only needed while pipelines
+// are being created, so a module is destroyed as soon as its last user releases it.
+class EvilutionShaderModuleCache {
+  public:
+    explicit EvilutionShaderModuleCache(EvilutionDevice& device);
+    ~EvilutionShaderModuleCache();
+
+    EvilutionShaderModuleCache(const EvilutionShaderModuleCache&) = delete;
+    EvilutionShaderModuleCache& operator=(const EvilutionShaderModuleCache&) = delete;
+
+    VkShaderModule acquire(const ShaderCode& shader);
+    void release(const ShaderCode& shader);
+
+    size_t residentCount() const;
+
+  private:
+    struct Entry {
+        ShaderCode shader;
+        VkShaderModule module = VK_NULL_HANDLE;
+        uint32_t refCount = 0;
+    };
+
+    // called with mutex held
+    std::unordered_multimap<uint64_t, Entry>::iterator find(const ShaderCode& shader);
+
+    EvilutionDevice& evilutionDevice;
+
+    mutable std::mutex mutex;
+    // a multimap since different code can share a hash
+    std::unordered_multimap<uint64_t, Entry> modules;
+};
+
+// Releases one acquire() on scope exit unless ownership was handed on with dismiss(), so a throwing acquire of a
+// later shader cannot leak the references taken before it.
+class ScopedShaderModule {
+  public:
+    ScopedShaderModule(EvilutionShaderModuleCache& cache, const ShaderCode& shader)
+        : cache{cache}, shader{shader}, module{cache.acquire(shader)} {}
+    ~ScopedShaderModule() {
+        if (owned) {
+            cache.release(shader);
+        }
+    }
+
+    ScopedShaderModule(const ScopedShaderModule&) = delete;
+    ScopedShaderModule& operator=(const ScopedShaderModule&) = delete;
+
+    VkShaderModule get() const { return module; }
+    // keeps the reference acquired; the caller now owes the matching release()
+    void dismiss() { owned = false; }
+
+  private:
+    EvilutionShaderModuleCache& cache;
+    ShaderCode shader;
+    VkShaderModule module;
+    bool owned = true;
+};
+} // namespace evilution
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "evilution_shader_module_cache.hpp"
+
+// std
+#include <cstdint>
+
+// The *.spv.inc files are generated by the build (glslc -mfmt=c) and hold each shader as a C initializer list,
+// so shaders ship inside the binary and nothing is read from disk at startup.
+namespace evilution {
+namespace shaders {
+
+inline constexpr uint32_t simpleShaderVertSpv[] =
+#include "shaders/simple_shader.vert.spv.inc"
+    ;
+inline constexpr uint32_t simpleShaderFragSpv[] =
+#include "shaders/simple_shader.frag.spv.inc"
+    ;
+
+inline constexpr uint32_t meshletShaderVertSpv[] =
+#include "shaders/meshlet_shader.vert.spv.inc"
+    ;
+inline constexpr uint32_t meshletShaderPulledVertSpv[] =
+#include "shaders/meshlet_shader_pulled.vert.spv.inc"
+    ;
+inline constexpr uint32_t meshletShaderFragSpv[] =
+#include "shaders/meshlet_shader.frag.spv.inc"
+    ;
+inline constexpr uint32_t meshletCullCompSpv[] =
+#include "shaders/meshlet_cull.comp.spv.inc"
+    ;
+inline constexpr uint32_t depthPyramidCompSpv[] =
+#include "shaders/depth_pyramid.comp.spv.inc"
+    ;
+inline constexpr uint32_t instanceTransformsCompSpv[] =
+#include "shaders/instance_transforms.comp.spv.inc"
+    ;
+
+inline constexpr ShaderCode simpleShaderVert = makeShaderCode(simpleShaderVertSpv);
+inline constexpr ShaderCode simpleShaderFrag = makeShaderCode(simpleShaderFragSpv);
+inline constexpr ShaderCode meshletShaderVert = makeShaderCode(meshletShaderVertSpv);
+inline constexpr ShaderCode meshletShaderPulledVert = makeShaderCode(meshletShaderPulledVertSpv);
+inline constexpr ShaderCode meshletShaderFrag = makeShaderCode(meshletShaderFragSpv);
+inline constexpr ShaderCode meshletCullComp = makeShaderCode(meshletCullCompSpv);
+inline constexpr ShaderCode depthPyramidComp = makeShaderCode(depthPyramidCompSpv);
+inline constexpr ShaderCode instanceTransformsComp = makeShaderCode(instanceTransformsCompSpv);
+
+} // namespace shaders
+} // namespace evilution
@@ -0,0 +1,82 @@
+#include "evilution_static_draw_set.hpp"
+
+namespace evilution {
+
+EvilutionStaticDrawSet::EvilutionStaticDrawSet(entt::registry& registry, EvilutionResourceRegistry& resourceRegistry)
+    : registry{registry}, evilutionResourceRegistry{resourceRegistry} {
+    registry.on_construct<StaticComponent>().connect<&EvilutionStaticDrawSet::onStaticChanged>(*this);
+    registry.on_update<StaticComponent>().connect<&EvilutionStaticDrawSet::onStaticChanged>(*this);
+    registry.on_destroy<StaticComponent>().connect<&EvilutionStaticDrawSet::onStaticChanged>(*this);
+    registry.on_construct<TransformComponent>().connect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_update<TransformComponent>().connect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_destroy<TransformComponent>().connect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_construct<RenderComponent>().connect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_update<RenderComponent>().connect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_destroy<RenderComponent>().connect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_construct<StreamedModelComponent>().connect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_destroy<StreamedModelComponent>().connect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+}
+
+EvilutionStaticDrawSet::~EvilutionStaticDrawSet() {
+    registry.on_construct<StaticComponent>().disconnect<&EvilutionStaticDrawSet::onStaticChanged>(*this);
+    registry.on_update<StaticComponent>().disconnect<&EvilutionStaticDrawSet::onStaticChanged>(*this);
+    registry.on_destroy<StaticComponent>().disconnect<&EvilutionStaticDrawSet::onStaticChanged>(*this);
+    registry.on_construct<TransformComponent>().disconnect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_update<TransformComponent>().disconnect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_destroy<TransformComponent>().disconnect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_construct<RenderComponent>().disconnect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_update<RenderComponent>().disconnect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_destroy<RenderComponent>().disconnect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_construct<StreamedModelComponent>().disconnect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+    registry.on_destroy<StreamedModelComponent>().disconnect<&EvilutionStaticDrawSet::onMemberChanged>(*this);
+}
+
+void EvilutionStaticDrawSet::onStaticChanged(entt::registry&, entt::entity) { version++; }
+
+void EvilutionStaticDrawSet::onMemberChanged(entt::registry& registry, entt::entity entity) {
+    // the signals fire for every entity, most of which are not static
+    if (registry.all_of<StaticComponent>(entity)) {
+        version++;
+    }
+}
+
+void EvilutionStaticDrawSet::detectChanges(entt::registry& registry) {
+    // a rebuild is due already, and members may have been destroyed since the last one
+    if (version != builtVersion) {
+        return;
+    }
+    for (const BuiltMember& member : builtMembers) {
+        const TransformComponent& transform = registry.get<TransformComponent>(member.entity);
+        if (transform.translation != member.transform.translation || transform.scale != member.transform.scale ||
+            transform.rotation != member.transform.rotation ||
+            !(registry.get<RenderComponent>(member.entity).model == member.model)) {
+            version++;
+            return;
+        }
+    }
+}
+
+void EvilutionStaticDrawSet::build(entt::registry& registry, std::vector<RenderObject>& objects) {
+    objects.clear();
+    builtMembers.clear();
+    builtVersion = version;
+    bool complete = true;
+    auto statics = registry.view<StaticComponent, TransformComponent, RenderComponent>(
+        entt::exclude<StreamedModelComponent>);
+    for (entt::entity entity : statics) {
+        TransformComponent& transform = statics.get<TransformComponent>(entity);
+        const RenderComponent& render = statics.get<RenderComponent>(entity);
+        if (!evilutionResourceRegistry.isValid(render.model)) {
+            complete = false;
+            continue;
+        }
+        objects.push_back({render.model, transform.mat4(), transform.normalMatrix(), static_cast<uint32_t>(entity),
+                           registry.get<InstanceSlotComponent>(entity).slot, true});
+        builtMembers.push_back({entity, transform, render.model});
+    }
+    if (!complete) {
+        version++;
+    }
+}
+
+} // namespace evilution
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "evilution_components.hpp"
+#include "evilution_render_snapshot.hpp"
+#include "evilution_resource_registry.hpp"
+
+#include <entt/entt.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace evilution {
+
+// Tracks which entities are drawn as static content: every entity with a StaticComponent, a TransformComponent and
+// a RenderComponent but no StreamedModelComponent. The version changes whenever that set or one of its members
+// changes, which renderers use to tell when their recorded static draws are out of date. Membership changes are
+// seen through registry signals; transforms and models are also compared against the last build by
+// detectChanges(), since most writes go through registry.get<>() and emit none. Runs on the simulation thread.
+class EvilutionStaticDrawSet {
+  public:
+    EvilutionStaticDrawSet(entt::registry& registry, EvilutionResourceRegistry& resourceRegistry);
+    ~EvilutionStaticDrawSet();
+
+    EvilutionStaticDrawSet(const EvilutionStaticDrawSet&) = delete;
+    EvilutionStaticDrawSet& operator=(const EvilutionStaticDrawSet&) = delete;
+
+    static bool isStatic(const entt::registry& registry, entt::entity entity) {
+        return registry.all_of<StaticComponent>(entity) && !registry.all_of<StreamedModelComponent>(entity);
+    }
+
+    // Changes the version when a member's transform or model differs from what the last build saw. Once per
+    // snapshot, before getVersion().
+    void detectChanges(entt::registry& registry);
+    // never 0, so a snapshot that was never built is always out of date
+    uint64_t getVersion() const { return version; }
+    // Replaces objects with the static entities whose model is resident. A model that is still loading is left
+    // out and changes the version, so the set is built again until everything is in.
+    void build(entt::registry& registry, std::vector<RenderObject>& objects);
+
+  private:
+    void onStaticChanged(entt::registry& registry, entt::entity entity);
+    void onMemberChanged(entt::registry& registry, entt::entity entity);
+
+    // what build() recorded each member with
+    struct BuiltMember {
+        entt::entity entity;
+        TransformComponent transform;
+        ModelHandle model;
+    };
+
+    entt::registry& registry;
+    EvilutionResourceRegistry& evilutionResourceRegistry;
+    uint64_t version = 1;
+    // the version builtMembers were taken at
+    uint64_t builtVersion = 0;
+    std::vector<BuiltMember> builtMembers;
+};
+
+} // namespace evilution
@@ -0,0 +1,11 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+namespace evilution {
+
+// a model added to an EvilutionGeometryStreamer, which components can refer to without depending on the streamer
+using StreamedModelId = uint32_t;
+
+} // namespace evilution
@@ -1,7 +1,9 @@
 #include "evilution_swap_chain.hpp"
 
 // std
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -10,29 +12,52 @@
 
 namespace evilution {
 
-EvilutionSwapChain::EvilutionSwapChain(EvilutionDevice& deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+EvilutionSwapChain::EvilutionSwapChain(EvilutionDevice& deviceRef, VkExtent2D extent,
+                                       const SwapChainSettings& settings)
+    : device{deviceRef}, windowExtent{extent}, settings{settings} {
     init();
 }
 
 EvilutionSwapChain::EvilutionSwapChain(EvilutionDevice& deviceRef, VkExtent2D extent,
-                                       std::shared_ptr<EvilutionSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+                                       const SwapChainSettings& settings, std::shared_ptr<EvilutionSwapChain> previous)
+    : device{deviceRef}, windowExtent{extent}, settings{settings}, oldSwapChain{previous} {
     init();
 
-    // cleanup old swap chain since it's no longer needed
+    // the caller retires the old swap chain once the frames that used it have completed
     oldSwapChain = nullptr;
 }
 
 void EvilutionSwapChain::init() {
+    assert(settings.framesInFlight >= 1 && settings.framesInFlight <= MAX_FRAMES_IN_FLIGHT &&
+           "framesInFlight must be between 1 and MAX_FRAMES_IN_FLIGHT");
+    dynamicRendering = settings.dynamicRendering && device.dynamicRenderingSupported();
     createSwapChain();
     createImageViews();
-    createRenderPass();
-    createDepthResources();
-    createFramebuffers();
+    if (!dynamicRendering) {
+        createRenderPass();
+    }
+    // the format is still reported so callers can create matching depth images of their own
+    swapChainDepthFormat = findDepthFormat();
+    if (!dynamicRendering || settings.depthImages) {
+        createDepthResources();
+    }
+    if (!dynamicRendering) {
+        createFramebuffers();
+    }
     createSyncObjects();
 }
 
+RenderTargetInfo EvilutionSwapChain::getRenderTargetInfo() const {
+    RenderTargetInfo info{};
+    if (dynamicRendering) {
+        info.colorAttachmentFormats = {swapChainImageFormat};
+        info.depthAttachmentFormat = swapChainDepthFormat;
+    } else {
+        info.renderPass = renderPass;
+    }
+    return info;
+}
+
 EvilutionSwapChain::~EvilutionSwapChain() {
     for (auto imageView : swapChainImageViews) {
         vkDestroyImageView(device.device(), imageView, nullptr);
@@ -54,31 +79,35 @@ EvilutionSwapChain::~EvilutionSwapChain() {
         vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
     }
 
+    // null when the render pass was handed on to a newer swap chain
     vkDestroyRenderPass(device.device(), renderPass, nullptr);
 
-    // cleanup synchronization objects
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    // cleanup synchronization objects, unless they were handed on as well
+    for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
         vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device.device(), inFlightFences[i], nullptr);
     }
 }
 
 VkResult EvilutionSwapChain::acquireNextImage(uint32_t* imageIndex) {
-    vkWaitForFences(device.device(), 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    auto blockStart = std::chrono::steady_clock::now();
+    device.timeline().wait(frameTimelineValues[currentFrame]);
 
     VkResult result = vkAcquireNextImageKHR(device.device(), swapChain, std::numeric_limits<uint64_t>::max(),
                                             imageAvailableSemaphores[currentFrame], // must be a not signaled semaphore
                                             VK_NULL_HANDLE, imageIndex);
+    blockedTime += std::chrono::steady_clock::now() - blockStart;
 
     return result;
 }
 
 VkResult EvilutionSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex) {
-    if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+    // the image may still be in use by a different frame slot when there are more images than frames in flight
+    if (!device.timeline().isComplete(imageTimelineValues[*imageIndex])) {
+        auto blockStart = std::chrono::steady_clock::now();
+        device.timeline().wait(imageTimelineValues[*imageIndex]);
+        blockedTime += std::chrono::steady_clock::now() - blockStart;
     }
-    imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
 
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -96,10 +125,9 @@ VkResult EvilutionSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer!");
-    }
+    uint64_t frameValue = device.timeline().submit(device.graphicsQueue(), submitInfo);
+    frameTimelineValues[currentFrame] = frameValue;
+    imageTimelineValues[*imageIndex] = frameValue;
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -113,18 +141,27 @@ VkResult EvilutionSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers
 
     presentInfo.pImageIndices = imageIndex;
 
-    auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+    // FIFO implementations may block inside present once the queue of pending images is full
+    auto blockStart = std::chrono::steady_clock::now();
+    auto result = device.timeline().present(device.presentQueue(), presentInfo);
+    blockedTime += std::chrono::steady_clock::now() - blockStart;
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % settings.framesInFlight;
 
     return result;
 }
 
+double EvilutionSwapChain::takeBlockedMilliseconds() {
+    double milliseconds = std::chrono::duration<double, std::milli>(blockedTime).count();
+    blockedTime = {};
+    return milliseconds;
+}
+
 void EvilutionSwapChain::createSwapChain() {
     SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -201,6 +238,15 @@ void EvilutionSwapChain::createImageViews() {
 }
 
 void EvilutionSwapChain::createRenderPass() {
+    // the render pass only depends on the formats, so a resize can keep using the previous one
+    if (oldSwapChain != nullptr && oldSwapChain->renderPass != VK_NULL_HANDLE &&
+        oldSwapChain->swapChainImageFormat == swapChainImageFormat &&
+        oldSwapChain->swapChainDepthFormat == findDepthFormat()) {
+        renderPass = oldSwapChain->renderPass;
+        oldSwapChain->renderPass = VK_NULL_HANDLE;
+        return;
+    }
+
     VkAttachmentDescription depthAttachment{};
     depthAttachment.format = findDepthFormat();
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -282,8 +328,7 @@ void EvilutionSwapChain::createFramebuffers() {
 }
 
 void EvilutionSwapChain::createDepthResources() {
-    VkFormat depthFormat = findDepthFormat();
-    swapChainDepthFormat = depthFormat;
+    VkFormat depthFormat = swapChainDepthFormat;
     VkExtent2D swapChainExtent = getSwapChainExtent();
 
     depthImages.resize(imageCount());
@@ -328,22 +373,40 @@ void EvilutionSwapChain::createDepthResources() {
 }
 
 void EvilutionSwapChain::createSyncObjects() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+    imageTimelineValues.resize(imageCount(), 0);
+
+    if (oldSwapChain != nullptr) {
+        // frame slots keep waiting on the old swap chain's submissions; their command buffers may still be in
+        // flight. New slots wait on everything the old swap chain submitted.
+        uint64_t newestValue = 0;
+        for (uint64_t value : oldSwapChain->frameTimelineValues) {
+            newestValue = std::max(newestValue, value);
+        }
+        frameTimelineValues.resize(settings.framesInFlight, newestValue);
+        for (size_t i = 0; i < settings.framesInFlight && i < oldSwapChain->frameTimelineValues.size(); i++) {
+            frameTimelineValues[i] = oldSwapChain->frameTimelineValues[i];
+        }
+
+        if (oldSwapChain->imageAvailableSemaphores.size() == settings.framesInFlight) {
+            imageAvailableSemaphores = std::move(oldSwapChain->imageAvailableSemaphores);
+            renderFinishedSemaphores = std::move(oldSwapChain->renderFinishedSemaphores);
+            oldSwapChain->imageAvailableSemaphores.clear();
+            oldSwapChain->renderFinishedSemaphores.clear();
+            return;
+        }
+    } else {
+        frameTimelineValues.resize(settings.framesInFlight, 0);
+    }
+
+    imageAvailableSemaphores.resize(settings.framesInFlight);
+    renderFinishedSemaphores.resize(settings.framesInFlight);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < settings.framesInFlight; i++) {
         if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+            vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
     }
@@ -363,23 +426,32 @@ EvilutionSwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR
 
 VkPresentModeKHR EvilutionSwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
     for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            std::cout << "Present mode: Mailbox" << std::endl;
+        if (availablePresentMode == settings.presentMode) {
+            std::cout << "Present mode: " << presentModeName(availablePresentMode) << std::endl;
             return availablePresentMode;
         }
     }
 
-    // for (const auto &availablePresentMode : availablePresentModes) {
-    //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-    //     std::cout << "Present mode: Immediate" << std::endl;
-    //     return availablePresentMode;
-    //   }
-    // }
-
-    std::cout << "Present mode: V-Sync" << std::endl;
+    std::cout << "Present mode " << presentModeName(settings.presentMode) << " unavailable, using "
+              << presentModeName(VK_PRESENT_MODE_FIFO_KHR) << std::endl;
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+const char* EvilutionSwapChain::presentModeName(VkPresentModeKHR presentMode) {
+    switch (presentMode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "Immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "Mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "V-Sync";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "Relaxed V-Sync";
+    default:
+        return "Unknown";
+    }
+}
+
 VkExtent2D EvilutionSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
         return capabilities.currentExtent;
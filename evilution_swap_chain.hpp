@@ -6,16 +6,36 @@
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <chrono>
 #include <memory>
 #include <vector>
 namespace evilution {
 
+struct SwapChainSettings {
+    // falls back to FIFO, which every implementation supports, when the requested mode is unavailable
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    uint32_t framesInFlight = 2;
+    // use VK_KHR_dynamic_rendering instead of a render pass and framebuffers; ignored when unsupported
+    bool dynamicRendering = true;
+    // false when the caller renders depth into images it owns, like a render graph's transient depth; only
+    // honoured with dynamic rendering, the render pass framebuffers always need them
+    bool depthImages = true;
+};
+
+// What a pipeline draws into: a render pass for the legacy path, attachment formats for dynamic rendering.
+struct RenderTargetInfo {
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    std::vector<VkFormat> colorAttachmentFormats;
+    VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+};
+
 class EvilutionSwapChain {
   public:
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    // upper bound for SwapChainSettings::framesInFlight; per-frame resources can be sized by this
+    static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
 
-    EvilutionSwapChain(EvilutionDevice& deviceRef, VkExtent2D windowExtent);
-    EvilutionSwapChain(EvilutionDevice& deviceRef, VkExtent2D windowExtent,
+    EvilutionSwapChain(EvilutionDevice& deviceRef, VkExtent2D windowExtent, const SwapChainSettings& settings);
+    EvilutionSwapChain(EvilutionDevice& deviceRef, VkExtent2D windowExtent, const SwapChainSettings& settings,
                        std::shared_ptr<EvilutionSwapChain> previous);
     ~EvilutionSwapChain();
 
@@ -23,13 +43,23 @@ class EvilutionSwapChain {
     EvilutionSwapChain& operator=(const EvilutionSwapChain&) = delete;
 
     VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
+    // VK_NULL_HANDLE when using dynamic rendering
     VkRenderPass getRenderPass() { return renderPass; }
+    VkImage getImage(int index) { return swapChainImages[index]; }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+    VkImage getDepthImage(int index) { return depthImages[index]; }
+    VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
+    VkFormat getSwapChainDepthFormat() { return swapChainDepthFormat; }
+    bool hasDepthImages() const { return !depthImages.empty(); }
+    bool usesDynamicRendering() const { return dynamicRendering; }
+    RenderTargetInfo getRenderTargetInfo() const;
     size_t imageCount() { return swapChainImages.size(); }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
     uint32_t width() { return swapChainExtent.width; }
     uint32_t height() { return swapChainExtent.height; }
+    VkPresentModeKHR getPresentMode() const { return presentMode; }
+    uint32_t getFramesInFlight() const { return settings.framesInFlight; }
 
     float extentAspectRatio() {
         return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
@@ -39,6 +69,11 @@ class EvilutionSwapChain {
     VkResult acquireNextImage(uint32_t* imageIndex);
     VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
 
+    // time the CPU spent waiting on earlier frames, acquire and present since the last call
+    double takeBlockedMilliseconds();
+
+    static const char* presentModeName(VkPresentModeKHR presentMode);
+
     bool compareSwapFormats(const EvilutionSwapChain& swapChain) const {
         return swapChain.swapChainDepthFormat == swapChainDepthFormat &&
                swapChain.swapChainImageFormat == swapChainImageFormat;
@@ -63,7 +98,7 @@ class EvilutionSwapChain {
     VkExtent2D swapChainExtent;
 
     std::vector<VkFramebuffer> swapChainFramebuffers;
-    VkRenderPass renderPass;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
 
     std::vector<VkImage> depthImages;
     std::vector<VkDeviceMemory> depthImageMemorys;
@@ -73,15 +108,21 @@ class EvilutionSwapChain {
 
     EvilutionDevice& device;
     VkExtent2D windowExtent;
+    SwapChainSettings settings;
+    VkPresentModeKHR presentMode;
+    bool dynamicRendering;
 
     VkSwapchainKHR swapChain;
     std::shared_ptr<EvilutionSwapChain> oldSwapChain;
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
+    // timeline values signalled by the last submission of each frame slot / swap chain image, 0 if none
+    std::vector<uint64_t> frameTimelineValues;
+    std::vector<uint64_t> imageTimelineValues;
     size_t currentFrame = 0;
+
+    std::chrono::steady_clock::duration blockedTime{};
 };
 
 } // namespace evilution
@@ -0,0 +1,167 @@
+#include "evilution_system_scheduler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iomanip>
+
+namespace evilution {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// weight of the newest sample in the running average
+constexpr double TIMING_SMOOTHING = 0.05;
+
+} // namespace
+
+EvilutionSystemScheduler::EvilutionSystemScheduler(EvilutionJobSystem& jobSystem) : jobSystem{jobSystem} {}
+
+SystemId EvilutionSystemScheduler::addSystem(const std::string& name, SystemFunction function) {
+    auto system = std::make_unique<System>();
+    system->name = name;
+    system->function = std::move(function);
+    system->timing.name = name;
+    systems.push_back(std::move(system));
+    dirty = true;
+    return static_cast<SystemId>(systems.size() - 1);
+}
+
+void EvilutionSystemScheduler::addAccess(SystemId system, std::type_index component, bool write,
+                                         StorageInitializer initializer) {
+    assert(system < systems.size() && "unknown system");
+    auto& accesses = systems[system]->accesses;
+    auto existing = std::find_if(accesses.begin(), accesses.end(),
+                                 [&component](const Access& access) { return access.component == component; });
+    if (existing != accesses.end()) {
+        existing->write = existing->write || write;
+    } else {
+        accesses.push_back({component, write});
+    }
+
+    if (std::find(storageInitializers.begin(), storageInitializers.end(), initializer) == storageInitializers.end()) {
+        storageInitializers.push_back(initializer);
+    }
+    dirty = true;
+}
+
+void EvilutionSystemScheduler::exclusive(SystemId system) {
+    assert(system < systems.size() && "unknown system");
+    systems[system]->exclusive = true;
+    dirty = true;
+}
+
+bool EvilutionSystemScheduler::conflicts(const System& first, const System& second) const {
+    if (first.exclusive || second.exclusive) {
+        return true;
+    }
+    for (const Access& a : first.accesses) {
+        for (const Access& b : second.accesses) {
+            if (a.component == b.component && (a.write || b.write)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void EvilutionSystemScheduler::buildGraph() {
+    rootSystems.clear();
+    for (auto& system : systems) {
+        system->dependents.clear();
+        system->dependencyCount = 0;
+    }
+
+    // An edge from every earlier conflicting system. Redundant transitive edges only cost a decrement each,
+    // which is cheaper than reducing the graph for the handful of systems a frame has.
+    for (SystemId later = 0; later < systems.size(); later++) {
+        for (SystemId earlier = 0; earlier < later; earlier++) {
+            if (conflicts(*systems[earlier], *systems[later])) {
+                systems[earlier]->dependents.push_back(later);
+                systems[later]->dependencyCount++;
+            }
+        }
+        if (systems[later]->dependencyCount == 0) {
+            rootSystems.push_back(later);
+        }
+    }
+    dirty = false;
+}
+
+void EvilutionSystemScheduler::run(entt::registry& registry, float dt) {
+    if (systems.empty()) {
+        return;
+    }
+    if (dirty) {
+        buildGraph();
+    }
+    for (StorageInitializer initializer : storageInitializers) {
+        initializer(registry);
+    }
+
+    auto frameStart = Clock::now();
+    for (auto& system : systems) {
+        system->remainingDependencies.store(system->dependencyCount, std::memory_order_relaxed);
+    }
+
+    EvilutionJobCounter frameCounter;
+    for (SystemId root : rootSystems) {
+        jobSystem.run([this, root, &registry, dt, &frameCounter] { runSystem(root, registry, dt, frameCounter); },
+                      &frameCounter);
+    }
+    jobSystem.wait(frameCounter);
+
+    lastFrameMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+}
+
+void EvilutionSystemScheduler::runSystem(SystemId id, entt::registry& registry, float dt,
+                                         EvilutionJobCounter& frameCounter) {
+    System& system = *systems[id];
+
+    auto start = Clock::now();
+    system.function(registry, dt);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    SystemTiming& timing = system.timing;
+    timing.lastMs = ms;
+    timing.averageMs = timing.runs == 0 ? ms : timing.averageMs + TIMING_SMOOTHING * (ms - timing.averageMs);
+    timing.maxMs = std::max(timing.maxMs, ms);
+    timing.runs++;
+
+    // queued before this job finishes, so the frame counter cannot reach zero in between
+    for (SystemId dependent : system.dependents) {
+        if (systems[dependent]->remainingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            jobSystem.run([this, dependent, &registry, dt, &frameCounter] {
+                runSystem(dependent, registry, dt, frameCounter);
+            }, &frameCounter);
+        }
+    }
+}
+
+std::vector<EvilutionSystemScheduler::SystemTiming> EvilutionSystemScheduler::getTimings() const {
+    std::vector<SystemTiming> timings;
+    timings.reserve(systems.size());
+    for (const auto& system : systems) {
+        timings.push_back(system->timing);
+    }
+    return timings;
+}
+
+void EvilutionSystemScheduler::printTimings(std::ostream& out) const {
+    double sumMs = 0.0;
+    out << "system timings (avg / max ms):" << std::endl;
+    for (const auto& system : systems) {
+        const SystemTiming& timing = system->timing;
+        sumMs += timing.lastMs;
+        out << "  " << std::left << std::setw(24) << timing.name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(9) << timing.averageMs << " / " << std::setw(9) << timing.maxMs << "  (" << timing.runs
+            << " runs, " << system->dependencyCount << " dependencies)" << std::endl;
+    }
+    // when systems overlap the frame is shorter than the sum of its systems
+    out << "  last frame " << lastFrameMs << " ms, systems " << sumMs << " ms" << std::endl;
+    out.unsetf(std::ios::fixed);
+}
+
+} // namespace evilution
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "evilution_job_system.hpp"
+
+#include <entt/entt.hpp>
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+namespace evilution {
+
+using SystemId = uint32_t;
+
+// Runs registry systems on the job system. Each system declares the components it reads and writes; two systems
+// conflict when one writes a component the other touches, and conflicting systems run in registration order.
+// Everything else runs concurrently. The dependency graph is rebuilt when systems or their access change.
+class EvilutionSystemScheduler {
+  public:
+    using SystemFunction = std::function<void(entt::registry&, float)>;
+
+    struct SystemTiming {
+        std::string name;
+        double lastMs = 0.0;
+        double averageMs = 0.0;
+        double maxMs = 0.0;
+        uint64_t runs = 0;
+    };
+
+    explicit EvilutionSystemScheduler(EvilutionJobSystem& jobSystem);
+
+    EvilutionSystemScheduler(const EvilutionSystemScheduler&) = delete;
+    EvilutionSystemScheduler& operator=(const EvilutionSystemScheduler&) = delete;
+
+    SystemId addSystem(const std::string& name, SystemFunction function);
+
+    // Any type can be listed, so shared state outside the registry can be given a tag type and declared the same
+    // way as a component.
+    template <typename... Components>
+    void reads(SystemId system) {
+        (addAccess(system, typeid(Components), false, &ensureStorage<Components>), ...);
+    }
+    template <typename... Components>
+    void writes(SystemId system) {
+        (addAccess(system, typeid(Components), true, &ensureStorage<Components>), ...);
+    }
+    // for systems that create or destroy entities or add and remove components; they run alone
+    void exclusive(SystemId system);
+
+    // runs every system once and returns when all have finished
+    void run(entt::registry& registry, float dt);
+
+    std::vector<SystemTiming> getTimings() const;
+    double getLastFrameMs() const { return lastFrameMs; }
+    void printTimings(std::ostream& out) const;
+
+  private:
+    struct Access {
+        std::type_index component;
+        bool write;
+    };
+
+    struct System {
+        std::string name;
+        SystemFunction function;
+        std::vector<Access> accesses;
+        bool exclusive = false;
+
+        // filled in by buildGraph()
+        std::vector<SystemId> dependents;
+        uint32_t dependencyCount = 0;
+        std::atomic<uint32_t> remainingDependencies{0};
+
+        SystemTiming timing;
+    };
+
+    using StorageInitializer = void (*)(entt::registry&);
+
+    // Views create a component's storage on first use, which is not safe from several threads at once, so the
+    // storage of every declared component is created before the systems start.
+    template <typename Component>
+    static void ensureStorage(entt::registry& registry) {
+        registry.view<Component>();
+    }
+
+    void addAccess(SystemId system, std::type_index component, bool write, StorageInitializer initializer);
+    bool conflicts(const System& first, const System& second) const;
+    void buildGraph();
+    void runSystem(SystemId id, entt::registry& registry, float dt, EvilutionJobCounter& frameCounter);
+
+    EvilutionJobSystem& jobSystem;
+    std::vector<std::unique_ptr<System>> systems;
+    std::vector<SystemId> rootSystems;
+    std::vector<StorageInitializer> storageInitializers;
+    bool dirty = true;
+    double lastFrameMs = 0.0;
+};
+
+} // namespace evilution
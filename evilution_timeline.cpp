@@ -0,0 +1,108 @@
+#include "evilution_timeline.hpp"
+
+// std
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace evilution {
+
+EvilutionTimeline::EvilutionTimeline(VkDevice device) : device{device} {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timelineSemaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+}
+
+EvilutionTimeline::~EvilutionTimeline() { vkDestroySemaphore(device, timelineSemaphore, nullptr); }
+
+uint64_t EvilutionTimeline::submit(VkQueue queue, const VkSubmitInfo& submitInfo) {
+    std::lock_guard<std::mutex> lock{submitMutex};
+    uint64_t value = submittedValue.load(std::memory_order_relaxed) + 1;
+
+    // binary semaphores ignore their value, but the counts have to line up
+    std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores,
+                                              submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+    signalSemaphores.push_back(timelineSemaphore);
+    std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+    signalValues.back() = value;
+    std::vector<uint64_t> waitValues(submitInfo.waitSemaphoreCount, 0);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.pNext = submitInfo.pNext;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VkSubmitInfo timelineSubmitInfo = submitInfo;
+    timelineSubmitInfo.pNext = &timelineInfo;
+    timelineSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    timelineSubmitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    if (vkQueueSubmit(queue, 1, &timelineSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit command buffer!");
+    }
+    submittedValue.store(value, std::memory_order_release);
+    return value;
+}
+
+VkResult EvilutionTimeline::present(VkQueue queue, const VkPresentInfoKHR& presentInfo) {
+    std::lock_guard<std::mutex> lock{submitMutex};
+    return vkQueuePresentKHR(queue, &presentInfo);
+}
+
+bool EvilutionTimeline::isComplete(uint64_t value) {
+    if (value <= cachedCompletedValue.load(std::memory_order_acquire)) {
+        return true;
+    }
+    return value <= completedValue();
+}
+
+uint64_t EvilutionTimeline::completedValue() {
+    uint64_t value = 0;
+    if (vkGetSemaphoreCounterValue(device, timelineSemaphore, &value) != VK_SUCCESS) {
+        throw std::runtime_error("failed to query timeline semaphore!");
+    }
+
+    advanceCachedValue(value);
+    return value;
+}
+
+void EvilutionTimeline::wait(uint64_t value) {
+    if (isComplete(value)) {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timelineSemaphore;
+    waitInfo.pValues = &value;
+
+    if (vkWaitSemaphores(device, &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to wait on timeline semaphore!");
+    }
+
+    advanceCachedValue(value);
+}
+
+void EvilutionTimeline::advanceCachedValue(uint64_t value) {
+    // several threads may refresh at once; never let the cache move backwards
+    uint64_t cached = cachedCompletedValue.load(std::memory_order_relaxed);
+    while (cached < value &&
+           !cachedCompletedValue.compare_exchange_weak(cached, value, std::memory_order_release,
+                                                       std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace evilution
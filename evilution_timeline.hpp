@@ -0,0 +1,51 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace evilution {
+
+// One timeline semaphore shared by every submission to the graphics queue. Each submit signals the next value,
+// so "has value N completed" answers whether everything submitted up to and including N has finished.
+class EvilutionTimeline {
+  public:
+    explicit EvilutionTimeline(VkDevice device);
+    ~EvilutionTimeline();
+
+    EvilutionTimeline(const EvilutionTimeline&) = delete;
+    EvilutionTimeline& operator=(const EvilutionTimeline&) = delete;
+
+    VkSemaphore semaphore() const { return timelineSemaphore; }
+
+    // Submits with the timeline appended to the signal semaphores and returns the value it will reach.
+    // Values are handed out and submitted under one lock so they reach the queue in increasing order.
+    uint64_t submit(VkQueue queue, const VkSubmitInfo& submitInfo);
+    // Presents under the same lock, since the present queue is usually the graphics queue and loader threads
+    // submit uploads to it while the render thread presents.
+    VkResult present(VkQueue queue, const VkPresentInfoKHR& presentInfo);
+
+    uint64_t lastSubmittedValue() const { return submittedValue.load(std::memory_order_acquire); }
+
+    // Answers from the cached counter when it can; otherwise refreshes it with a single counter query.
+    bool isComplete(uint64_t value);
+    // Queries the device and updates the cached counter.
+    uint64_t completedValue();
+    void wait(uint64_t value);
+
+  private:
+    void advanceCachedValue(uint64_t value);
+
+    VkDevice device;
+    VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+
+    std::mutex submitMutex;
+    std::atomic<uint64_t> submittedValue{0};
+    std::atomic<uint64_t> cachedCompletedValue{0};
+};
+
+} // namespace evilution
@@ -0,0 +1,41 @@
+#pragma once
+
+// std
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace evilution {
+
+// Single producer, single consumer hand-off of the latest value. The writer fills writeBuffer() and publishes it;
+// the reader picks up the newest published buffer and keeps it until it asks again. Neither side ever blocks or
+// sees a buffer the other is using, and buffers are reused so their allocations survive between frames.
+template <typename T>
+class EvilutionTripleBuffer {
+  public:
+    // writer side
+    T& writeBuffer() { return buffers[writeIndex]; }
+    void publish() { writeIndex = middle.exchange(writeIndex | NEW_DATA_BIT, std::memory_order_acq_rel) & INDEX_MASK; }
+
+    // Reader side. Returns false, and keeps the current read buffer, if nothing was published since the last call.
+    bool acquireLatest() {
+        if ((middle.load(std::memory_order_relaxed) & NEW_DATA_BIT) == 0) {
+            return false;
+        }
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+    const T& readBuffer() const { return buffers[readIndex]; }
+
+  private:
+    static constexpr uint32_t INDEX_MASK = 0x3;
+    static constexpr uint32_t NEW_DATA_BIT = 0x4;
+
+    std::array<T, 3> buffers{};
+    uint32_t writeIndex = 0;
+    // the buffer between the two sides, with NEW_DATA_BIT set when the writer put it there
+    std::atomic<uint32_t> middle{1};
+    uint32_t readIndex = 2;
+};
+
+} // namespace evilution
@@ -17,17 +17,23 @@ void EvilutionWindow::initWindow() {
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
-    window = glfwCreateWindow(width, height, windowName.c_str(), nullptr, nullptr);
+    window = glfwCreateWindow(width.load(), height.load(), windowName.c_str(), nullptr, nullptr);
+    registerCallbacks();
+}
+
+void EvilutionWindow::registerCallbacks() {
     glfwSetWindowUserPointer(window, this);
     glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+    glfwSetWindowRefreshCallback(window, refreshCallback);
+    glfwSetWindowFocusCallback(window, focusCallback);
+    glfwSetWindowIconifyCallback(window, iconifyCallback);
 }
 
 void EvilutionWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR* surface) {
     if (glfwCreateWindowSurface(instance, window, nullptr, surface) != VK_SUCCESS) {
         throw std::runtime_error("failed to create window surface!");
     }
-    glfwSetWindowUserPointer(window, this);
-    glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+    registerCallbacks();
 }
 
 void EvilutionWindow::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
@@ -35,5 +41,21 @@ void EvilutionWindow::framebufferResizeCallback(GLFWwindow* window, int width, i
     evilutionWindow->framebufferResized = true;
     evilutionWindow->width = width;
     evilutionWindow->height = height;
+    evilutionWindow->damaged = true;
+}
+
+void EvilutionWindow::refreshCallback(GLFWwindow* window) {
+    reinterpret_cast<EvilutionWindow*>(glfwGetWindowUserPointer(window))->damaged = true;
+}
+
+void EvilutionWindow::focusCallback(GLFWwindow* window, int) {
+    reinterpret_cast<EvilutionWindow*>(glfwGetWindowUserPointer(window))->damaged = true;
+}
+
+void EvilutionWindow::iconifyCallback(GLFWwindow* window, int iconified) {
+    // nothing is visible while minimized; restoring is what needs a frame
+    if (!iconified) {
+        reinterpret_cast<EvilutionWindow*>(glfwGetWindowUserPointer(window))->damaged = true;
+    }
 }
 } // namespace evilution
\ No newline at end of file
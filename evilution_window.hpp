@@ -6,6 +6,7 @@
 #include <GLFW/glfw3.h>
 
 //std
+#include <atomic>
 #include <string>
 
 namespace evilution {
@@ -23,17 +24,26 @@ class EvilutionWindow {
     VkExtent2D getExtent() { return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)}; }
     bool wasWindowResized() { return framebufferResized; }
     void resetWindowResizedFlag() { framebufferResized = false; }
+    // true once per change that needs the contents drawn again: shown, resized, uncovered or refocused
+    bool takeDamage() { return damaged.exchange(false); }
     GLFWwindow* getGLFWwindow() const { return window; }
 
     void createWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
 
   private:
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+    static void refreshCallback(GLFWwindow* window);
+    static void focusCallback(GLFWwindow* window, int focused);
+    static void iconifyCallback(GLFWwindow* window, int iconified);
+    void registerCallbacks();
     void initWindow();
 
-    int width;
-    int height;
-    bool framebufferResized = false;
+    // written by the resize callback on the main thread, read by the render thread
+    std::atomic<int> width;
+    std::atomic<int> height;
+    std::atomic<bool> framebufferResized{false};
+    // the first frame has never been drawn
+    std::atomic<bool> damaged{true};
 
     std::string windowName;
     GLFWwindow* window;
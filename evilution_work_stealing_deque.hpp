@@ -0,0 +1,118 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace evilution {
+
+// Chase-Lev deque of pointers with the memory orderings from Le et al., "Correct and Efficient Work-Stealing for
+// Weak Memory Models" (PPoPP 2013). The owning thread pushes and pops at the bottom without contention; any other
+// thread may steal from the top. The buffer grows when full and old buffers are kept until destruction, because a
+// thief may still be reading from one.
+template <typename T>
+class EvilutionWorkStealingDeque {
+  public:
+    explicit EvilutionWorkStealingDeque(int64_t initialCapacity = 1024) {
+        assert(initialCapacity > 0 && (initialCapacity & (initialCapacity - 1)) == 0 &&
+               "capacity must be a power of two");
+        buffers.push_back(std::make_unique<Buffer>(initialCapacity));
+        buffer.store(buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    EvilutionWorkStealingDeque(const EvilutionWorkStealingDeque&) = delete;
+    EvilutionWorkStealingDeque& operator=(const EvilutionWorkStealingDeque&) = delete;
+
+    // owner only
+    void push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Buffer* current = buffer.load(std::memory_order_relaxed);
+        if (b - t > current->capacity - 1) {
+            current = grow(current, t, b);
+        }
+        current->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // owner only; nullptr when empty or when a thief won the last item
+    T* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* current = buffer.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item = current->get(b);
+        if (t == b) {
+            // last item, race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // any thread; nullptr when empty or when it lost a race
+    T* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+
+        T* item = buffer.load(std::memory_order_acquire)->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Buffer {
+        explicit Buffer(int64_t capacity)
+            : capacity{capacity}, mask{capacity - 1}, slots{std::make_unique<std::atomic<T*>[]>(capacity)} {}
+
+        T* get(int64_t index) const { return slots[index & mask].load(std::memory_order_relaxed); }
+        void put(int64_t index, T* item) { slots[index & mask].store(item, std::memory_order_relaxed); }
+
+        int64_t capacity;
+        int64_t mask;
+        std::unique_ptr<std::atomic<T*>[]> slots;
+    };
+
+    Buffer* grow(Buffer* current, int64_t t, int64_t b) {
+        auto grown = std::make_unique<Buffer>(current->capacity * 2);
+        for (int64_t i = t; i < b; i++) {
+            grown->put(i, current->get(i));
+        }
+        buffers.push_back(std::move(grown));
+        Buffer* next = buffers.back().get();
+        buffer.store(next, std::memory_order_release);
+        return next;
+    }
+
+    // top and bottom on separate cache lines so thieves do not slow down the owner
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    alignas(64) std::atomic<Buffer*> buffer{nullptr};
+    // owner only
+    std::vector<std::unique_ptr<Buffer>> buffers;
+};
+
+} // namespace evilution
@@ -3,7 +3,6 @@
 #include "evilution_camera.hpp"
 #include "evilution_components.hpp"
 #include "evilution_model.hpp"
-#include "keyboard_movement_controller.hpp"
 #include "simple_render_system.hpp"
 
 
@@ -14,58 +13,496 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
 
 namespace evilution {
 
-FirstApp::FirstApp() { loadGameObjects(); }
+namespace {
+// whenever the swap chain uses dynamic rendering the frame goes through the render graph, which owns its depth
+SwapChainSettings withGraphOwnedDepth(SwapChainSettings settings) {
+    settings.depthImages = false;
+    return settings;
+}
+
+// a box behind the vase for the scene's bodies to bounce around in, +y being down
+const glm::vec3 BODY_BOX_MIN{-1.5f, -1.5f, 4.f};
+const glm::vec3 BODY_BOX_MAX{1.5f, 0.5f, 6.f};
+
+PhysicsSettings scenePhysicsSettings() {
+    PhysicsSettings settings{};
+    settings.gravity = {0.f, 9.8f, 0.f};
+    settings.restitution = 0.8f;
+    settings.useBounds = true;
+    settings.boundsMin = {BODY_BOX_MIN.x, BODY_BOX_MIN.y, BODY_BOX_MIN.z};
+    settings.boundsMax = {BODY_BOX_MAX.x, BODY_BOX_MAX.y, BODY_BOX_MAX.z};
+    return settings;
+}
+} // namespace
+
+FirstApp::FirstApp(const SwapChainSettings& swapChainSettings, double targetFrameRate,
+                   const RenderSettings& renderSettings)
+    : evilutionRenderer{evilutionWindow, evilutionDevice, withGraphOwnedDepth(swapChainSettings)},
+      evilutionFramePacer{targetFrameRate},
+      evilutionPhysicsSystem{evilutionJobSystem, evilutionRegistry, scenePhysicsSettings()},
+      evilutionInstanceTracker{evilutionRegistry, renderSettings.gpuTransforms}, renderSettings{renderSettings},
+      drawsMeshlets{evilutionRenderer.usesDynamicRendering() && MeshletRenderSystem::isSupported(evilutionDevice)} {
+    loadGameObjects();
+    registerSystems();
+}
 
 FirstApp::~FirstApp() {}
 
 void FirstApp::run() {
-    SimpleRenderSystem simpleRenderSystem{evilutionDevice, evilutionRenderer.getSwapChainRenderPass()};
-    EvilutionCamera camera{};
+    // the simulation reads this until the main thread publishes newer input
+    inputBuffer.writeBuffer().sample(evilutionWindow.getGLFWwindow());
+    inputBuffer.publish();
+
+    running = true;
+    std::thread simulationThread{&FirstApp::simulationLoop, this};
+    std::thread renderThread{&FirstApp::renderLoop, this};
+
+    // GLFW only allows event processing and polling on the main thread
+    std::bitset<GLFW_KEY_LAST + 1> lastKeys{};
+    while (running && !evilutionWindow.shouldClose()) {
+        // wakes as soon as input arrives; the timeout keeps held keys sampled when nothing new does. With nothing
+        // held, an on-demand loop has no reason to wake before the next event; stop() posts one.
+        bool keysHeld = lastKeys.any();
+        glfwWaitEventsTimeout(renderSettings.onDemand && !keysHeld ? ON_DEMAND_EVENT_TIMEOUT : 0.001);
+        InputState& input = inputBuffer.writeBuffer();
+        input.sample(evilutionWindow.getGLFWwindow());
+        if (renderSettings.onDemand) {
+            // a held key keeps moving the camera, and releasing one needs a frame to stop it
+            if (input.keys != lastKeys || input.keys.any() || evilutionWindow.takeDamage()) {
+                evilutionRedrawScheduler.invalidate(input.sampleTime);
+            } else {
+                evilutionRedrawScheduler.markIdleWakeup();
+            }
+        }
+        lastKeys = input.keys;
+        inputBuffer.publish();
+    }
+
+    stop();
+    simulationThread.join();
+    renderThread.join();
+    if (threadError) {
+        std::rethrow_exception(threadError);
+    }
+
+    evilutionRenderer.getFrameMetrics().printReport(std::cout);
+    evilutionFramePacer.printStats(std::cout);
+    evilutionSystemScheduler.printTimings(std::cout);
+    drawStats.print(std::cout);
+    staticDrawStats.print(std::cout);
+    if (hasMeshletStats) {
+        meshletStats.print(std::cout);
+    }
+    instanceStats.print(std::cout);
+    if (hasRenderGraphStats) {
+        renderGraphStats.print(std::cout);
+    }
+    if (renderSettings.onDemand) {
+        evilutionRedrawScheduler.printStats(std::cout);
+    }
+    evilutionAssetCache.printStats(std::cout);
+    evilutionGeometryStreamer.printStats(std::cout);
+}
+
+void FirstApp::stop(std::exception_ptr error) {
+    {
+        std::lock_guard<std::mutex> lock{frameMutex};
+        if (error && !threadError) {
+            threadError = error;
+        }
+        running = false;
+    }
+    frameCondition.notify_all();
+    evilutionRedrawScheduler.stop();
+    // the main thread may be waiting for events with a long timeout
+    glfwPostEmptyEvent();
+}
 
-    auto cameraTransform = TransformComponent{};
-    KeyboardMovementController cameraController{};
+void FirstApp::registerSystems() {
+    auto cameraControl =
+        evilutionSystemScheduler.addSystem("cameraController", [this](entt::registry& registry, float dt) {
+            auto view = registry.view<CameraComponent, TransformComponent>();
+            for (entt::entity entity : view) {
+                cameraController.moveInPlaneXZ(simulationInput, dt, view.get<TransformComponent>(entity));
+            }
+        });
+    evilutionSystemScheduler.reads<InputState, CameraComponent>(cameraControl);
+    evilutionSystemScheduler.writes<TransformComponent>(cameraControl);
 
-    auto currentTime = std::chrono::high_resolution_clock::now();
+    // runs after the camera controller, which also writes transforms, and before the snapshot reads them
+    auto physics = evilutionSystemScheduler.addSystem("physics", [this](entt::registry& registry, float dt) {
+        evilutionPhysicsSystem.update(registry, dt);
+    });
+    evilutionSystemScheduler.writes<TransformComponent, RigidBodyComponent, RigidBody2dComponent>(physics);
+
+    auto renderSnapshot = evilutionSystemScheduler.addSystem("renderSnapshot", [this](entt::registry& registry, float) {
+        buildRenderSnapshot(registry, snapshotBuffer.writeBuffer());
+        // after selection, so loads and evictions follow what this snapshot draws
+        evilutionGeometryStreamer.update();
+    });
+    evilutionSystemScheduler
+        .reads<InputState, CameraComponent, TransformComponent, RenderComponent, StreamedModelComponent,
+               StaticComponent>(renderSnapshot);
+    evilutionSystemScheduler.writes<RenderSnapshot, InstanceSlotComponent>(renderSnapshot);
+}
+
+void FirstApp::buildRenderSnapshot(entt::registry& registry, RenderSnapshot& snapshot) {
+    snapshot.frameNumber = simulationFrame;
+    snapshot.inputSampleTime = simulationInput.sampleTime;
+    snapshot.wakeTime = simulationWakeTime;
+
+    // the framebuffer matches the swap chain extent, which the render thread owns
+    VkExtent2D extent = evilutionWindow.getExtent();
+    float aspect = extent.height > 0 ? static_cast<float>(extent.width) / static_cast<float>(extent.height) : 1.f;
+
+    float cameraNear = 0.f;
+    float cameraFar = 1.f;
+    // turns a bounding radius over view distance into a fraction of half the viewport height
+    float projectionScale = 1.f;
+    auto cameras = registry.view<CameraComponent, TransformComponent>();
+    for (entt::entity entity : cameras) {
+        const CameraComponent& camera = cameras.get<CameraComponent>(entity);
+        const TransformComponent& cameraTransform = cameras.get<TransformComponent>(entity);
+        snapshot.camera.setViewYXZ(cameraTransform.translation, cameraTransform.rotation);
+        snapshot.camera.setPerspectiveProjection(camera.fovY, aspect, camera.nearPlane, camera.farPlane);
+        cameraNear = camera.nearPlane;
+        cameraFar = camera.farPlane;
+        projectionScale = 1.f / std::tan(camera.fovY * .5f);
+        break;
+    }
 
-    while (!evilutionWindow.shouldClose()) {
-        glfwPollEvents();
+    auto frustumPlanes = snapshot.camera.getFrustumPlanes();
+    const glm::mat4& view = snapshot.camera.getView();
+    float depthRange = std::max(cameraFar - cameraNear, 1e-6f);
+    snapshot.objects.clear();
+    snapshot.drawOrder.clear();
+    snapshot.instanceUpdates.clear();
+    snapshot.transformUpdates.clear();
+    evilutionInstanceTracker.update(registry, snapshot.instanceUpdates, snapshot.transformUpdates);
+    snapshot.instanceCount = evilutionInstanceTracker.getSlotCount();
+    // after the instance tracker, which gives new static entities their slot
+    evilutionStaticDrawSet.detectChanges(registry);
+    uint64_t staticVersion = evilutionStaticDrawSet.getVersion();
+    if (snapshot.staticVersion != staticVersion) {
+        evilutionStaticDrawSet.build(registry, snapshot.staticObjects);
+        snapshot.staticVersion = staticVersion;
+    }
+    auto renderables = registry.view<TransformComponent, RenderComponent>();
+    for (entt::entity entity : renderables) {
+        TransformComponent& transform = renderables.get<TransformComponent>(entity);
+        RenderComponent& render = renderables.get<RenderComponent>(entity);
 
-        auto newTime = std::chrono::high_resolution_clock::now();
-        float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
-        currentTime = newTime;
+        const StreamedModelComponent* streamed = registry.try_get<StreamedModelComponent>(entity);
 
-        cameraController.moveInPlaneXZ(evilutionWindow.getGLFWwindow(), frameTime, cameraTransform);
-        camera.setViewYXZ(cameraTransform.translation, cameraTransform.rotation);
+        // still loading; drawn from the first snapshot after it becomes resident
+        glm::vec4 bounds;
+        bool resident = streamed != nullptr ? evilutionGeometryStreamer.tryGetBounds(streamed->model, bounds)
+                                            : evilutionResourceRegistry.tryGetBounds(render.model, bounds);
+        if (!resident) {
+            continue;
+        }
+        // Culled with a sphere around the translation that holds the bounds however they are rotated, so no
+        // matrix is built for objects that turn out not to be visible, nor at all when meshlets are drawn.
+        float scale =
+            std::max({std::abs(transform.scale.x), std::abs(transform.scale.y), std::abs(transform.scale.z)});
+        float radius = bounds.w * scale;
+        float cullRadius = radius + glm::length(glm::vec3(bounds)) * scale;
+        if (!EvilutionCamera::isSphereInFrustum(frustumPlanes, transform.translation, cullRadius)) {
+            continue;
+        }
 
-        float aspect = evilutionRenderer.getAspectRatio();
-        camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 10.f);
+        float viewDepth = (view * glm::vec4(transform.translation, 1.f)).z;
+        ModelHandle model = render.model;
+        if (streamed != nullptr) {
+            float screenSize = viewDepth > radius ? radius * projectionScale / viewDepth : 1.f;
+            model = evilutionGeometryStreamer.selectLevel(streamed->model, screenSize);
+            if (model.isNull()) {
+                continue;
+            }
+        }
 
-        if (auto commandBuffer = evilutionRenderer.beginFrame()) {
-            evilutionRenderer.beginSwapChainRenderPass(commandBuffer);
-            simpleRenderSystem.renderGameObjects(commandBuffer, evilutionRegistry, camera);
-            evilutionRenderer.endSwapChainRenderPass(commandBuffer);
-            evilutionRenderer.endFrame();
+        // every object is drawn with SimpleRenderSystem's pipeline, so the pipeline bits are all 0 for now
+        float depth = (viewDepth - cameraNear) / depthRange;
+        snapshot.drawOrder.push_back(
+            {makeDrawSortKey(0, model, depth), static_cast<uint32_t>(snapshot.objects.size())});
+        RenderObject object{};
+        object.model = model;
+        if (!drawsMeshlets) {
+            object.transform = transform.mat4();
+            object.normalMatrix = transform.normalMatrix();
         }
+        object.id = static_cast<uint32_t>(entity);
+        object.instance = registry.get<InstanceSlotComponent>(entity).slot;
+        object.isStatic = EvilutionStaticDrawSet::isStatic(registry, entity);
+        snapshot.objects.push_back(object);
     }
+    radixSortDrawItems(snapshot.drawOrder, drawSortScratch);
+}
 
-    vkDeviceWaitIdle(evilutionDevice.device());
+bool FirstApp::needsAnotherFrame(const RenderSnapshot& snapshot) {
+    glm::mat4 projectionView = snapshot.camera.getProjection() * snapshot.camera.getView();
+    bool cameraMoved = projectionView != lastProjectionView;
+    bool objectsChanged = snapshot.objects.size() != lastObjectCount;
+    lastProjectionView = projectionView;
+    lastObjectCount = snapshot.objects.size();
+
+    // transform changes cover physics and anything else animating a renderable, visible or not
+    return cameraMoved || objectsChanged || !snapshot.instanceUpdates.empty() || !snapshot.transformUpdates.empty() ||
+           evilutionAssetCache.getStats().loadingModels > 0;
+}
+
+void FirstApp::simulationLoop() {
+    try {
+        // the scheduler waits on its jobs from here, so this thread has to be the worker that helps run them
+        evilutionJobSystem.adoptCallingThread();
+        auto currentTime = std::chrono::high_resolution_clock::now();
+        float lastFrameTime = 1.f / 60.f;
+
+        while (running) {
+            simulationWakeTime = {};
+            if (renderSettings.onDemand && !evilutionRedrawScheduler.waitForFrame(simulationWakeTime)) {
+                break;
+            }
+            // a load finishing during the step is only drawn if another step follows it
+            bool wasLoading = renderSettings.onDemand && evilutionAssetCache.getStats().loadingModels > 0;
+
+            inputBuffer.acquireLatest();
+            simulationInput = inputBuffer.readBuffer();
+
+            auto newTime = std::chrono::high_resolution_clock::now();
+            float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
+            currentTime = newTime;
+            // time spent idle was not simulated, so the step after it is as long as the one before
+            if (simulationWakeTime != EvilutionRedrawScheduler::Clock::time_point{}) {
+                frameTime = lastFrameTime;
+            }
+            lastFrameTime = frameTime;
+
+            simulationFrame++;
+            evilutionSystemScheduler.run(evilutionRegistry, frameTime);
+            if (renderSettings.onDemand && (needsAnotherFrame(snapshotBuffer.writeBuffer()) || wasLoading)) {
+                evilutionRedrawScheduler.invalidate();
+            }
+            snapshotBuffer.publish();
+
+            std::unique_lock<std::mutex> lock{frameMutex};
+            publishedSnapshot = simulationFrame;
+            frameCondition.notify_all();
+            // run at most one frame ahead: the next frame is simulated while this one is recorded and submitted
+            frameCondition.wait(lock, [&] { return !running || consumedSnapshot >= simulationFrame; });
+        }
+    } catch (...) {
+        stop(std::current_exception());
+    }
+}
+
+bool FirstApp::acquireSnapshot() {
+    std::unique_lock<std::mutex> lock{frameMutex};
+    frameCondition.wait(lock, [this] { return !running || publishedSnapshot > consumedSnapshot; });
+    if (!running) {
+        return false;
+    }
+
+    snapshotBuffer.acquireLatest();
+    consumedSnapshot = snapshotBuffer.readBuffer().frameNumber;
+    lock.unlock();
+    frameCondition.notify_all();
+    return true;
+}
+
+void FirstApp::renderLoop() {
+    try {
+        SimpleRenderSystem simpleRenderSystem{evilutionDevice, evilutionPipelineManager, evilutionResourceRegistry,
+                                              evilutionGeometryPool, evilutionRenderer.getSwapChainRenderTargetInfo(),
+                                              EvilutionSwapChain::MAX_FRAMES_IN_FLIGHT};
+        const RenderSnapshot* snapshot = nullptr;
+        // every renderable entity's transform, uploaded only where it changed
+        EvilutionInstanceBuffer instanceBuffer{evilutionDevice, evilutionPipelineManager,
+                                               EvilutionSwapChain::MAX_FRAMES_IN_FLIGHT, renderSettings.gpuTransforms};
+        // culls and draws per meshlet when the device can; declared first so it outlives the passes using it
+        std::unique_ptr<MeshletRenderSystem> meshletRenderSystem;
+
+        // with dynamic rendering the frame is described as a graph; the legacy render pass is the fallback
+        EvilutionRenderGraph renderGraph{evilutionDevice};
+        bool useRenderGraph = evilutionRenderer.usesDynamicRendering();
+        if (useRenderGraph) {
+            RenderTargetInfo swapChainTarget = evilutionRenderer.getSwapChainRenderTargetInfo();
+            auto backbuffer = renderGraph.importBackbuffer(swapChainTarget.colorAttachmentFormats[0]);
+            auto depth = renderGraph.createImage("depth", swapChainTarget.depthAttachmentFormat);
+
+            if (drawsMeshlets) {
+                // sized for the most frames the swap chain can ever keep in flight, so recreation never outgrows it
+                meshletRenderSystem = std::make_unique<MeshletRenderSystem>(
+                    evilutionDevice, evilutionPipelineManager, evilutionResourceRegistry, evilutionGeometryPool,
+                    instanceBuffer, swapChainTarget, EvilutionSwapChain::MAX_FRAMES_IN_FLIGHT, renderSettings.meshlets);
+                MeshletRenderSystem& meshlets = *meshletRenderSystem;
+
+                // compute passes have nothing the graph can see them contribute to, so they are kept explicitly
+                auto cullEarlyPass = renderGraph.addPass("cullEarly", [&, depth](VkCommandBuffer commandBuffer) {
+                    meshlets.cullEarly(commandBuffer, renderGraph.getImageExtent(depth));
+                });
+                renderGraph.setSideEffects(cullEarlyPass);
+
+                auto forwardEarlyPass = renderGraph.addPass(
+                    "forwardEarly", [&](VkCommandBuffer commandBuffer) { meshlets.renderEarly(commandBuffer); });
+                renderGraph.writeColor(forwardEarlyPass, backbuffer, {{0.01f, 0.01f, 0.01f, 1.0f}});
+                renderGraph.writeDepth(forwardEarlyPass, depth, 1.0f);
+
+                auto pyramidPass = renderGraph.addPass("depthPyramid", [&, depth](VkCommandBuffer commandBuffer) {
+                    meshlets.buildDepthPyramid(commandBuffer, renderGraph.getImageView(depth),
+                                               renderGraph.getImageExtent(depth));
+                });
+                renderGraph.readTexture(pyramidPass, depth, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+                renderGraph.setSideEffects(pyramidPass);
+
+                auto cullLatePass = renderGraph.addPass(
+                    "cullLate", [&](VkCommandBuffer commandBuffer) { meshlets.cullLate(commandBuffer); });
+                renderGraph.setSideEffects(cullLatePass);
+
+                // loads what the early pass drew
+                auto forwardLatePass = renderGraph.addPass(
+                    "forwardLate", [&](VkCommandBuffer commandBuffer) { meshlets.renderLate(commandBuffer); });
+                renderGraph.writeColor(forwardLatePass, backbuffer);
+                renderGraph.writeDepth(forwardLatePass, depth);
+            } else {
+                auto forwardPass = renderGraph.addPass("forward", [&, swapChainTarget](VkCommandBuffer commandBuffer) {
+                    simpleRenderSystem.renderGameObjects(commandBuffer, *snapshot, evilutionRenderer.getFrameIndex(),
+                                                         swapChainTarget, evilutionRenderer.getSwapChainExtent());
+                });
+                renderGraph.writeColor(forwardPass, backbuffer, {{0.01f, 0.01f, 0.01f, 1.0f}});
+                renderGraph.writeDepth(forwardPass, depth, 1.0f);
+                renderGraph.setSecondaryCommandBuffers(forwardPass);
+            }
+        }
+
+        while (true) {
+            // wait before taking a snapshot so the frame is built from the freshest simulation
+            evilutionFramePacer.waitForNextFrame();
+            if (!acquireSnapshot()) {
+                break;
+            }
+            snapshot = &snapshotBuffer.readBuffer();
+            bool wokeFromIdle = snapshot->wakeTime != EvilutionRedrawScheduler::Clock::time_point{};
+            if (wokeFromIdle) {
+                evilutionFramePacer.resumeAfterIdle();
+            }
+            evilutionRenderer.markInputSampled(snapshot->inputSampleTime);
+            // queued even when no frame gets drawn, so the next one that is still sees the change
+            if (renderSettings.gpuTransforms) {
+                instanceBuffer.queueTransformUpdates(snapshot->transformUpdates, snapshot->instanceCount);
+            } else {
+                instanceBuffer.queueUpdates(snapshot->instanceUpdates, snapshot->instanceCount);
+            }
+
+            // a variant that finishes compiling during the frame still has to be drawn once
+            bool redrawAgain = renderSettings.onDemand && evilutionPipelineManager.pendingCount() > 0;
+
+            if (auto commandBuffer = evilutionRenderer.beginFrame()) {
+                instanceBuffer.flush(commandBuffer, evilutionRenderer.getFrameIndex());
+                if (useRenderGraph) {
+                    if (meshletRenderSystem) {
+                        meshletRenderSystem->prepareFrame(evilutionRenderer.getFrameIndex(), *snapshot);
+                    }
+                    evilutionRenderer.executeRenderGraph(commandBuffer, renderGraph);
+                } else {
+                    evilutionRenderer.beginSwapChainRenderPass(commandBuffer,
+                                                               VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                    // the render pass is replaced when the swap chain is recreated
+                    simpleRenderSystem.renderGameObjects(commandBuffer, *snapshot, evilutionRenderer.getFrameIndex(),
+                                                         evilutionRenderer.getSwapChainRenderTargetInfo(),
+                                                         evilutionRenderer.getSwapChainExtent());
+                    evilutionRenderer.endSwapChainRenderPass(commandBuffer);
+                }
+                evilutionRenderer.endFrame();
+                evilutionFramePacer.markPresented();
+                if (wokeFromIdle) {
+                    evilutionRedrawScheduler.markWakePresented(snapshot->wakeTime);
+                }
+            } else if (renderSettings.onDemand) {
+                // the swap chain was recreated instead; the frame still has to be shown
+                redrawAgain = true;
+            }
+            if (redrawAgain) {
+                evilutionRedrawScheduler.invalidate();
+            }
+
+            // between frames, so no command buffer is half recorded against the old layout
+            if (evilutionGeometryPool.shouldCompact()) {
+                evilutionGeometryPool.compact();
+            }
+        }
+
+        vkDeviceWaitIdle(evilutionDevice.device());
+        drawStats = simpleRenderSystem.getTotalStats();
+        staticDrawStats = simpleRenderSystem.getStaticDrawStats();
+        instanceStats = instanceBuffer.getStats();
+        if (meshletRenderSystem) {
+            meshletStats = meshletRenderSystem->getStats();
+            hasMeshletStats = true;
+        }
+        if (useRenderGraph) {
+            renderGraphStats = renderGraph.getStats();
+            hasRenderGraphStats = true;
+        }
+    } catch (...) {
+        stop(std::current_exception());
+    }
 }
 
 void FirstApp::loadGameObjects() {
-    std::shared_ptr<EvilutionModel> vaseModel = EvilutionModel::createModelFromFile(evilutionDevice, "models/flat_vase.obj");
+    // loads in the background so the first frames do not wait for it, coarsest level first
+    StreamedModelId vaseModel = evilutionGeometryStreamer.addModel("models/flat_vase.obj");
 
     auto gameObject = evilutionRegistry.create();
-    auto& renderComponent = evilutionRegistry.emplace<RenderComponent>(gameObject);
+    evilutionRegistry.emplace<RenderComponent>(gameObject);
+    evilutionRegistry.emplace<StreamedModelComponent>(gameObject, vaseModel);
     auto& transformComponent = evilutionRegistry.emplace<TransformComponent>(gameObject);
 
-    renderComponent.model = vaseModel;
-
     transformComponent.translation = {0.0f, 0.0f, 2.5f};
     transformComponent.scale = {3.f, 1.5f, 3.f};
+
+    // never moves and is not streamed, so it is recorded once into the static draws and replayed after that
+    auto staticObject = evilutionRegistry.create();
+    ModelHandle staticModel = evilutionAssetCache.loadModelAsync("models/smooth_vase.obj");
+    evilutionRegistry.emplace<RenderComponent>(staticObject, staticModel);
+    evilutionRegistry.emplace<StaticComponent>(staticObject);
+    auto& staticTransform = evilutionRegistry.emplace<TransformComponent>(staticObject);
+    staticTransform.translation = {1.5f, 0.5f, 2.5f};
+    staticTransform.scale = {2.f, 1.f, 2.f};
+
+    // a grid of small cubes thrown about the body box, their spheres bouncing off each other and its sides
+    constexpr int BODIES_PER_SIDE = 4;
+    constexpr float BODY_RADIUS = 0.1f;
+    StreamedModelId cubeModel = evilutionGeometryStreamer.addModel("models/cube.obj");
+    glm::vec3 spacing = (BODY_BOX_MAX - BODY_BOX_MIN) / static_cast<float>(BODIES_PER_SIDE + 1);
+    for (int x = 1; x <= BODIES_PER_SIDE; x++) {
+        for (int y = 1; y <= BODIES_PER_SIDE; y++) {
+            for (int z = 1; z <= BODIES_PER_SIDE; z++) {
+                auto body = evilutionRegistry.create();
+                evilutionRegistry.emplace<RenderComponent>(body);
+                evilutionRegistry.emplace<StreamedModelComponent>(body, cubeModel);
+                auto& bodyTransform = evilutionRegistry.emplace<TransformComponent>(body);
+                bodyTransform.translation = BODY_BOX_MIN + spacing * glm::vec3(x, y, z);
+                bodyTransform.scale = glm::vec3{BODY_RADIUS};
+                auto& rigidBody = evilutionRegistry.emplace<RigidBodyComponent>(body);
+                rigidBody.velocity = {std::sin(x * 1.7f + z) * 2.f, -1.f, std::cos(y * 2.3f + z) * 2.f};
+                rigidBody.radius = BODY_RADIUS;
+            }
+        }
+    }
+
+    auto camera = evilutionRegistry.create();
+    evilutionRegistry.emplace<CameraComponent>(camera);
+    evilutionRegistry.emplace<TransformComponent>(camera);
 }
 } // namespace evilution
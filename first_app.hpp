@@ -1,30 +1,129 @@
 #pragma once
 
+#include "evilution_asset_cache.hpp"
+#include "evilution_frame_pacer.hpp"
+#include "evilution_geometry_pool.hpp"
+#include "evilution_geometry_streamer.hpp"
+#include "evilution_input.hpp"
+#include "evilution_instance_buffer.hpp"
+#include "evilution_instance_tracker.hpp"
+#include "evilution_pipeline_manager.hpp"
+#include "evilution_render_snapshot.hpp"
+#include "evilution_job_system.hpp"
+#include "evilution_physics_system.hpp"
+#include "evilution_redraw_scheduler.hpp"
 #include "evilution_renderer.hpp"
+#include "evilution_resource_registry.hpp"
+#include "evilution_static_draw_set.hpp"
+#include "evilution_system_scheduler.hpp"
+#include "evilution_triple_buffer.hpp"
+#include "keyboard_movement_controller.hpp"
+#include "meshlet_render_system.hpp"
+#include "simple_render_system.hpp"
 
 // std
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <entt/entt.hpp>
+#include <exception>
+#include <mutex>
 
 namespace evilution {
+
+// rendering options picked on the command line
+struct RenderSettings {
+    MeshletCullingSettings meshlets{};
+    // build instance matrices in a compute shader from the changed transforms instead of on the CPU
+    bool gpuTransforms = false;
+    // only draw when input, a window event, something still moving or requestRedraw() calls for a frame
+    bool onDemand = false;
+};
+
 class FirstApp {
   public:
     static constexpr int WIDTH = 1000;
     static constexpr int HEIGHT = 1000;
+    // seconds an idle on-demand loop waits for events before checking on the other threads
+    static constexpr double ON_DEMAND_EVENT_TIMEOUT = 0.5;
 
-    FirstApp();
+    // a target frame rate of 0 leaves pacing to the swap chain
+    explicit FirstApp(const SwapChainSettings& swapChainSettings = {}, double targetFrameRate = 0.0,
+                      const RenderSettings& renderSettings = {});
     ~FirstApp();
 
     FirstApp(const FirstApp&) = delete;
     FirstApp& operator=(const FirstApp&) = delete;
 
+    // Polls input on the calling (main) thread while a simulation thread builds render snapshots and a render
+    // thread records and presents them, one frame behind the simulation.
     void run();
+    // In on-demand mode, draws another frame even though nothing the app tracks has changed. Any thread.
+    void requestRedraw() { evilutionRedrawScheduler.invalidate(); }
 
   private:
     void loadGameObjects();
+    void registerSystems();
+    void buildRenderSnapshot(entt::registry& registry, RenderSnapshot& snapshot);
+    // whether the scene is still changing, so an on-demand loop has to keep simulating
+    bool needsAnotherFrame(const RenderSnapshot& snapshot);
+    void simulationLoop();
+    void renderLoop();
+    // blocks until a snapshot newer than the last one consumed is published; false once the app is stopping
+    bool acquireSnapshot();
+    void stop(std::exception_ptr error = nullptr);
 
     EvilutionWindow evilutionWindow{WIDTH, HEIGHT, "Evilution"};
     EvilutionDevice evilutionDevice{evilutionWindow};
-    EvilutionRenderer evilutionRenderer{evilutionWindow, evilutionDevice};
+    EvilutionRenderer evilutionRenderer;
+    EvilutionPipelineManager evilutionPipelineManager{evilutionDevice};
+    EvilutionGeometryPool evilutionGeometryPool{evilutionDevice, sizeof(EvilutionModel::Vertex)};
+    EvilutionResourceRegistry evilutionResourceRegistry{evilutionDevice.deletionQueue()};
+    EvilutionAssetCache evilutionAssetCache{evilutionGeometryPool, evilutionResourceRegistry};
+    // owned by the simulation thread while running
+    EvilutionGeometryStreamer evilutionGeometryStreamer{evilutionDevice, evilutionAssetCache,
+                                                        evilutionResourceRegistry};
+    EvilutionFramePacer evilutionFramePacer;
+    EvilutionRedrawScheduler evilutionRedrawScheduler;
+    EvilutionJobSystem evilutionJobSystem;
+    EvilutionSystemScheduler evilutionSystemScheduler{evilutionJobSystem};
+
+    // owned by the simulation thread while running
     entt::registry evilutionRegistry {};
+    EvilutionPhysicsSystem evilutionPhysicsSystem;
+    EvilutionInstanceTracker evilutionInstanceTracker;
+    EvilutionStaticDrawSet evilutionStaticDrawSet{evilutionRegistry, evilutionResourceRegistry};
+    KeyboardMovementController cameraController{};
+    InputState simulationInput{};
+    uint64_t simulationFrame = 0;
+    EvilutionRedrawScheduler::Clock::time_point simulationWakeTime{};
+    glm::mat4 lastProjectionView{0.f};
+    size_t lastObjectCount = 0;
+    std::vector<DrawItem> drawSortScratch;
+
+    // meshlets are used by the render thread when the device supports meshlet rendering
+    const RenderSettings renderSettings;
+    // Whether the render thread draws through MeshletRenderSystem, which reads transforms from the instance
+    // buffer alone. Snapshots only carry matrices for SimpleRenderSystem, the fallback when it does not.
+    const bool drawsMeshlets;
+
+    // totals from the render thread, printed once it has exited
+    DrawStats drawStats{};
+    SimpleRenderSystem::StaticDrawStats staticDrawStats{};
+    MeshletRenderSystem::Stats meshletStats{};
+    bool hasMeshletStats = false;
+    EvilutionInstanceBuffer::Stats instanceStats{};
+    EvilutionRenderGraph::Stats renderGraphStats{};
+    bool hasRenderGraphStats = false;
+
+    EvilutionTripleBuffer<InputState> inputBuffer;
+    EvilutionTripleBuffer<RenderSnapshot> snapshotBuffer;
+
+    std::atomic<bool> running{false};
+    std::mutex frameMutex;
+    std::condition_variable frameCondition;
+    uint64_t publishedSnapshot = 0;
+    uint64_t consumedSnapshot = 0;
+    std::exception_ptr threadError;
 };
-} // namespace evilution
\ No newline at end of file
+} // namespace evilution
@@ -2,12 +2,12 @@
 
 namespace evilution {
 
-void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform) {
+void KeyboardMovementController::moveInPlaneXZ(const InputState& input, float dt, TransformComponent& transform) {
     glm::vec3 rotate{0.f};
-    if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) rotate.y += 1.f;
-    if (glfwGetKey(window, keys.lookLeft) == GLFW_PRESS) rotate.y -= 1.f;
-    if (glfwGetKey(window, keys.lookUp) == GLFW_PRESS) rotate.x += 1.f;
-    if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) rotate.x -= 1.f;
+    if (input.isKeyPressed(keys.lookRight)) rotate.y += 1.f;
+    if (input.isKeyPressed(keys.lookLeft)) rotate.y -= 1.f;
+    if (input.isKeyPressed(keys.lookUp)) rotate.x += 1.f;
+    if (input.isKeyPressed(keys.lookDown)) rotate.x -= 1.f;
 
     if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon()) {
         transform.rotation += lookSpeed * dt * glm::normalize(rotate);
@@ -22,12 +22,12 @@ void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, Tra
     const glm::vec3 upDir{0.f, -1.f, 0.f};
 
     glm::vec3 moveDir{0.f};
-    if (glfwGetKey(window, keys.moveForward) == GLFW_PRESS) moveDir += forwardDir;
-    if (glfwGetKey(window, keys.moveBackward) == GLFW_PRESS) moveDir -= forwardDir;
-    if (glfwGetKey(window, keys.moveRight) == GLFW_PRESS) moveDir += rightDir;
-    if (glfwGetKey(window, keys.moveLeft) == GLFW_PRESS) moveDir -= rightDir;
-    if (glfwGetKey(window, keys.moveUp) == GLFW_PRESS) moveDir += upDir;
-    if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) moveDir -= upDir;
+    if (input.isKeyPressed(keys.moveForward)) moveDir += forwardDir;
+    if (input.isKeyPressed(keys.moveBackward)) moveDir -= forwardDir;
+    if (input.isKeyPressed(keys.moveRight)) moveDir += rightDir;
+    if (input.isKeyPressed(keys.moveLeft)) moveDir -= rightDir;
+    if (input.isKeyPressed(keys.moveUp)) moveDir += upDir;
+    if (input.isKeyPressed(keys.moveDown)) moveDir -= upDir;
 
     if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon()) {
         transform.translation += moveSpeed * dt * glm::normalize(moveDir);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "evilution_components.hpp"
+#include "evilution_input.hpp"
 
 namespace evilution {
 
@@ -19,7 +20,7 @@ class KeyboardMovementController {
         int lookDown = GLFW_KEY_DOWN;
     };
 
-    void moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform); 
+    void moveInPlaneXZ(const InputState& input, float dt, TransformComponent& transform);
 
     KeyMappings keys{};
     float moveSpeed{3.f};
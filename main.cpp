@@ -1,12 +1,89 @@
 #include "first_app.hpp"
 
 // std
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
-int main() {
+namespace {
+
+bool parsePresentMode(const std::string& name, VkPresentModeKHR& presentMode) {
+    if (name == "fifo") {
+        presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    } else if (name == "fifo_relaxed") {
+        presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    } else if (name == "mailbox") {
+        presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    } else if (name == "immediate") {
+        presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// --present-mode=fifo|fifo_relaxed|mailbox|immediate --frames-in-flight=1..4 --target-fps=N --legacy-render-pass
+// --vertex-pulling --gpu-transforms --on-demand
+bool parseArguments(int argc, char** argv, evilution::SwapChainSettings& settings, double& targetFrameRate,
+                    evilution::RenderSettings& renderSettings) {
+    const std::string presentModeArg = "--present-mode=";
+    const std::string framesInFlightArg = "--frames-in-flight=";
+    const std::string targetFpsArg = "--target-fps=";
+    const std::string legacyRenderPassArg = "--legacy-render-pass";
+    const std::string vertexPullingArg = "--vertex-pulling";
+    const std::string gpuTransformsArg = "--gpu-transforms";
+    const std::string onDemandArg = "--on-demand";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind(presentModeArg, 0) == 0) {
+            if (!parsePresentMode(arg.substr(presentModeArg.size()), settings.presentMode)) {
+                std::cerr << "unknown present mode: " << arg << std::endl;
+                return false;
+            }
+        } else if (arg.rfind(framesInFlightArg, 0) == 0) {
+            int framesInFlight = std::atoi(arg.substr(framesInFlightArg.size()).c_str());
+            if (framesInFlight < 1 || framesInFlight > evilution::EvilutionSwapChain::MAX_FRAMES_IN_FLIGHT) {
+                std::cerr << "frames in flight must be between 1 and "
+                          << evilution::EvilutionSwapChain::MAX_FRAMES_IN_FLIGHT << std::endl;
+                return false;
+            }
+            settings.framesInFlight = static_cast<uint32_t>(framesInFlight);
+        } else if (arg.rfind(targetFpsArg, 0) == 0) {
+            targetFrameRate = std::atof(arg.substr(targetFpsArg.size()).c_str());
+            if (targetFrameRate < 0.0) {
+                std::cerr << "target fps must not be negative" << std::endl;
+                return false;
+            }
+        } else if (arg == legacyRenderPassArg) {
+            settings.dynamicRendering = false;
+        } else if (arg == vertexPullingArg) {
+            renderSettings.meshlets.vertexPulling = true;
+        } else if (arg == gpuTransformsArg) {
+            renderSettings.gpuTransforms = true;
+        } else if (arg == onDemandArg) {
+            renderSettings.onDemand = true;
+        } else {
+            std::cerr << "unknown argument: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
     std::cout << "Hello, World!" << std::endl;
 
-    evilution::FirstApp app{};
+    evilution::SwapChainSettings swapChainSettings{};
+    double targetFrameRate = 0.0;
+    evilution::RenderSettings renderSettings{};
+    if (!parseArguments(argc, argv, swapChainSettings, targetFrameRate, renderSettings)) {
+        return EXIT_FAILURE;
+    }
+
+    evilution::FirstApp app{swapChainSettings, targetFrameRate, renderSettings};
 
     try {
         app.run();
@@ -16,4 +93,4 @@ int main() {
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,724 @@
+#include "meshlet_render_system.hpp"
+#include "evilution_model.hpp"
+#include "evilution_shaders.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace evilution {
+
+namespace {
+constexpr uint32_t PHASE_EARLY = 0;
+constexpr uint32_t PHASE_LATE = 1;
+constexpr uint32_t OBJECT_CONE_CULLING = 1;
+constexpr uint32_t TIMESTAMP_COUNT = 4;
+
+static_assert(sizeof(InstanceData) == 128, "InstanceData must match the std430 layout the shaders read");
+static_assert(sizeof(EvilutionModel::Vertex) == 11 * sizeof(float),
+              "meshlet_shader_pulled.vert reads each vertex as 11 consecutive floats");
+
+// laid out as meshlet_cull.comp and meshlet_shader.vert read them
+struct GpuObject {
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+    uint32_t visibilityOffset = 0;
+    uint32_t flags = 0;
+    uint32_t instance = 0;
+};
+static_assert(sizeof(GpuObject) == 28, "GpuObject must match the std430 layout of ObjectData");
+
+struct CullData {
+    glm::mat4 view{1.f};
+    glm::vec4 frustumPlanes[6];
+    float projection00 = 1.f;
+    float projection11 = 1.f;
+    // depth = depthBias + depthScale / view space z
+    float depthBias = 0.f;
+    float depthScale = 0.f;
+    glm::vec2 pyramidSize{1.f};
+    uint32_t objectCount = 0;
+    uint32_t drawCapacity = 0;
+    float zNear = 0.f;
+    uint32_t occlusionCulling = 0;
+    uint32_t padding[2]{};
+    // world space; each object's model space position is worked out on the GPU from its instance
+    glm::vec4 cameraPosition{0.f};
+};
+static_assert(sizeof(CullData) == 224, "CullData must match the std140 layout of the culling uniforms");
+
+struct CullCounters {
+    uint32_t earlyDrawCount;
+    uint32_t lateDrawCount;
+    uint32_t tested;
+    uint32_t frustumCulled;
+    uint32_t backfaceCulled;
+    uint32_t occlusionCulled;
+};
+
+struct DrawPushConstants {
+    glm::mat4 projectionView{1.f};
+};
+
+struct PyramidPushConstants {
+    int32_t sourceSize[2];
+    int32_t destinationSize[2];
+};
+
+uint32_t previousPowerOfTwo(uint32_t value) {
+    uint32_t power = 1;
+    while (power <= value / 2) {
+        power *= 2;
+    }
+    return power;
+}
+} // namespace
+
+MeshletRenderSystem::MeshletRenderSystem(EvilutionDevice& device, EvilutionPipelineManager& pipelineManager,
+                                         EvilutionResourceRegistry& resourceRegistry,
+                                         EvilutionGeometryPool& geometryPool, EvilutionInstanceBuffer& instanceBuffer,
+                                         const RenderTargetInfo& renderTarget, uint32_t framesInFlight,
+                                         const MeshletCullingSettings& settings)
+    : evilutionDevice{device}, evilutionPipelineManager{pipelineManager}, evilutionResourceRegistry{resourceRegistry},
+      evilutionGeometryPool{geometryPool}, evilutionInstanceBuffer{instanceBuffer}, settings{settings} {
+    assert(isSupported(device) && "Meshlet rendering needs multiDrawIndirect and drawIndirectFirstInstance");
+    assert(settings.visibilityCapacity >= settings.maxMeshlets &&
+           "Visibility must have room for at least one frame of meshlets");
+
+    stats.vertexPulling = settings.vertexPulling;
+    timestampsSupported = device.properties.limits.timestampComputeAndGraphics == VK_TRUE &&
+                          device.properties.limits.timestampPeriod > 0.f;
+
+    createDescriptors(framesInFlight);
+    createPipelineLayouts();
+    createPipelines(renderTarget);
+    createSampler();
+
+    frames.resize(framesInFlight);
+    for (FrameResources& frame : frames) {
+        createFrameResources(frame);
+    }
+    evilutionDevice.createBuffer(static_cast<VkDeviceSize>(settings.visibilityCapacity) * sizeof(uint32_t),
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibilityBuffer, visibilityMemory);
+}
+
+MeshletRenderSystem::~MeshletRenderSystem() {
+    retireDepthPyramid();
+    for (FrameResources& frame : frames) {
+        destroyFrameResources(frame);
+    }
+    evilutionDevice.deletionQueue().destroyBuffer(visibilityBuffer, visibilityMemory);
+
+    vkDestroySampler(evilutionDevice.device(), pyramidSampler, nullptr);
+    vkDestroyPipelineLayout(evilutionDevice.device(), drawPipelineLayout, nullptr);
+    vkDestroyPipelineLayout(evilutionDevice.device(), cullPipelineLayout, nullptr);
+    vkDestroyPipelineLayout(evilutionDevice.device(), pyramidPipelineLayout, nullptr);
+}
+
+void MeshletRenderSystem::createDescriptors(uint32_t framesInFlight) {
+    cullSetLayout =
+        EvilutionDescriptorSetLayout::Builder(evilutionDevice)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT)
+            .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .addBinding(8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+    pyramidSetLayout = EvilutionDescriptorSetLayout::Builder(evilutionDevice)
+                           .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .build();
+
+    // every set is allocated up front and rewritten each frame
+    uint32_t setsPerFrame = 1 + MAX_PYRAMID_LEVELS;
+    descriptorPool = EvilutionDescriptorPool::Builder(evilutionDevice)
+                         .setMaxSets(framesInFlight * setsPerFrame)
+                         .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, framesInFlight)
+                         .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesInFlight * 7)
+                         .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, framesInFlight * setsPerFrame)
+                         .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, framesInFlight * MAX_PYRAMID_LEVELS)
+                         .build();
+}
+
+void MeshletRenderSystem::createPipelineLayouts() {
+    auto createLayout = [this](const EvilutionDescriptorSetLayout& setLayout, VkShaderStageFlags pushStages,
+                               uint32_t pushSize, VkPipelineLayout& layout) {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = pushStages;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = pushSize;
+
+        VkDescriptorSetLayout descriptorSetLayout = setLayout.getDescriptorSetLayout();
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        if (vkCreatePipelineLayout(evilutionDevice.device(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+    };
+    createLayout(*cullSetLayout, VK_SHADER_STAGE_VERTEX_BIT, sizeof(DrawPushConstants), drawPipelineLayout);
+    createLayout(*cullSetLayout, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(uint32_t), cullPipelineLayout);
+    createLayout(*pyramidSetLayout, VK_SHADER_STAGE_COMPUTE_BIT, sizeof(PyramidPushConstants), pyramidPipelineLayout);
+}
+
+void MeshletRenderSystem::createPipelines(const RenderTargetInfo& renderTarget) {
+    assert(drawPipelineLayout != VK_NULL_HANDLE && "Cannot create pipeline before pipeline layout!");
+
+    PipelineConfigInfo pipelineConfig{};
+    EvilutionPipeline::defaultPipelineConfigInfo(pipelineConfig);
+    pipelineConfig.renderPass = renderTarget.renderPass;
+    pipelineConfig.colorAttachmentFormats = renderTarget.colorAttachmentFormats;
+    pipelineConfig.depthAttachmentFormat = renderTarget.depthAttachmentFormat;
+    pipelineConfig.pipelineLayout = drawPipelineLayout;
+    drawPipeline = evilutionPipelineManager.requestPipeline(shaders::meshletShaderVert, shaders::meshletShaderFrag,
+                                                            pipelineConfig);
+    if (settings.vertexPulling) {
+        EvilutionPipeline::enableVertexPulling(pipelineConfig);
+        pulledDrawPipeline = evilutionPipelineManager.requestPipeline(shaders::meshletShaderPulledVert,
+                                                                      shaders::meshletShaderFrag, pipelineConfig);
+    }
+
+    cullPipeline = evilutionPipelineManager.createComputePipeline(shaders::meshletCullComp, cullPipelineLayout);
+    pyramidPipeline =
+        evilutionPipelineManager.createComputePipeline(shaders::depthPyramidComp, pyramidPipelineLayout);
+}
+
+void MeshletRenderSystem::createSampler() {
+    // the shaders only use texelFetch, the sampler is there because sampled images need one
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(evilutionDevice.device(), &samplerInfo, nullptr, &pyramidSampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth pyramid sampler!");
+    }
+}
+
+void MeshletRenderSystem::createFrameResources(FrameResources& frame) {
+    constexpr VkMemoryPropertyFlags hostVisible =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    evilutionDevice.createBuffer(sizeof(CullData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible,
+                                 frame.cullDataBuffer, frame.cullDataMemory);
+    vkMapMemory(evilutionDevice.device(), frame.cullDataMemory, 0, VK_WHOLE_SIZE, 0, &frame.cullData);
+
+    evilutionDevice.createBuffer(static_cast<VkDeviceSize>(settings.maxObjects) * sizeof(GpuObject),
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, frame.objectBuffer,
+                                 frame.objectMemory);
+    vkMapMemory(evilutionDevice.device(), frame.objectMemory, 0, VK_WHOLE_SIZE, 0, &frame.objects);
+
+    evilutionDevice.createBuffer(sizeof(CullCounters),
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                     VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                 hostVisible, frame.counterBuffer, frame.counterMemory);
+    vkMapMemory(evilutionDevice.device(), frame.counterMemory, 0, VK_WHOLE_SIZE, 0, &frame.counters);
+
+    // both phases' draws
+    evilutionDevice.createBuffer(
+        2 * static_cast<VkDeviceSize>(settings.maxMeshlets) * sizeof(VkDrawIndexedIndirectCommand),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.drawBuffer, frame.drawMemory);
+
+    if (timestampsSupported) {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = TIMESTAMP_COUNT;
+        if (vkCreateQueryPool(evilutionDevice.device(), &queryPoolInfo, nullptr, &frame.timestampPool) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
+    if (!descriptorPool->allocateDescriptor(cullSetLayout->getDescriptorSetLayout(), frame.cullSet)) {
+        throw std::runtime_error("failed to allocate meshlet culling descriptor set!");
+    }
+    for (VkDescriptorSet& set : frame.pyramidSets) {
+        if (!descriptorPool->allocateDescriptor(pyramidSetLayout->getDescriptorSetLayout(), set)) {
+            throw std::runtime_error("failed to allocate depth pyramid descriptor set!");
+        }
+    }
+}
+
+void MeshletRenderSystem::destroyFrameResources(FrameResources& frame) {
+    // freeing the memory unmaps it
+    auto& deletionQueue = evilutionDevice.deletionQueue();
+    deletionQueue.destroyBuffer(frame.cullDataBuffer, frame.cullDataMemory);
+    deletionQueue.destroyBuffer(frame.objectBuffer, frame.objectMemory);
+    deletionQueue.destroyBuffer(frame.counterBuffer, frame.counterMemory);
+    deletionQueue.destroyBuffer(frame.drawBuffer, frame.drawMemory);
+    // only read back on the host, once the frame that wrote it has completed
+    vkDestroyQueryPool(evilutionDevice.device(), frame.timestampPool, nullptr);
+    frame = {};
+}
+
+void MeshletRenderSystem::ensureDepthPyramid(VkExtent2D depthExtent) {
+    if (depthPyramid.image != VK_NULL_HANDLE && depthPyramid.depthExtent.width == depthExtent.width &&
+        depthPyramid.depthExtent.height == depthExtent.height) {
+        return;
+    }
+    retireDepthPyramid();
+
+    // a power of two halves exactly at every level, so texels of one level cover whole texels of the next
+    depthPyramid.depthExtent = depthExtent;
+    depthPyramid.extent = {previousPowerOfTwo(depthExtent.width), previousPowerOfTwo(depthExtent.height)};
+    uint32_t levelCount = 1;
+    while ((std::max(depthPyramid.extent.width, depthPyramid.extent.height) >> levelCount) > 0 &&
+           levelCount < MAX_PYRAMID_LEVELS) {
+        levelCount++;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = depthPyramid.extent.width;
+    imageInfo.extent.height = depthPyramid.extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    evilutionDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthPyramid.image,
+                                        depthPyramid.memory);
+
+    auto createView = [this, levelCount](uint32_t baseLevel, uint32_t viewLevelCount) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = depthPyramid.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = baseLevel;
+        viewInfo.subresourceRange.levelCount = viewLevelCount;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        VkImageView view;
+        if (vkCreateImageView(evilutionDevice.device(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid view!");
+        }
+        return view;
+    };
+    depthPyramid.view = createView(0, levelCount);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        depthPyramid.levelViews.push_back(createView(level, 1));
+    }
+    depthPyramid.initialized = false;
+}
+
+void MeshletRenderSystem::retireDepthPyramid() {
+    // frames in flight may still be culling against it
+    auto& deletionQueue = evilutionDevice.deletionQueue();
+    for (VkImageView levelView : depthPyramid.levelViews) {
+        deletionQueue.destroyImage(VK_NULL_HANDLE, levelView, VK_NULL_HANDLE);
+    }
+    deletionQueue.destroyImage(depthPyramid.image, depthPyramid.view, depthPyramid.memory);
+    depthPyramid = {};
+}
+
+uint32_t MeshletRenderSystem::allocateVisibility(uint32_t objectId, uint32_t meshletCount) {
+    auto [found, inserted] = visibilityRanges.try_emplace(objectId);
+    VisibilityRange& range = found->second;
+    // a new level of detail gets a new range; whatever its entries held only costs one frame of less culling
+    if (inserted || range.meshletCount != meshletCount) {
+        range = {visibilityCursor, meshletCount};
+        visibilityCursor += meshletCount;
+    }
+    return range.offset;
+}
+
+void MeshletRenderSystem::collectCounters(FrameResources& frame) {
+    if (!frame.countersPending) {
+        return;
+    }
+    const auto* counters = static_cast<const CullCounters*>(frame.counters);
+    stats.frames++;
+    stats.testedMeshlets += counters->tested;
+    stats.frustumCulled += counters->frustumCulled;
+    stats.backfaceCulled += counters->backfaceCulled;
+    stats.occlusionCulled += counters->occlusionCulled;
+    stats.earlyDraws += std::min(counters->earlyDrawCount, frame.drawCapacity);
+    stats.lateDraws += std::min(counters->lateDrawCount, frame.drawCapacity);
+    frame.countersPending = false;
+
+    uint64_t timestamps[TIMESTAMP_COUNT];
+    if (frame.timestampPool != VK_NULL_HANDLE &&
+        vkGetQueryPoolResults(evilutionDevice.device(), frame.timestampPool, 0, TIMESTAMP_COUNT, sizeof(timestamps),
+                              timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+        uint64_t ticks = (timestamps[1] - timestamps[0]) + (timestamps[3] - timestamps[2]);
+        stats.drawGpuMs += static_cast<double>(ticks) * evilutionDevice.properties.limits.timestampPeriod * 1e-6;
+        stats.timedFrames++;
+    }
+}
+
+void MeshletRenderSystem::prepareFrame(int frameIndex, const RenderSnapshot& snapshot) {
+    FrameResources& frame = frames[frameIndex];
+    currentFrame = &frame;
+    // the frame that last used these buffers has completed
+    collectCounters(frame);
+
+    // a frame allocates at most maxMeshlets entries; starting over makes every meshlet test as hidden once
+    if (visibilityCursor > settings.visibilityCapacity - settings.maxMeshlets) {
+        visibilityRanges.clear();
+        visibilityCursor = 0;
+        visibilityNeedsClear = true;
+    }
+
+    // front to back as sorted, which is also roughly the order the meshlets are emitted in
+    frameObjects.clear();
+    frameAllocations.clear();
+    for (const DrawItem& item : snapshot.drawOrder) {
+        const RenderObject& object = snapshot.objects[item.object];
+        // the model may have been removed since the snapshot was built
+        GeometryAllocationId allocation;
+        if (!evilutionResourceRegistry.tryGetGeometry(object.model, allocation)) {
+            continue;
+        }
+        frameObjects.push_back(&object);
+        frameAllocations.push_back(allocation);
+    }
+    evilutionGeometryPool.getRanges(frameAllocations, frameRanges);
+
+    glm::vec3 cameraPosition{glm::inverse(snapshot.camera.getView())[3]};
+    auto* objects = static_cast<GpuObject*>(frame.objects);
+    uint32_t objectCount = 0;
+    uint32_t meshletCount = 0;
+    uint32_t vertexEnd = 0;
+    uint32_t meshletEnd = 0;
+    for (size_t i = 0; i < frameRanges.size(); i++) {
+        const GeometryRange& range = frameRanges[i];
+        // only non-indexed geometry has no meshlets, and nothing loaded through the builder is non-indexed
+        if (range.meshletCount == 0) {
+            continue;
+        }
+        if (objectCount == settings.maxObjects || meshletCount + range.meshletCount > settings.maxMeshlets) {
+            stats.skippedObjects++;
+            continue;
+        }
+
+        // transforms are read from the instance buffer, the snapshot does not carry matrices for these objects
+        const RenderObject& object = *frameObjects[i];
+        GpuObject& gpuObject = objects[objectCount++];
+        gpuObject.instance = object.instance;
+        gpuObject.firstMeshlet = range.firstMeshlet;
+        gpuObject.meshletCount = range.meshletCount;
+        gpuObject.firstIndex = range.firstIndex;
+        gpuObject.vertexOffset = static_cast<int32_t>(range.firstVertex);
+        gpuObject.visibilityOffset = allocateVisibility(object.id, range.meshletCount);
+        gpuObject.flags = settings.backfaceCulling ? OBJECT_CONE_CULLING : 0;
+        meshletCount += range.meshletCount;
+        vertexEnd = std::max(vertexEnd, range.firstVertex + range.vertexCount);
+        meshletEnd = std::max(meshletEnd, range.firstMeshlet + range.meshletCount);
+    }
+    frame.objectCount = objectCount;
+    frame.drawCapacity = meshletCount;
+    if (!frameRanges.empty()) {
+        frame.vertexBuffer = frameRanges.front().vertexBuffer;
+        frame.indexBuffer = frameRanges.front().indexBuffer;
+        frame.meshletBuffer = frameRanges.front().meshletBuffer;
+    }
+
+    // A storage buffer binding cannot reach past maxStorageBufferRange. gl_VertexIndex counts from the start of
+    // the pool, so the binding cannot be moved up to the frame's first vertex either; pulling is only possible
+    // while the last vertex drawn is within reach. Without pulling the shaders never read the binding, but it
+    // still has to be valid, so it is clamped.
+    VkDeviceSize maxStorageRange = evilutionDevice.properties.limits.maxStorageBufferRange;
+    VkDeviceSize vertexRange = static_cast<VkDeviceSize>(vertexEnd) * evilutionGeometryPool.getVertexStride();
+    frame.pullVertices = settings.vertexPulling && vertexRange <= maxStorageRange;
+    if (settings.vertexPulling && objectCount > 0 && !frame.pullVertices) {
+        stats.vertexPullingFallbacks++;
+    }
+    frame.vertexRange = std::min(vertexRange, maxStorageRange);
+    assert(static_cast<VkDeviceSize>(meshletEnd) * sizeof(Meshlet) <= maxStorageRange &&
+           "Meshlets beyond maxStorageBufferRange cannot be culled");
+    frame.meshletRange = static_cast<VkDeviceSize>(meshletEnd) * sizeof(Meshlet);
+    // every slot in use has to be within reach of the instance binding, which writeCullSet clamps
+    assert(static_cast<VkDeviceSize>(snapshot.instanceCount) * sizeof(InstanceData) <= maxStorageRange &&
+           "Instances beyond maxStorageBufferRange cannot be read by the meshlet shaders");
+
+    const glm::mat4& projection = snapshot.camera.getProjection();
+    const glm::mat4& view = snapshot.camera.getView();
+    projectionView = projection * view;
+
+    auto* cullData = static_cast<CullData*>(frame.cullData);
+    cullData->view = view;
+    auto frustumPlanes = snapshot.camera.getFrustumPlanes();
+    std::copy(frustumPlanes.begin(), frustumPlanes.end(), cullData->frustumPlanes);
+    cullData->projection00 = projection[0][0];
+    cullData->projection11 = projection[1][1];
+    cullData->depthBias = projection[2][2];
+    cullData->depthScale = projection[3][2];
+    cullData->objectCount = objectCount;
+    cullData->drawCapacity = meshletCount;
+    // the sphere projection only holds for perspective, where depthScale / depthBias is minus the near plane
+    bool perspective = projection[2][3] == 1.f && projection[2][2] != 0.f;
+    cullData->zNear = perspective ? -projection[3][2] / projection[2][2] : 0.f;
+    cullData->occlusionCulling = settings.occlusionCulling && perspective ? 1 : 0;
+    cullData->cameraPosition = glm::vec4{cameraPosition, 1.f};
+}
+
+void MeshletRenderSystem::writeCullSet(FrameResources& frame) {
+    VkDescriptorBufferInfo cullDataInfo{frame.cullDataBuffer, 0, sizeof(CullData)};
+    VkDescriptorBufferInfo objectInfo{frame.objectBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo meshletInfo{frame.meshletBuffer, 0, frame.meshletRange};
+    VkDescriptorBufferInfo drawInfo{frame.drawBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo counterInfo{frame.counterBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo visibilityInfo{visibilityBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorImageInfo pyramidInfo{pyramidSampler, depthPyramid.view, VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorBufferInfo vertexInfo{frame.vertexBuffer, 0, frame.vertexRange};
+    // the buffer may have grown past the limit with room to spare, past the slots prepareFrame checked
+    VkDeviceSize instanceRange =
+        std::min(static_cast<VkDeviceSize>(evilutionInstanceBuffer.getCapacity()) * sizeof(InstanceData),
+                 static_cast<VkDeviceSize>(evilutionDevice.properties.limits.maxStorageBufferRange));
+    VkDescriptorBufferInfo instanceInfo{evilutionInstanceBuffer.getBuffer(), 0, instanceRange};
+    EvilutionDescriptorWriter(*cullSetLayout, *descriptorPool)
+        .writeBuffer(0, &cullDataInfo)
+        .writeBuffer(1, &objectInfo)
+        .writeBuffer(2, &meshletInfo)
+        .writeBuffer(3, &drawInfo)
+        .writeBuffer(4, &counterInfo)
+        .writeBuffer(5, &visibilityInfo)
+        .writeImage(6, &pyramidInfo)
+        .writeBuffer(7, &vertexInfo)
+        .writeBuffer(8, &instanceInfo)
+        .overwrite(frame.cullSet);
+}
+
+void MeshletRenderSystem::cullEarly(VkCommandBuffer commandBuffer, VkExtent2D depthExtent) {
+    assert(currentFrame != nullptr && "prepareFrame must be called before the frame is recorded");
+    FrameResources& frame = *currentFrame;
+    ensureDepthPyramid(depthExtent);
+    static_cast<CullData*>(frame.cullData)->pyramidSize =
+        glm::vec2{static_cast<float>(depthPyramid.extent.width), static_cast<float>(depthPyramid.extent.height)};
+    // the sets of a frame slot are free again once its previous frame has completed
+    if (frame.objectCount > 0) {
+        writeCullSet(frame);
+    }
+
+    if (!depthPyramid.initialized) {
+        // stays in GENERAL, where it is both written level by level and sampled
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = 0;
+        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = depthPyramid.image;
+        imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &imageBarrier);
+        depthPyramid.initialized = true;
+    }
+
+    if (visibilityNeedsClear) {
+        // after earlier frames' late culling is done with it
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                             &barrier, 0, nullptr, 0, nullptr);
+        vkCmdFillBuffer(commandBuffer, visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+        visibilityNeedsClear = false;
+    }
+    vkCmdFillBuffer(commandBuffer, frame.counterBuffer, 0, sizeof(CullCounters), 0);
+    if (frame.timestampPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, TIMESTAMP_COUNT);
+    }
+    if (!evilutionDevice.drawIndirectCountSupported() && frame.drawCapacity > 0) {
+        // every slot gets drawn, so the ones culling leaves untouched must be empty draws
+        vkCmdFillBuffer(commandBuffer, frame.drawBuffer, 0,
+                        2 * static_cast<VkDeviceSize>(frame.drawCapacity) * sizeof(VkDrawIndexedIndirectCommand), 0);
+    }
+
+    // also orders this frame's culling after the previous frame's, which shares the visibility and the pyramid
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    recordCull(commandBuffer, PHASE_EARLY);
+}
+
+void MeshletRenderSystem::renderEarly(VkCommandBuffer commandBuffer) {
+    writeTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0);
+    recordDraws(commandBuffer, PHASE_EARLY);
+    writeTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 1);
+}
+
+void MeshletRenderSystem::buildDepthPyramid(VkCommandBuffer commandBuffer, VkImageView depthView,
+                                            VkExtent2D depthExtent) {
+    assert(currentFrame != nullptr && "prepareFrame must be called before the frame is recorded");
+    assert(depthPyramid.depthExtent.width == depthExtent.width &&
+           depthPyramid.depthExtent.height == depthExtent.height && "Depth changed size since the early culling");
+    FrameResources& frame = *currentFrame;
+
+    pyramidPipeline->bind(commandBuffer);
+    VkExtent2D sourceExtent = depthExtent;
+    for (uint32_t level = 0; level < depthPyramid.levelViews.size(); level++) {
+        VkExtent2D levelExtent{std::max(1u, depthPyramid.extent.width >> level),
+                               std::max(1u, depthPyramid.extent.height >> level)};
+
+        VkDescriptorImageInfo sourceInfo{};
+        sourceInfo.sampler = pyramidSampler;
+        sourceInfo.imageView = level == 0 ? depthView : depthPyramid.levelViews[level - 1];
+        sourceInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+        VkDescriptorImageInfo destinationInfo{VK_NULL_HANDLE, depthPyramid.levelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+        EvilutionDescriptorWriter(*pyramidSetLayout, *descriptorPool)
+            .writeImage(0, &sourceInfo)
+            .writeImage(1, &destinationInfo)
+            .overwrite(frame.pyramidSets[level]);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidPipelineLayout, 0, 1,
+                                &frame.pyramidSets[level], 0, nullptr);
+        PyramidPushConstants push{{static_cast<int32_t>(sourceExtent.width), static_cast<int32_t>(sourceExtent.height)},
+                                  {static_cast<int32_t>(levelExtent.width), static_cast<int32_t>(levelExtent.height)}};
+        vkCmdPushConstants(commandBuffer, pyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+        vkCmdDispatch(commandBuffer, (levelExtent.width + 7) / 8, (levelExtent.height + 7) / 8, 1);
+
+        // read by the next level, and after the last by the late culling
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = depthPyramid.image;
+        imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+        sourceExtent = levelExtent;
+    }
+}
+
+void MeshletRenderSystem::cullLate(VkCommandBuffer commandBuffer) {
+    assert(currentFrame != nullptr && "prepareFrame must be called before the frame is recorded");
+    recordCull(commandBuffer, PHASE_LATE);
+    currentFrame->countersPending = true;
+}
+
+void MeshletRenderSystem::renderLate(VkCommandBuffer commandBuffer) {
+    writeTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 2);
+    recordDraws(commandBuffer, PHASE_LATE);
+    writeTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 3);
+}
+
+void MeshletRenderSystem::writeTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage,
+                                         uint32_t query) {
+    if (currentFrame->timestampPool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(commandBuffer, stage, currentFrame->timestampPool, query);
+    }
+}
+
+void MeshletRenderSystem::recordCull(VkCommandBuffer commandBuffer, uint32_t phase) {
+    FrameResources& frame = *currentFrame;
+    if (frame.objectCount > 0) {
+        cullPipeline->bind(commandBuffer);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1,
+                                &frame.cullSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(phase), &phase);
+        vkCmdDispatch(commandBuffer, frame.objectCount, 1, 1);
+    }
+
+    // the draws read the commands and counts, the next phase the visibility, and the host the late counters
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask =
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    if (phase == PHASE_LATE) {
+        barrier.dstAccessMask |= VK_ACCESS_HOST_READ_BIT;
+        dstStages |= VK_PIPELINE_STAGE_HOST_BIT;
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStages, 0, 1, &barrier, 0, nullptr,
+                         0, nullptr);
+}
+
+void MeshletRenderSystem::recordDraws(VkCommandBuffer commandBuffer, uint32_t phase) {
+    FrameResources& frame = *currentFrame;
+    // the variant compiles in the background; draw nothing until it is ready rather than stall the frame
+    EvilutionPipeline* pipeline = frame.pullVertices ? pulledDrawPipeline.get() : drawPipeline.get();
+    if (pipeline == nullptr || frame.drawCapacity == 0) {
+        return;
+    }
+
+    pipeline->bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawPipelineLayout, 0, 1, &frame.cullSet,
+                            0, nullptr);
+    DrawPushConstants push{projectionView};
+    vkCmdPushConstants(commandBuffer, drawPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push);
+    if (!frame.pullVertices) {
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &frame.vertexBuffer, &offset);
+    }
+    vkCmdBindIndexBuffer(commandBuffer, frame.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    VkDeviceSize drawOffset =
+        phase == PHASE_LATE ? static_cast<VkDeviceSize>(frame.drawCapacity) * sizeof(VkDrawIndexedIndirectCommand) : 0;
+    if (evilutionDevice.drawIndirectCountSupported()) {
+        evilutionDevice.cmdDrawIndexedIndirectCount(commandBuffer, frame.drawBuffer, drawOffset, frame.counterBuffer,
+                                                    phase * sizeof(uint32_t), frame.drawCapacity,
+                                                    sizeof(VkDrawIndexedIndirectCommand));
+    } else {
+        vkCmdDrawIndexedIndirect(commandBuffer, frame.drawBuffer, drawOffset, frame.drawCapacity,
+                                 sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+void MeshletRenderSystem::Stats::print(std::ostream& out) const {
+    double perFrame = frames > 0 ? 1.0 / static_cast<double>(frames) : 0.0;
+    auto percentOfTested = [this](uint64_t count) {
+        return testedMeshlets > 0 ? 100.0 * static_cast<double>(count) / static_cast<double>(testedMeshlets) : 0.0;
+    };
+    out << "meshlet culling: " << static_cast<double>(testedMeshlets) * perFrame << " meshlets tested per frame, "
+        << percentOfTested(frustumCulled) << "% outside the frustum, " << percentOfTested(backfaceCulled)
+        << "% facing away, " << percentOfTested(occlusionCulled) << "% occluded; "
+        << static_cast<double>(earlyDraws) * perFrame << " early and " << static_cast<double>(lateDraws) * perFrame
+        << " late draws per frame over " << frames << " frames, " << skippedObjects << " objects skipped"
+        << std::endl;
+    if (timedFrames > 0) {
+        out << "meshlet draws: " << drawGpuMs / static_cast<double>(timedFrames) << " ms GPU per frame with "
+            << (vertexPulling ? "vertex pulling" : "fixed-function vertex input") << " over " << timedFrames
+            << " frames";
+        if (vertexPullingFallbacks > 0) {
+            out << ", " << vertexPullingFallbacks << " frames fell back to vertex input";
+        }
+        out << std::endl;
+    }
+}
+
+} // namespace evilution
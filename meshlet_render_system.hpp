@@ -0,0 +1,206 @@
+#pragma once
+
+#include "evilution_descriptors.hpp"
+#include "evilution_device.hpp"
+#include "evilution_geometry_pool.hpp"
+#include "evilution_instance_buffer.hpp"
+#include "evilution_pipeline.hpp"
+#include "evilution_pipeline_manager.hpp"
+#include "evilution_render_snapshot.hpp"
+#include "evilution_resource_registry.hpp"
+#include "evilution_swap_chain.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace evilution {
+
+struct MeshletCullingSettings {
+    // The cone test assumes closed meshes; looking into an open one shows the inside, whose clusters face away
+    // and would be culled. Off by default since the pipeline draws both faces and the scene has open meshes.
+    bool backfaceCulling = false;
+    bool occlusionCulling = true;
+    // meshlets drawn per frame across all objects, objects beyond it are skipped; kept within the 2^16 - 1
+    // draws every device with multiDrawIndirect supports in one call
+    uint32_t maxMeshlets = (1 << 16) - 1;
+    uint32_t maxObjects = 1 << 12;
+    // last frame's visibility, one entry per meshlet of every object drawn recently
+    uint32_t visibilityCapacity = 1 << 20;
+    // fetch vertices from the geometry pool's storage buffer by gl_VertexIndex instead of through fixed-function
+    // vertex input, which leaves the vertex layout to the shader alone. Frames whose vertices reach past what
+    // one storage buffer binding can address (maxStorageBufferRange, 128 MiB guaranteed) use fixed-function
+    // input instead.
+    bool vertexPulling = false;
+};
+
+// Draws the snapshot meshlet by meshlet, with every cluster culled on the GPU. A compute pass tests each
+// meshlet's bounding sphere against the frustum, its normal cone against the camera position and, in a second
+// phase, its screen bounds against a depth pyramid, then writes the survivors as compacted indexed indirect
+// draws. Occlusion is two-phase: what was visible last frame is drawn first, the pyramid is built from that
+// depth, and the late phase draws whatever the first one missed that the pyramid cannot rule out.
+//
+// Requires EvilutionDevice::multiDrawIndirectSupported(). With VK_KHR_draw_indirect_count the draws stop at the
+// count the culling wrote; without it every slot is drawn and the unused ones are zeroed.
+class MeshletRenderSystem {
+  public:
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t testedMeshlets = 0;
+        uint64_t frustumCulled = 0;
+        uint64_t backfaceCulled = 0;
+        uint64_t occlusionCulled = 0;
+        uint64_t earlyDraws = 0;
+        uint64_t lateDraws = 0;
+        // objects left out because the frame was already at maxObjects or maxMeshlets
+        uint64_t skippedObjects = 0;
+        // GPU time of both draw passes, from timestamps; zero when the queue cannot write them
+        uint64_t timedFrames = 0;
+        double drawGpuMs = 0.0;
+        bool vertexPulling = false;
+        // frames drawn with fixed-function vertex input because their vertices did not fit one binding
+        uint64_t vertexPullingFallbacks = 0;
+
+        void print(std::ostream& out) const;
+    };
+
+    MeshletRenderSystem(EvilutionDevice& device, EvilutionPipelineManager& pipelineManager,
+                        EvilutionResourceRegistry& resourceRegistry, EvilutionGeometryPool& geometryPool,
+                        EvilutionInstanceBuffer& instanceBuffer, const RenderTargetInfo& renderTarget,
+                        uint32_t framesInFlight, const MeshletCullingSettings& settings = {});
+    ~MeshletRenderSystem();
+
+    MeshletRenderSystem(const MeshletRenderSystem&) = delete;
+    MeshletRenderSystem& operator=(const MeshletRenderSystem&) = delete;
+
+    static bool isSupported(EvilutionDevice& device) { return device.multiDrawIndirectSupported(); }
+
+    // Once per frame, before any of the passes below are recorded: uploads the snapshot's objects into this
+    // frame's buffers and collects the statistics of the frame that last used them. Transforms are read from
+    // the instance buffer, which has to be flushed earlier in the same command buffer.
+    void prepareFrame(int frameIndex, const RenderSnapshot& snapshot);
+
+    // The frame in order. Culling and the pyramid are compute work recorded outside rendering; the draws go in
+    // passes rendering to the same color and depth, the first clearing them and the second loading them.
+    void cullEarly(VkCommandBuffer commandBuffer, VkExtent2D depthExtent);
+    void renderEarly(VkCommandBuffer commandBuffer);
+    // reads the depth the early draws left, which must be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    void buildDepthPyramid(VkCommandBuffer commandBuffer, VkImageView depthView, VkExtent2D depthExtent);
+    void cullLate(VkCommandBuffer commandBuffer);
+    void renderLate(VkCommandBuffer commandBuffer);
+
+    const Stats& getStats() const { return stats; }
+
+  private:
+    static constexpr uint32_t MAX_PYRAMID_LEVELS = 16;
+
+    struct FrameResources {
+        VkBuffer cullDataBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory cullDataMemory = VK_NULL_HANDLE;
+        void* cullData = nullptr;
+        VkBuffer objectBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory objectMemory = VK_NULL_HANDLE;
+        void* objects = nullptr;
+        // host visible so the counts can be read back once the frame has completed
+        VkBuffer counterBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory counterMemory = VK_NULL_HANDLE;
+        void* counters = nullptr;
+        VkBuffer drawBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory drawMemory = VK_NULL_HANDLE;
+
+        // begin and end of the early and of the late draws
+        VkQueryPool timestampPool = VK_NULL_HANDLE;
+
+        VkDescriptorSet cullSet = VK_NULL_HANDLE;
+        std::array<VkDescriptorSet, MAX_PYRAMID_LEVELS> pyramidSets{};
+
+        uint32_t objectCount = 0;
+        // draws each phase has room for: every meshlet of the frame's objects
+        uint32_t drawCapacity = 0;
+        // the pool's buffers when the objects were uploaded; compaction only swaps them between frames
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        VkBuffer meshletBuffer = VK_NULL_HANDLE;
+        // how much of the vertex and meshlet buffers the frame's objects reach, which is all that gets bound
+        VkDeviceSize vertexRange = 0;
+        VkDeviceSize meshletRange = 0;
+        bool pullVertices = false;
+        bool countersPending = false;
+    };
+
+    struct DepthPyramid {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        std::vector<VkImageView> levelViews;
+        // of level 0, the largest power of two that fits in the depth buffer
+        VkExtent2D extent{0, 0};
+        VkExtent2D depthExtent{0, 0};
+        bool initialized = false;
+    };
+
+    struct VisibilityRange {
+        uint32_t offset = 0;
+        uint32_t meshletCount = 0;
+    };
+
+    void createDescriptors(uint32_t framesInFlight);
+    void createPipelineLayouts();
+    void createPipelines(const RenderTargetInfo& renderTarget);
+    void createFrameResources(FrameResources& frame);
+    void destroyFrameResources(FrameResources& frame);
+    void createSampler();
+    void ensureDepthPyramid(VkExtent2D depthExtent);
+    void retireDepthPyramid();
+    uint32_t allocateVisibility(uint32_t objectId, uint32_t meshletCount);
+    void collectCounters(FrameResources& frame);
+    void writeCullSet(FrameResources& frame);
+    void recordCull(VkCommandBuffer commandBuffer, uint32_t phase);
+    void recordDraws(VkCommandBuffer commandBuffer, uint32_t phase);
+    void writeTimestamp(VkCommandBuffer commandBuffer, VkPipelineStageFlagBits stage, uint32_t query);
+
+    EvilutionDevice& evilutionDevice;
+    EvilutionPipelineManager& evilutionPipelineManager;
+    EvilutionResourceRegistry& evilutionResourceRegistry;
+    EvilutionGeometryPool& evilutionGeometryPool;
+    EvilutionInstanceBuffer& evilutionInstanceBuffer;
+    const MeshletCullingSettings settings;
+
+    std::unique_ptr<EvilutionDescriptorPool> descriptorPool;
+    std::unique_ptr<EvilutionDescriptorSetLayout> cullSetLayout;
+    std::unique_ptr<EvilutionDescriptorSetLayout> pyramidSetLayout;
+    VkPipelineLayout drawPipelineLayout = VK_NULL_HANDLE;
+    VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+    VkPipelineLayout pyramidPipelineLayout = VK_NULL_HANDLE;
+    PipelineHandle drawPipeline;
+    // only with vertexPulling; drawPipeline is then the fixed-function fallback
+    PipelineHandle pulledDrawPipeline;
+    std::unique_ptr<EvilutionComputePipeline> cullPipeline;
+    std::unique_ptr<EvilutionComputePipeline> pyramidPipeline;
+    VkSampler pyramidSampler = VK_NULL_HANDLE;
+    bool timestampsSupported = false;
+
+    std::vector<FrameResources> frames;
+    FrameResources* currentFrame = nullptr;
+    glm::mat4 projectionView{1.f};
+    DepthPyramid depthPyramid{};
+
+    VkBuffer visibilityBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory visibilityMemory = VK_NULL_HANDLE;
+    std::unordered_map<uint32_t, VisibilityRange> visibilityRanges;
+    uint32_t visibilityCursor = 0;
+    bool visibilityNeedsClear = true;
+
+    // reused between frames
+    std::vector<GeometryAllocationId> frameAllocations;
+    std::vector<GeometryRange> frameRanges;
+    std::vector<const RenderObject*> frameObjects;
+
+    Stats stats{};
+};
+
+} // namespace evilution
@@ -0,0 +1,51 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+
+struct ObjectData {
+    uint firstMeshlet;
+    uint meshletCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint visibilityOffset;
+    uint flags;
+    uint instance;
+};
+
+struct InstanceData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+};
+
+// every draw the culling pass emits starts at its object's index as the instance
+layout(std430, set = 0, binding = 1) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+// every renderable entity's transform, by instance slot
+layout(std430, set = 0, binding = 8) readonly buffer Instances {
+    InstanceData instances[];
+};
+
+layout(push_constant) uniform Push {
+    mat4 projectionView;
+} push;
+
+const vec3 DIRECTION_TO_LIGHT = normalize(vec3(1.0, -3.0, -1.0));
+const float AMBIENT = 0.02;
+
+void main() {
+  InstanceData instance = instances[objects[gl_InstanceIndex].instance];
+  gl_Position = push.projectionView * instance.modelMatrix * vec4(position, 1.0);
+
+  vec3 normalWorldSpace = normalize(mat3(instance.normalMatrix) * normal);
+
+  float lightIntensity = AMBIENT + max(dot(normalWorldSpace, DIRECTION_TO_LIGHT), 0);
+
+  fragColor = color * lightIntensity;
+}
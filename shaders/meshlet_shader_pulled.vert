@@ -0,0 +1,69 @@
+#version 450
+
+// meshlet_shader.vert without fixed-function vertex input: vertices are fetched from the geometry pool by
+// gl_VertexIndex, which already includes the draw's vertexOffset.
+layout(location = 0) out vec3 fragColor;
+
+struct ObjectData {
+    uint firstMeshlet;
+    uint meshletCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint visibilityOffset;
+    uint flags;
+    uint instance;
+};
+
+struct InstanceData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+};
+
+// every draw the culling pass emits starts at its object's index as the instance
+layout(std430, set = 0, binding = 1) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+// every renderable entity's transform, by instance slot
+layout(std430, set = 0, binding = 8) readonly buffer Instances {
+    InstanceData instances[];
+};
+
+// EvilutionModel::Vertex as floats: position, color, normal, uv. Read as a flat array since std430 would pad
+// a vec3 member to 16 bytes.
+const uint VERTEX_STRIDE = 11u;
+const uint POSITION_OFFSET = 0u;
+const uint COLOR_OFFSET = 3u;
+const uint NORMAL_OFFSET = 6u;
+
+layout(std430, set = 0, binding = 7) readonly buffer Vertices {
+    float vertexData[];
+};
+
+layout(push_constant) uniform Push {
+    mat4 projectionView;
+} push;
+
+const vec3 DIRECTION_TO_LIGHT = normalize(vec3(1.0, -3.0, -1.0));
+const float AMBIENT = 0.02;
+
+vec3 fetchVec3(uint vertexBase, uint offset) {
+    uint base = vertexBase + offset;
+    return vec3(vertexData[base], vertexData[base + 1u], vertexData[base + 2u]);
+}
+
+void main() {
+  uint vertexBase = uint(gl_VertexIndex) * VERTEX_STRIDE;
+  vec3 position = fetchVec3(vertexBase, POSITION_OFFSET);
+  vec3 color = fetchVec3(vertexBase, COLOR_OFFSET);
+  vec3 normal = fetchVec3(vertexBase, NORMAL_OFFSET);
+
+  InstanceData instance = instances[objects[gl_InstanceIndex].instance];
+  gl_Position = push.projectionView * instance.modelMatrix * vec4(position, 1.0);
+
+  vec3 normalWorldSpace = normalize(mat3(instance.normalMatrix) * normal);
+
+  float lightIntensity = AMBIENT + max(dot(normalWorldSpace, DIRECTION_TO_LIGHT), 0);
+
+  fragColor = color * lightIntensity;
+}
@@ -4,7 +4,7 @@ layout (location = 0) in vec3 fragColor;
 layout (location = 0) out vec4 outColor;
 
 layout(push_constant) uniform Push {
-    mat4 transform; //projection * view * model
+    mat4 modelMatrix;
     mat4 normalMatrix;
 } push;
 
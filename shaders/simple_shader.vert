@@ -7,8 +7,13 @@ layout(location = 3) in vec2 uv;
 
 layout(location = 0) out vec3 fragColor;
 
+// kept out of the push constants so recorded draws stay valid as the camera moves
+layout(set = 0, binding = 0) uniform Camera {
+    mat4 projectionView;
+} camera;
+
 layout(push_constant) uniform Push {
-    mat4 transform; //projection * view * model
+    mat4 modelMatrix;
     mat4 normalMatrix;
 } push;
 
@@ -16,7 +21,7 @@ const vec3 DIRECTION_TO_LIGHT = normalize(vec3(1.0, -3.0, -1.0));
 const float AMBIENT = 0.02;
 
 void main() {
-  gl_Position =  push.transform * vec4(position, 1.0);
+  gl_Position = camera.projectionView * push.modelMatrix * vec4(position, 1.0);
 
   vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * normal);
   
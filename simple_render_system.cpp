@@ -1,41 +1,83 @@
 #include "simple_render_system.hpp"
-#include "evilution_components.hpp"
+#include "evilution_shaders.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
-#include <entt/entt.hpp>
 
 // std
+#include <array>
+#include <cassert>
+#include <cstring>
 #include <stdexcept>
 
 namespace evilution {
 
 struct SimplePushConstantData {
-    glm::mat4 transform{1.0f};
+    glm::mat4 modelMatrix{1.0f};
     glm::mat4 normalMatrix{1.0f};
 };
 
-SimpleRenderSystem::SimpleRenderSystem(EvilutionDevice& device, VkRenderPass renderPass) : evilutionDevice{device} {
+struct SimpleCameraUbo {
+    glm::mat4 projectionView{1.0f};
+};
+
+bool SimpleRenderSystem::StaticDrawKey::operator==(const StaticDrawKey& other) const {
+    return staticVersion == other.staticVersion && modelRemovals == other.modelRemovals &&
+           geometryGeneration == other.geometryGeneration && pipeline == other.pipeline &&
+           renderTarget.renderPass == other.renderTarget.renderPass &&
+           renderTarget.colorAttachmentFormats == other.renderTarget.colorAttachmentFormats &&
+           renderTarget.depthAttachmentFormat == other.renderTarget.depthAttachmentFormat &&
+           extent.width == other.extent.width && extent.height == other.extent.height;
+}
+
+SimpleRenderSystem::SimpleRenderSystem(EvilutionDevice& device, EvilutionPipelineManager& pipelineManager,
+                                       EvilutionResourceRegistry& resourceRegistry, EvilutionGeometryPool& geometryPool,
+                                       const RenderTargetInfo& renderTarget, uint32_t framesInFlight)
+    : evilutionDevice{device}, evilutionPipelineManager{pipelineManager}, evilutionResourceRegistry{resourceRegistry},
+      evilutionGeometryPool{geometryPool}, frames(framesInFlight) {
+    createDescriptors(framesInFlight);
     createPipelineLayout();
-    createPipeline(renderPass);
+    createPipeline(renderTarget);
+    createFrameResources();
 }
 
 SimpleRenderSystem::~SimpleRenderSystem() {
+    auto& deletionQueue = evilutionDevice.deletionQueue();
+    // freeing the memory unmaps it
+    for (FrameResources& frame : frames) {
+        deletionQueue.destroyBuffer(frame.cameraBuffer, frame.cameraMemory);
+    }
+    // destroying the pool frees its command buffers, which earlier frames may still be executing
+    VkDevice device = evilutionDevice.device();
+    VkCommandPool pool = commandPool;
+    deletionQueue.defer([device, pool] { vkDestroyCommandPool(device, pool, nullptr); });
+
     vkDestroyPipelineLayout(evilutionDevice.device(), pipelineLayout, nullptr);
 }
 
+void SimpleRenderSystem::createDescriptors(uint32_t framesInFlight) {
+    cameraSetLayout = EvilutionDescriptorSetLayout::Builder(evilutionDevice)
+                          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                          .build();
+    descriptorPool = EvilutionDescriptorPool::Builder(evilutionDevice)
+                         .setMaxSets(framesInFlight)
+                         .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, framesInFlight)
+                         .build();
+}
+
 void SimpleRenderSystem::createPipelineLayout() {
     VkPushConstantRange pushConstantRange{};
     pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
     pushConstantRange.offset = 0;
     pushConstantRange.size = sizeof(SimplePushConstantData);
 
+    VkDescriptorSetLayout descriptorSetLayout = cameraSetLayout->getDescriptorSetLayout();
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0;
-    pipelineLayoutInfo.pSetLayouts = nullptr;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
     pipelineLayoutInfo.pushConstantRangeCount = 1;
     pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
@@ -44,36 +86,179 @@ void SimpleRenderSystem::createPipelineLayout() {
     }
 }
 
-void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+void SimpleRenderSystem::createPipeline(const RenderTargetInfo& renderTarget) {
     assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create pipeline before pipeline layout!");
 
     PipelineConfigInfo pipelineConfig{};
     EvilutionPipeline::defaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = renderPass;
+    pipelineConfig.renderPass = renderTarget.renderPass;
+    pipelineConfig.colorAttachmentFormats = renderTarget.colorAttachmentFormats;
+    pipelineConfig.depthAttachmentFormat = renderTarget.depthAttachmentFormat;
     pipelineConfig.pipelineLayout = pipelineLayout;
-    evilutionPipeline = std::make_unique<EvilutionPipeline>(evilutionDevice, "shaders/simple_shader.vert.spv",
-                                                            "shaders/simple_shader.frag.spv", pipelineConfig);
+    evilutionPipeline =
+        evilutionPipelineManager.requestPipeline(shaders::simpleShaderVert, shaders::simpleShaderFrag, pipelineConfig);
 }
 
-void SimpleRenderSystem::renderGameObjects(VkCommandBuffer commandBuffer, entt::registry& registry, const EvilutionCamera& camera) {
-    evilutionPipeline->bind(commandBuffer);
-
-    auto projectionView = camera.getProjection() * camera.getView();
-
-    auto view = registry.view<TransformComponent, RenderComponent>();
-    for (entt::entity entity : view) {
-        TransformComponent& transform = view.get<TransformComponent>(entity);
-        RenderComponent& render = view.get<RenderComponent>(entity);
-
-        SimplePushConstantData push{};
-        auto modelMatrix = transform.mat4();
-        push.transform = projectionView * modelMatrix;
-        push.normalMatrix = transform.normalMatrix();
-        
-        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
-                           sizeof(SimplePushConstantData), &push);
-        render.model->bind(commandBuffer);
-        render.model->draw(commandBuffer);
+void SimpleRenderSystem::createFrameResources() {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = evilutionDevice.findPhysicalQueueFamilies().graphicsFamily;
+    // the dynamic draws are recorded again every frame, the static ones whenever they are out of date
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if (vkCreateCommandPool(evilutionDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create command pool!");
     }
+
+    for (FrameResources& frame : frames) {
+        evilutionDevice.createBuffer(sizeof(SimpleCameraUbo), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                     frame.cameraBuffer, frame.cameraMemory);
+        vkMapMemory(evilutionDevice.device(), frame.cameraMemory, 0, VK_WHOLE_SIZE, 0, &frame.cameraMapped);
+
+        if (!descriptorPool->allocateDescriptor(cameraSetLayout->getDescriptorSetLayout(), frame.cameraSet)) {
+            throw std::runtime_error("failed to allocate camera descriptor set!");
+        }
+        VkDescriptorBufferInfo cameraInfo{frame.cameraBuffer, 0, sizeof(SimpleCameraUbo)};
+        EvilutionDescriptorWriter(*cameraSetLayout, *descriptorPool)
+            .writeBuffer(0, &cameraInfo)
+            .overwrite(frame.cameraSet);
+
+        std::array<VkCommandBuffer, 2> commandBuffers{};
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        if (vkAllocateCommandBuffers(evilutionDevice.device(), &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate secondary command buffers!");
+        }
+        frame.dynamicCommands = commandBuffers[0];
+        frame.staticCommands = commandBuffers[1];
+    }
+}
+
+void SimpleRenderSystem::beginSecondary(VkCommandBuffer secondary, EvilutionPipeline& pipeline,
+                                        VkDescriptorSet cameraSet, const RenderTargetInfo& renderTarget,
+                                        VkExtent2D extent, VkCommandBufferUsageFlags usage) {
+    VkCommandBufferInheritanceRenderingInfo renderingInheritance{};
+    renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    renderingInheritance.colorAttachmentCount = static_cast<uint32_t>(renderTarget.colorAttachmentFormats.size());
+    renderingInheritance.pColorAttachmentFormats = renderTarget.colorAttachmentFormats.data();
+    renderingInheritance.depthAttachmentFormat = renderTarget.depthAttachmentFormat;
+    renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    // a render pass for the legacy path, attachment formats for dynamic rendering
+    inheritanceInfo.renderPass = renderTarget.renderPass;
+    inheritanceInfo.subpass = 0;
+    if (renderTarget.renderPass == VK_NULL_HANDLE) {
+        inheritanceInfo.pNext = &renderingInheritance;
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | usage;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    if (vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording secondary command buffer!");
+    }
+
+    // dynamic state is not inherited from the primary command buffer
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    VkRect2D scissor{{0, 0}, extent};
+    vkCmdSetViewport(secondary, 0, 1, &viewport);
+    vkCmdSetScissor(secondary, 0, 1, &scissor);
+    vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &cameraSet, 0,
+                            nullptr);
+    bindTracker.reset();
+    bindTracker.bindPipeline(secondary, pipeline);
+}
+
+bool SimpleRenderSystem::drawObject(VkCommandBuffer commandBuffer, const RenderObject& object) {
+    // the model may have been removed since the snapshot was built
+    GeometryAllocationId allocation;
+    if (!evilutionResourceRegistry.tryGetGeometry(object.model, allocation)) {
+        return false;
+    }
+
+    // the range is looked up once and used for both the binds and the draw, in case the pool compacts between
+    GeometryRange geometry = evilutionGeometryPool.getRange(allocation);
+    bindTracker.bindGeometry(commandBuffer, geometry);
+
+    SimplePushConstantData push{};
+    push.modelMatrix = object.transform;
+    push.normalMatrix = object.normalMatrix;
+
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                       sizeof(SimplePushConstantData), &push);
+    drawGeometry(commandBuffer, geometry);
+    bindTracker.countDraw();
+    return true;
+}
+
+void SimpleRenderSystem::renderGameObjects(VkCommandBuffer commandBuffer, const RenderSnapshot& snapshot,
+                                           int frameIndex, const RenderTargetInfo& renderTarget, VkExtent2D extent) {
+    lastFrameStats = {};
+    // the variant compiles in the background; draw nothing until it is ready rather than stall the frame
+    EvilutionPipeline* pipeline = evilutionPipeline.get();
+    if (pipeline == nullptr) {
+        return;
+    }
+
+    // the slot's previous frame has completed, so its camera and command buffers are free to overwrite
+    FrameResources& frame = frames[frameIndex];
+    SimpleCameraUbo camera{};
+    camera.projectionView = snapshot.camera.getProjection() * snapshot.camera.getView();
+    std::memcpy(frame.cameraMapped, &camera, sizeof(camera));
+    staticStats.frames++;
+
+    StaticDrawKey staticKey{snapshot.staticVersion, evilutionResourceRegistry.getRemovalCount(),
+                            evilutionGeometryPool.getGeneration(), pipeline, renderTarget, extent};
+    if (!(frame.staticKey == staticKey)) {
+        beginSecondary(frame.staticCommands, *pipeline, frame.cameraSet, renderTarget, extent, 0);
+        frame.hasStaticDraws = false;
+        for (const RenderObject& object : snapshot.staticObjects) {
+            frame.hasStaticDraws |= drawObject(frame.staticCommands, object);
+        }
+        if (vkEndCommandBuffer(frame.staticCommands) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer!");
+        }
+        frame.staticKey = std::move(staticKey);
+        lastFrameStats += bindTracker.getStats();
+        staticStats.recordings++;
+    } else if (frame.hasStaticDraws) {
+        staticStats.replays++;
+        staticStats.replayedDraws += snapshot.staticObjects.size();
+    }
+
+    beginSecondary(frame.dynamicCommands, *pipeline, frame.cameraSet, renderTarget, extent,
+                   VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    for (const DrawItem& item : snapshot.drawOrder) {
+        const RenderObject& object = snapshot.objects[item.object];
+        if (!object.isStatic) {
+            drawObject(frame.dynamicCommands, object);
+        }
+    }
+    if (vkEndCommandBuffer(frame.dynamicCommands) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record secondary command buffer!");
+    }
+    lastFrameStats += bindTracker.getStats();
+    totalStats += lastFrameStats;
+
+    std::array<VkCommandBuffer, 2> secondaries{frame.staticCommands, frame.dynamicCommands};
+    uint32_t first = frame.hasStaticDraws ? 0 : 1;
+    vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()) - first, secondaries.data() + first);
+}
+
+void SimpleRenderSystem::StaticDrawStats::print(std::ostream& out) const {
+    out << "static draws: recorded " << recordings << " times over " << frames << " frames, replayed in " << replays
+        << " frames (" << replayedDraws << " draws)" << std::endl;
 }
-} // namespace evilution
\ No newline at end of file
+} // namespace evilution
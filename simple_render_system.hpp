@@ -1,31 +1,109 @@
 #pragma once
 
 #include "evilution_camera.hpp"
+#include "evilution_descriptors.hpp"
 #include "evilution_device.hpp"
+#include "evilution_draw_list.hpp"
+#include "evilution_geometry_pool.hpp"
 #include "evilution_pipeline.hpp"
-
-#include <entt/entt.hpp>
+#include "evilution_pipeline_manager.hpp"
+#include "evilution_render_snapshot.hpp"
+#include "evilution_resource_registry.hpp"
+#include "evilution_swap_chain.hpp"
 
 // std
+#include <cstdint>
 #include <memory>
+#include <ostream>
+#include <vector>
 namespace evilution {
+// Draws through secondary command buffers, so the pass it records into has to be begun for secondary contents.
+// The snapshot's static objects are recorded once per frame in flight and replayed until the static set, the
+// pipeline, the render target or the geometry they were recorded against changes; only the other objects are
+// recorded every frame. The camera comes from a uniform buffer so the recorded draws stay valid as it moves.
 class SimpleRenderSystem {
   public:
-    SimpleRenderSystem(EvilutionDevice& device, VkRenderPass renderPass);
+    struct StaticDrawStats {
+        uint64_t frames = 0;
+        uint64_t recordings = 0;
+        // frames that executed static draws recorded in an earlier frame
+        uint64_t replays = 0;
+        uint64_t replayedDraws = 0;
+
+        void print(std::ostream& out) const;
+    };
+
+    SimpleRenderSystem(EvilutionDevice& device, EvilutionPipelineManager& pipelineManager,
+                       EvilutionResourceRegistry& resourceRegistry, EvilutionGeometryPool& geometryPool,
+                       const RenderTargetInfo& renderTarget, uint32_t framesInFlight);
     ~SimpleRenderSystem();
 
     SimpleRenderSystem(const SimpleRenderSystem&) = delete;
     SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
-    void renderGameObjects(VkCommandBuffer commandBuffer, entt::registry& registry, const EvilutionCamera& camera);
+    // Draws in the snapshot's sorted order, skipping binds that would not change anything. renderTarget and
+    // extent describe the pass being recorded into, which the secondary command buffers have to match.
+    void renderGameObjects(VkCommandBuffer commandBuffer, const RenderSnapshot& snapshot, int frameIndex,
+                           const RenderTargetInfo& renderTarget, VkExtent2D extent);
+
+    // binds and draws recorded, which leaves out replayed static draws
+    const DrawStats& getLastFrameStats() const { return lastFrameStats; }
+    const DrawStats& getTotalStats() const { return totalStats; }
+    const StaticDrawStats& getStaticDrawStats() const { return staticStats; }
 
   private:
+    // everything the recorded static draws depend on
+    struct StaticDrawKey {
+        uint64_t staticVersion = 0;
+        uint64_t modelRemovals = 0;
+        // the geometry pool moves every model when it compacts or grows
+        uint32_t geometryGeneration = 0;
+        EvilutionPipeline* pipeline = nullptr;
+        RenderTargetInfo renderTarget{};
+        VkExtent2D extent{0, 0};
+
+        bool operator==(const StaticDrawKey& other) const;
+    };
+
+    struct FrameResources {
+        VkBuffer cameraBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory cameraMemory = VK_NULL_HANDLE;
+        void* cameraMapped = nullptr;
+        VkDescriptorSet cameraSet = VK_NULL_HANDLE;
+
+        VkCommandBuffer dynamicCommands = VK_NULL_HANDLE;
+        VkCommandBuffer staticCommands = VK_NULL_HANDLE;
+        bool hasStaticDraws = false;
+        StaticDrawKey staticKey{};
+    };
+
+    void createDescriptors(uint32_t framesInFlight);
     void createPipelineLayout();
-    void createPipeline(VkRenderPass renderPass);
+    void createPipeline(const RenderTargetInfo& renderTarget);
+    void createFrameResources();
+    // also binds the pipeline, once for every draw recorded into the secondary
+    void beginSecondary(VkCommandBuffer secondary, EvilutionPipeline& pipeline, VkDescriptorSet cameraSet,
+                        const RenderTargetInfo& renderTarget, VkExtent2D extent, VkCommandBufferUsageFlags usage);
+    // returns whether anything was drawn
+    bool drawObject(VkCommandBuffer commandBuffer, const RenderObject& object);
 
     EvilutionDevice& evilutionDevice;
+    EvilutionPipelineManager& evilutionPipelineManager;
+    EvilutionResourceRegistry& evilutionResourceRegistry;
+    EvilutionGeometryPool& evilutionGeometryPool;
 
-    std::unique_ptr<EvilutionPipeline> evilutionPipeline;
+    PipelineHandle evilutionPipeline;
     VkPipelineLayout pipelineLayout;
+
+    std::unique_ptr<EvilutionDescriptorSetLayout> cameraSetLayout;
+    std::unique_ptr<EvilutionDescriptorPool> descriptorPool;
+    // only used by the render thread, so it is not shared with the device's pool
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    std::vector<FrameResources> frames;
+
+    EvilutionBindTracker bindTracker;
+    DrawStats lastFrameStats{};
+    DrawStats totalStats{};
+    StaticDrawStats staticStats{};
 };
-} // namespace evilution
\ No newline at end of file
+} // namespace evilution